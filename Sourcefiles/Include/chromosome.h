@@ -1,20 +1,30 @@
 #ifndef CHROMOSOME_H
 #define CHROMOSOME_H
 
-#include "../include/types.h"
+#include "../Include/types.h"
 #include "configuration.h"
 
+// Delarna som calculate_fitness väger ihop, även mål för SELECTION_PARETO
+typedef struct {
+    float time_penalty;
+    float energy_penalty;
+    float distance_penalty;
+    float collision_penalty;
+    float goal_bonus;
+} FitnessTerms;
+
 // Funktionsdeklarationer
 void initialize_chromosome(Chromosome *chr);
 void mutate_chromosome(Chromosome *chr, float mutation_rate);
 void crossover_chromosomes(Chromosome *parent1, Chromosome *parent2, 
                           Chromosome *child1, Chromosome *child2);
-void elite_selection(Individual old_pop[POP_SIZE], Individual new_pop[POP_SIZE], 
-                     int generation, int *id_counter);
-Individual* tournament_select(Individual population[]);
 
-Action decide_action(Individual *individual, Simulationcontext *context);
+Action decide_action(const Chromosome *chr, const float sensor_readings[5]);
+bool forward_dominates(const Chromosome *chr, float front_reading);
 float calculate_fitness(Individual *individual, int steps_taken, Simulationcontext *context);
+void fitness_terms(const Individual *individual, int steps_taken, Simulationcontext *context,
+                   FitnessTerms *terms);
+float fitness_upper_bound(const Individual *individual, int max_steps, Simulationcontext *context);
 int find_best_index(Individual pop[POP_SIZE]);
 
 // Hjälpfunktioner
@@ -0,0 +1,23 @@
+#ifndef COARSE_H
+#define COARSE_H
+
+#include "types.h"
+#include "configuration.h"
+
+// Grov utvärdering på rutnätet (COARSE_SCREENING=1). Roboten står på en ruta
+// och pekar åt ett av åtta håll, FORWARD och BACKWARD flyttar den till
+// grannrutan, en sensor räknar fria rutor åt sitt håll och bara rutan roboten
+// flyttar till kollisionstestas. Ger en fitness på samma skala som den fulla
+// simuleringen, för att rangordna avkomman innan den simuleras.
+
+// Huvudfunktioner
+float coarse_evaluate(const Chromosome *chromosome, Simulationcontext *context, int max_steps);
+
+// For breed_population_screened, arg is the Simulationcontext
+float coarse_score(const Chromosome *chromosome, void *arg);
+
+// Spearman's rank correlation of a and b, ties get their average rank.
+// NAN when there are fewer than two values or one of them is constant
+float rank_correlation(const float *a, const float *b, int count);
+
+#endif
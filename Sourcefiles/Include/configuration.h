@@ -13,14 +13,81 @@
 #define MUTATION_RATE 0.2f
 #define BASE_LINE_FITNESS 100
 
+//Selection configuration, defaults for the settings menu
+#define SELECTION_METHOD SELECTION_ELITE        // SELECTION_ELITE, SELECTION_TOURNAMENT, SELECTION_RANK or SELECTION_PARETO
+#define ELITE_COUNT 2             // best individuals kept unchanged each generation
+#define TOURNAMENT_SIZE 3
+#define RANK_PRESSURE 1.7f        // linear ranking pressure between 1 and 2
+
+//Surrogate configuration, see surrogate.h
+#ifndef SURROGATE
+#define SURROGATE 0               // screen offspring with a k-NN model, cmake -DSURROGATE=ON
+#endif
+#define SURROGATE_CANDIDATES 4    // children bred per offspring slot, the best predicted one is simulated
+#define SURROGATE_NEIGHBOURS 5
+#define SURROGATE_ARCHIVE 1024    // evaluated individuals the model remembers
+#define SURROGATE_MIN_SAMPLES 100 // offspring are not screened before the model has this many
+
+//Coarse screening configuration, see coarse.h
+#ifndef COARSE_SCREENING
+#define COARSE_SCREENING 0        // screen offspring on the cell grid, cmake -DCOARSE_SCREENING=ON
+#endif
+#define COARSE_CANDIDATES 4       // children bred per offspring slot, the best on the grid is simulated
+
+#if SURROGATE && COARSE_SCREENING
+#error "SURROGATE and COARSE_SCREENING both screen the offspring, enable one of them"
+#endif
+
+//Novelty configuration, see novelty.h
+#ifndef NOVELTY_SEARCH
+#define NOVELTY_SEARCH 0          // add a novelty term to selection, cmake -DNOVELTY_SEARCH=ON
+#endif
+#define NOVELTY_WEIGHT 1.0f       // fitness points per unit of novelty
+#define NOVELTY_NEIGHBOURS 15     // archived final positions the distance is averaged over
+#define NOVELTY_CELL_WEIGHT 10.0f // novelty of a trajectory through cells the archive never visited
+#define NOVELTY_ARCHIVE 4096      // final positions kept, the oldest are replaced
+#define NOVELTY_ADD 2             // most novel individuals archived per generation
+#define NOVELTY_BUCKETS 4096      // spatial hash buckets, a power of two
+
+//Island configuration
+#define ISLAND_COUNT 0            // 0 = one island per core
+#define MAX_ISLANDS 64
+#define MIGRATION_INTERVAL 10     // generations between migrations
+#define MIGRANT_COUNT 2           // best individuals sent to the next island
+
+//Steady-state configuration
+#define STEADY_STATE_WORKERS 0    // 0 = one worker thread per core
+
+//Distributed configuration
+#define DISTRIBUTED_ADDRESS "unix:robot_coordinator.sock"   // or "tcp:[host:]port"
+#define DIST_BATCH_SIZE 8         // chromosomes per batch sent to a worker
+
 //Maze configuration
 #define DEFAULT_MAZE_WIDTH 25
 #define DEFAULT_MAZE_HEIGHT 25
+#define MIN_MAZE_SIZE 5
+#define MAX_MAZE_SIZE 4096        // per side, set at runtime in the "Maze size" menu
 #define ROBOT_WIDTH 2.0f
 #define ROBOT_HEIGHT 2.0f
 #define MAX_ATTEMPTS 1000
+#define GOAL_THRESHOLD 2.0f       // distance from the goal that counts as reaching it
+#define MOVE_DISTANCE 1.0f        // how far FORWARD and BACKWARD move the robot
 #define PHASES_PER_GENERATION 25
 
+//Simulation configuration
+#ifndef EVENT_DRIVEN_STEPPING
+#define EVENT_DRIVEN_STEPPING 1      // straight FORWARD runs skip the decision, cmake -DEVENT_DRIVEN_STEPPING=OFF
+#endif
+#define SIMULATION_WORKERS 0         // task scheduler workers of a single run, 0 = one per core
+#define STRAIGHT_RUN_MAX_STEPS 64    // front readings scanned ahead at a time
+#define REPEAT_WINDOW 16             // steps searched for a repeated pose
+#ifndef PREFIX_SHARING
+#define PREFIX_SHARING 1             // offspring reuse their parents' first steps, cmake -DPREFIX_SHARING=OFF
+#endif
+#ifndef BOUND_ABORT
+#define BOUND_ABORT 0                // stop individuals that can no longer be selected, cmake -DBOUND_ABORT=ON
+#endif
+
 // Maze configuration över hur loggningen ser ut
 #define WALL '#'         
 #define EMPTY 'O'        
@@ -29,6 +96,23 @@
 #define START 'S'       
 
 
+//Logging configuration
+#define LOG_SEGMENT_GENERATIONS 25   // generations per robot_log segment file
+#define HEATMAP_RECORD_MAX_CELLS (512 * 512)   // larger mazes get no per-generation heatmap records
+
+//Instrumentation configuration, see instrument.h
+#ifndef INSTRUMENTATION
+#define INSTRUMENTATION 0            // or cmake -DINSTRUMENTATION=ON
+#endif
+#define INSTRUMENT_SAMPLE_INTERVAL 64   // every n:th step is timed
+
+//Tracing configuration, see trace.h
+#ifndef TRACING
+#define TRACING 0                    // or cmake -DTRACING=ON
+#endif
+#define TRACE_FILE "robot_trace.json"
+#define TRACE_BUFFER_EVENTS 262144   // events kept per thread, older ones are overwritten
+
 //Fitness configuration
 #define FITNESS_ALPHA   1.0f
 #define FITNESS_BETA    0.5f
@@ -0,0 +1,71 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "types.h"
+#include "configuration.h"
+
+// Distribuerad utvärdering. Koordinatorn lyssnar på en adress ("unix:/sökväg"
+// eller "tcp:[värd:]port"), arbetarna ansluter och får batcher av kromosomer
+// tillsammans med labyrinten de ska köras i. Meddelandena skickas i maskinens
+// egen byteordning, så koordinator och arbetare ska vara byggda för samma arkitektur.
+
+#define DIST_MAGIC 0x52445342u   // "BSDR"
+
+typedef enum {
+    DIST_MAZE = 1,      // DistMazeHeader + width*height cells
+    DIST_BATCH,         // DistBatchHeader + count Chromosome
+    DIST_RESULTS,       // DistResultsHeader + count DistResult (+ movements)
+    DIST_BYE
+} DistMessageType;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t type;
+    uint32_t length;    // payload bytes after the header
+} DistHeader;
+
+typedef struct {
+    int32_t maze_id;
+    int32_t width, height;
+    int32_t start_x, start_y;
+    int32_t goal_x, goal_y;
+    Sensor sensors[5];
+} DistMazeHeader;
+
+typedef struct {
+    int32_t batch_id;
+    int32_t maze_id;
+    int32_t count;
+    int32_t with_movements;   // send the full movement logs back
+} DistBatchHeader;
+
+typedef struct {
+    int32_t batch_id;
+    int32_t count;
+} DistResultsHeader;
+
+// Trajectory summary of one evaluated chromosome
+typedef struct {
+    float fitness;
+    int32_t steps_taken;
+    int32_t collision_count;
+    int32_t reached_goal;
+    float final_x, final_y, final_angle;
+    int32_t movement_count;
+} DistResult;
+
+typedef struct DistCoordinator DistCoordinator;
+
+// Koordinator
+DistCoordinator *coordinator_start(const char *address);
+void coordinator_stop(DistCoordinator *coordinator);
+int coordinator_evaluate(DistCoordinator *coordinator, Simulationcontext *context,
+                         Individual *population, int count,
+                         MovementLog (*movement_logs)[MAX_STEPS], int *movement_counts);
+
+// Arbetare, ansluter om när koordinatorn försvinner och returnerar bara vid fel
+int worker_run(const char *address);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <stdbool.h>
+#include "types.h"
+#include "manifest.h"
+
+#define HEATMAP_MAX_PHASES 10
+#define HEATMAP_MAGIC 0x50414d48   // "HMAP"
+
+typedef enum {
+    HEATMAP_OVERALL,
+    HEATMAP_GENERATION,
+    HEATMAP_PHASE,
+    HEATMAP_BEST
+} HeatmapKind;
+
+// Besöksräknare för en labyrint. På disk skrivs varje grid som en post:
+//   int32 magic, kind, generation, phase, width, height
+//   uint8 layout[width * height]   (samma tecken som i labyrinten)
+//   uint32 counts[width * height]
+typedef struct {
+    int kind;
+    int generation;         // generationen posten gäller, eller den senaste som ingår
+    int phase;              // träningsfas, -1 för overall/best
+    int width, height;
+    unsigned char *layout;
+    unsigned int *counts;
+} HeatmapGrid;
+
+// Each worker counts into its own lane during a generation; the lanes are
+// merged into the generation grid when the generation ends
+typedef struct {
+    int width, height;
+    int lane_count;
+    unsigned int **lanes;
+    int generation, phase;
+    HeatmapGrid current;                    // the running generation
+    HeatmapGrid overall;
+    HeatmapGrid best;
+    HeatmapGrid phases[HEATMAP_MAX_PHASES];
+    char records_path[LOG_PATH_MAX];        // appended, one grid per generation
+    char totals_path[LOG_PATH_MAX];         // rewritten, overall/best/phase grids
+    bool totals_dirty;                      // totals changed since they were saved
+} HeatmapAccumulator;
+
+// Huvudfunktioner
+HeatmapAccumulator *heatmap_create(const char *log_filename, int lane_count);
+void heatmap_destroy(HeatmapAccumulator *acc);
+
+// Drops the records of start_generation and later, which an interrupted
+// session wrote after the last generation the log kept
+void heatmap_resume(HeatmapAccumulator *acc, int start_generation);
+
+// Per generation
+void heatmap_begin_generation(HeatmapAccumulator *acc, Simulationcontext *context,
+                              int generation, int phase);
+void heatmap_visit(HeatmapAccumulator *acc, int lane, float x, float y);
+void heatmap_end_generation(HeatmapAccumulator *acc, const MovementLog *best_movements,
+                            int best_movement_count);
+
+// Sökvägar: robot_log.json -> robot_log.heatmaps.bin, robot_log.heatmap_totals.bin
+void heatmap_records_path(const char *log_filename, char *out, size_t size);
+void heatmap_totals_path(const char *log_filename, char *out, size_t size);
+
+#endif
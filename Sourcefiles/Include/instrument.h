@@ -0,0 +1,103 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "configuration.h"
+
+// Instrumentering av simuleringen. Slås på vid kompilering med
+// INSTRUMENTATION=1 (cmake -DINSTRUMENTATION=ON); annars försvinner alla
+// makron nedan och ingenting mäts. Räknarna är per tråd, så varje ö har sina egna.
+
+typedef enum {
+    INSTR_SENSORS,          // sampled per step
+    INSTR_DECISION,         // sampled per step
+    INSTR_MOVEMENT,         // sampled per step
+    INSTR_FITNESS,
+    INSTR_SIMULATE,
+    INSTR_LOGGING,
+    INSTR_EVOLVE,
+    INSTR_MAZE,
+    INSTR_TIMER_COUNT
+} InstrumentTimer;
+
+typedef enum {
+    INSTR_STEPS,
+    INSTR_RAYCAST_CELLS,
+    INSTR_COLLISIONS,
+    INSTR_EARLY_TERMINATIONS,   // individuals stopped by a collision before MAX_STEPS
+    INSTR_GOALS_REACHED,
+    INSTR_STRAIGHT_RUN_STEPS,   // FORWARD steps taken without a decision, see EVENT_DRIVEN_STEPPING
+    INSTR_REPLAYED_STEPS,       // steps replayed from a loop after a repeated pose
+    INSTR_SHARED_STEPS,         // steps copied from a parent, see PREFIX_SHARING
+    INSTR_BYTES_LOGGED,
+    INSTR_COUNTER_COUNT
+} InstrumentCounter;
+
+typedef struct {
+    uint64_t counters[INSTR_COUNTER_COUNT];
+    uint64_t ticks[INSTR_TIMER_COUNT];
+    uint64_t step_clock;        // picks the steps that are timed
+} InstrumentStats;
+
+// Times in milliseconds, the sampled step timers already scaled up
+typedef struct {
+    uint64_t counters[INSTR_COUNTER_COUNT];
+    double ms[INSTR_TIMER_COUNT];
+} InstrumentReport;
+
+extern _Thread_local InstrumentStats instrument_stats;
+
+#if INSTRUMENTATION
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t instrument_ticks(void) { return __rdtsc(); }
+#else
+#include <time.h>
+static inline uint64_t instrument_ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+#define INSTR_COUNT(counter, n)     (instrument_stats.counters[(counter)] += (uint64_t)(n))
+#define INSTR_TIME_BEGIN(mark)      uint64_t mark = instrument_ticks()
+#define INSTR_TIME_END(timer, mark) (instrument_stats.ticks[(timer)] += instrument_ticks() - (mark))
+
+// Timing every step would cost more than the steps themselves, so only
+// every INSTRUMENT_SAMPLE_INTERVAL:th step is timed and scaled up in the report
+#define INSTR_STEP_BEGIN(mark) \
+    uint64_t mark = (++instrument_stats.step_clock % INSTRUMENT_SAMPLE_INTERVAL == 0) ? instrument_ticks() : 0
+#define INSTR_STEP_LAP(timer, mark) do { \
+        if (mark) { \
+            uint64_t instr_now = instrument_ticks(); \
+            instrument_stats.ticks[(timer)] += instr_now - (mark); \
+            (mark) = instr_now; \
+        } \
+    } while (0)
+
+#else
+
+#define INSTR_COUNT(counter, n)     ((void)0)
+#define INSTR_TIME_BEGIN(mark)
+#define INSTR_TIME_END(timer, mark) ((void)0)
+#define INSTR_STEP_BEGIN(mark)
+#define INSTR_STEP_LAP(timer, mark) ((void)0)
+
+#endif
+
+// Huvudfunktioner
+void instrument_reset(void);
+void instrument_report(InstrumentReport *report);
+void instrument_format(const InstrumentReport *report, char *out, size_t size);
+void instrument_format_json(const InstrumentReport *report, char *out, size_t size);
+
+// Work done on scheduler workers is counted on their threads. A task moves
+// its thread's counts into a per-worker total, and the thread that reports
+// takes the totals in when the tasks are done
+void instrument_drain(InstrumentStats *total);
+void instrument_absorb(InstrumentStats *total);
+
+#endif
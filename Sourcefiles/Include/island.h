@@ -0,0 +1,27 @@
+#ifndef ISLAND_H
+#define ISLAND_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "types.h"
+#include "configuration.h"
+
+// Migranter mellan öarna. Varje ö har en inkorg som bara grannen skriver till
+// och bara ön själv läser från, så en ringbuffert med två atomiska index räcker.
+#define MAILBOX_CAPACITY (4 * MIGRANT_COUNT)
+
+typedef struct {
+    Individual slots[MAILBOX_CAPACITY];
+    atomic_uint head;   // next slot to read, owned by the receiving island
+    atomic_uint tail;   // next slot to write, owned by the sending island
+} MigrantMailbox;
+
+void mailbox_init(MigrantMailbox *mailbox);
+bool mailbox_push(MigrantMailbox *mailbox, const Individual *migrant);
+bool mailbox_pop(MigrantMailbox *mailbox, Individual *migrant);
+
+// Antal öar som ska köras, ISLAND_COUNT eller en per kärna
+int island_count(void);
+int core_count(void);
+
+#endif
@@ -2,15 +2,55 @@
 #define LOGGER_H
 
 #include "types.h"
+#include "manifest.h"
+#include "configuration.h"
+#include "scheduler.h"
 #include <stdio.h>
 
+// One individual's record, formatted apart from the log by log_individuals
 typedef struct {
-    FILE *file;
+    char *buffer;
+    size_t len;
+    size_t cap;
+} LogRecord;
+
+typedef struct {
+    int fd;                 // file descriptor of the open segment, written with pwrite
+    long long offset;       // file offset where the next flush is written
+    char *buffer;           // pending output, flushed at the end of each record
+    size_t buffer_len;
+    size_t buffer_cap;
     int first_entry;
     bool first_generation; 
     int generation_count;
+
+    // Segmentering: robot_log.json is split into robot_log.segNNNN.json
+    // files that are listed in robot_log.manifest.json
+    char filename[LOG_PATH_MAX];
+    int segment_index;          // segment currently open, -1 if none
+    long long generation_start; // offset of the generation being written
+    int current_generation;
+    int max_individual_id;
+    int layout_maze_id;         // maze whose layout this segment already holds, -1 if none
+    LogManifest manifest;
+    LogRecord *records;         // reused by log_individuals, one per individual
+    int record_count;
 } JsonLogger;
 
+// Sammanfattning av en generation, skrivs i "generation_stats"
+typedef struct {
+    int goals_reached;
+    float avg_fitness;
+    float best_fitness;
+    int best_individual_id;
+    int aborted;                // BOUND_ABORT: individuals stopped early
+    int steps_saved;            // BOUND_ABORT: at most MAX_STEPS per aborted individual
+    int predicted;              // SURROGATE: individuals bred with a predicted fitness
+    float surrogate_error;      // SURROGATE: their mean absolute prediction error
+    float coarse_correlation;   // COARSE_SCREENING: rank correlation of coarse and full fitness, NAN if none
+    float avg_novelty;          // NOVELTY_SEARCH: mean novelty of the generation
+} GenerationStats;
+
 // Huvudfunktioner
 JsonLogger* init_json_logger(const char *filename);
 void close_json_logger(JsonLogger *logger);
@@ -20,16 +60,18 @@ void log_generation_start(JsonLogger *logger, int generation, const char *maze_t
                          Simulationcontext *context);
 void log_individual_complete(JsonLogger *logger, Individual *ind, 
                            MovementLog *movements, int movement_count);
-void log_generation_end(JsonLogger *logger, int goals_reached, float avg_fitness, 
-                       float best_fitness, int best_individual_id);
+void log_individuals(JsonLogger *logger, Individual *population,
+                     MovementLog (*movement_logs)[MAX_STEPS], const int *movement_counts,
+                     int count, TaskScheduler *scheduler);
+void log_generation_end(JsonLogger *logger, const GenerationStats *stats);
 void save_maze_to_log(int maze_id, int **maze, int width, int height,
                       const char *maze_type, int clear_percent,
                       const char *filename);
 
 // Hjälpfunktioner
-void write_maze(FILE *file, int **maze, int width, int height);
-void write_chromosome(FILE *file, Chromosome *chr);
-void write_movements(FILE *file, MovementLog *movements, int count);
+void write_maze(JsonLogger *logger, int **maze, int width, int height);
+void write_chromosome(JsonLogger *logger, Chromosome *chr);
+void write_movements(JsonLogger *logger, MovementLog *movements, int count);
 
 // Läsning
 Individual* load_best_individual_from_file(const char *filename, int *found);
@@ -0,0 +1,55 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LOG_PATH_MAX 512
+
+// One generation object inside a segment file
+typedef struct {
+    int generation;
+    long long start, end;       // byte range of the generation object
+    float best_fitness;
+    int best_individual_id;
+} LogGenerationEntry;
+
+// One segment file holding LOG_SEGMENT_GENERATIONS consecutive generations
+typedef struct {
+    int index;
+    char file[LOG_PATH_MAX];    // file name relative to the manifest
+    int first_generation, last_generation;
+    float best_fitness;
+    int best_individual_id;
+    int max_individual_id;
+    int generation_count, generation_cap;
+    LogGenerationEntry *generations;
+} LogSegment;
+
+typedef struct {
+    int segment_count, segment_cap;
+    LogSegment *segments;
+} LogManifest;
+
+// Sökvägar: robot_log.json -> robot_log.manifest.json, robot_log.seg0000.json
+void log_derived_path(const char *log_filename, const char *suffix, char *out, size_t size);
+void log_manifest_path(const char *log_filename, char *out, size_t size);
+void log_segment_path(const char *log_filename, int segment, char *out, size_t size);
+int log_segment_for_generation(int generation);
+
+// Läsning och skrivning
+bool load_log_manifest(const char *log_filename, LogManifest *manifest);
+bool save_log_manifest(const char *log_filename, const LogManifest *manifest);
+void free_log_manifest(LogManifest *manifest);
+
+// Uppslag och uppdatering
+LogSegment *manifest_find_segment(LogManifest *manifest, int index);
+LogSegment *manifest_add_segment(LogManifest *manifest, int index, const char *file);
+void manifest_add_generation(LogSegment *segment, const LogGenerationEntry *entry, int max_individual_id);
+void manifest_truncate_segment(LogSegment *segment, long long size);
+const LogGenerationEntry *manifest_find_generation(const LogManifest *manifest, int generation,
+                                                   const LogSegment **segment);
+const LogGenerationEntry *manifest_best_generation(const LogManifest *manifest,
+                                                   const LogSegment **segment);
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef MAZE_H
 #define MAZE_H
 #include <stdbool.h>
+#include <math.h>
 #include "types.h"
+#include "configuration.h"
+#include "scheduler.h"
 
 typedef struct {
     int width, height;
@@ -18,13 +21,67 @@ typedef enum {
     NARROW
 } LabyrinthType;
 
+// Väggar och kanter lagras också som en bit per ruta i block om 8x8 rutor,
+// ett uint64_t per block. En stråle eller kollisionskontroll i vilken riktning
+// som helst rör då ett ord per 8 rutor, och en 4096x4096-labyrint tar 2 MB.
+#define MAZE_TILE_SHIFT 3
+#define MAZE_TILE_MASK ((1 << MAZE_TILE_SHIFT) - 1)
+
+// En bit per ruta, rad för rad: bit x % 64 i ord y * stride + x / 64
+typedef struct {
+    int width, height;
+    int stride;             // 64-bit words per row
+    uint64_t *bits;
+} CellMask;
+
+static inline bool mask_test(const CellMask *mask, int x, int y) {
+    return (mask->bits[(size_t)y * mask->stride + x / 64] >> (x % 64)) & 1;
+}
+
+static inline void mask_set(CellMask *mask, int x, int y) {
+    mask->bits[(size_t)y * mask->stride + x / 64] |= 1ULL << (x % 64);
+}
+
+// x and y must be inside the maze
+static inline bool maze_is_solid(const Simulationcontext *context, int x, int y) {
+    if (!context->solid) {
+        int cell = context->maze[y][x];
+        return cell == WALL || cell == BORDER;
+    }
+    uint64_t tile = context->solid[(size_t)(y >> MAZE_TILE_SHIFT) * context->solid_stride +
+                                   (x >> MAZE_TILE_SHIFT)];
+    return (tile >> (((y & MAZE_TILE_MASK) << MAZE_TILE_SHIFT) | (x & MAZE_TILE_MASK))) & 1;
+}
+
+// Steps to the goal from the cell under (x, y) following the open cells, or
+// the straight line when there is no distance field or the cell cannot reach it
+static inline float maze_goal_distance(const Simulationcontext *context, float x, float y) {
+    int cx = (int)x, cy = (int)y;
+    if (context->goal_distance && x >= 0 && y >= 0 &&
+        cx < context->maze_width && cy < context->maze_height) {
+        int steps = context->goal_distance[(size_t)cy * context->maze_width + cx];
+        if (steps > 0) return (float)steps;
+    }
+    float dx = x - context->goal_x, dy = y - context->goal_y;
+    return sqrtf(dx * dx + dy * dy);
+}
+
 // Funktionsdeklarationer
 int **create_matrix(int rows, int cols);
 void free_matrix(int **matrix, int rows);
+bool maze_build_solid(Simulationcontext *context);
+bool maze_build_goal_distance(Simulationcontext *context);
+bool maze_prepare(Simulationcontext *context, TaskScheduler *scheduler);
+void maze_release(Simulationcontext *context);
+void carve_random_paths(int **maze, int width, int height, int clear_chance_percent);
 int **generate_labyrinthe(LabyrinthType type, int *width, int *height, 
                           Simulationcontext *context);
 void place_goal_on_edge(int **maze, int width, int height, Simulationcontext *context);
-void place_start(int **maze, int width, int height, Simulationcontext *context);
+bool place_start(int **maze, int width, int height, Simulationcontext *context);
+bool maze_connected_component(int **maze, int width, int height, int x, int y,
+                              CellMask *component);
+CellMask mask_create(int width, int height);   // bits is NULL when out of memory
+void mask_free(CellMask *mask);
 bool is_maze_solvable(int **maze, int width, int height, int start_x, int start_y, 
                       int goal_x, int goal_y);
 void init_maze_id_counter(const char *filename);
@@ -5,13 +5,15 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "../include/configuration.h"
-#include "../include/types.h"
-#include "../include/menus.h"
+#include "../Include/configuration.h"
+#include "../Include/types.h"
+#include "../Include/menus.h"
 
 void mainmenu();
 void show_heatmap_menu();
 void analysis_submenu();
+void selection_submenu();
+void maze_size_setting(Simulationcontext *context);
 
 
 
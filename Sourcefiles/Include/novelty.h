@@ -0,0 +1,48 @@
+#ifndef NOVELTY_H
+#define NOVELTY_H
+
+#include <stdbool.h>
+#include "types.h"
+#include "configuration.h"
+#include "maze.h"
+
+// Noveltyarkiv (NOVELTY_SEARCH=1). Arkivet minns slutpositionerna för de mest
+// nyskapande individerna på den aktuella labyrinten och vilka rutor de har
+// besökt. En individs novelty är medelavståndet till de NOVELTY_NEIGHBOURS
+// närmaste slutpositionerna plus andelen av dess steg i rutor arkivet aldrig
+// har besökt. Slutpositionerna ligger i en spatial hash med rutor som växer
+// med arkivet, så en sökning läser ungefär lika många poster oavsett storlek.
+
+typedef struct {
+    float x, y;                       // final position
+    int cell_x, cell_y;               // hash cell it is filed under
+    int next;                         // next entry in the bucket, -1 ends the chain
+} NoveltyEntry;
+
+typedef struct {
+    NoveltyEntry *entries;            // ring of NOVELTY_ARCHIVE entries
+    int count;
+    int next;                         // slot the next entry overwrites
+    int *buckets;                     // first entry of each of NOVELTY_BUCKETS chains, -1 when empty
+    float cell_size;
+    int indexed_count;                // count when the cell size was last chosen
+    CellMask visited;                 // cells any archived individual has stepped on
+    int maze_id;                      // maze the archive is for, -1 when empty
+} NoveltyArchive;
+
+// Huvudfunktioner
+bool novelty_init(NoveltyArchive *archive);
+void novelty_free(NoveltyArchive *archive);
+
+// Starts the archive over when the maze is not the one it holds. False when
+// the visited cells cannot be allocated, the archive is then empty
+bool novelty_begin_maze(NoveltyArchive *archive, const Simulationcontext *context);
+
+// Reads the archive only, so individuals can be scored in parallel
+float novelty_score(const NoveltyArchive *archive, const Individual *individual,
+                    const MovementLog *movements, int movement_count);
+
+void novelty_add(NoveltyArchive *archive, const Individual *individual,
+                 const MovementLog *movements, int movement_count);
+
+#endif
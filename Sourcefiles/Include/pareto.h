@@ -0,0 +1,21 @@
+#ifndef PARETO_H
+#define PARETO_H
+
+#include "scheduler.h"
+
+// Icke-dominerad sortering och crowding distance för NSGA-II-urval
+// (SELECTION_PARETO). Punkterna sorteras lexikografiskt så att en punkt bara
+// kan domineras av punkter före den, och varje punkt binärsöks in bland de
+// fronter som redan finns (Efficient Non-dominated Sort). Det görs i block:
+// punkterna i ett block söks parallellt mot fronterna före blocket och
+// jämförs sedan med varandra, och crowding distance räknas parallellt per front.
+
+// objectives holds objective_count values per point, row by row, all
+// minimized. fronts[i] gets the front of point i from 0 (no point dominates
+// it), crowding[i] its crowding distance in that front: INFINITY at the ends
+// of an objective the front spreads over, and in fronts of one or two points.
+// Returns the number of fronts, or -1 when out of memory
+int pareto_sort(const float *objectives, int count, int objective_count,
+                int *fronts, float *crowding, TaskScheduler *scheduler);
+
+#endif
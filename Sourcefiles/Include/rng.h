@@ -0,0 +1,13 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// Slumptalsström per tråd (xorshift64*). Varje tråd har ett eget tillstånd
+// så att öarna kan köra parallellt och ändå vara reproducerbara från sitt frö.
+void rng_seed(uint64_t seed);
+uint32_t rng_next(void);
+int rng_int(int n);          // [0, n)
+float rng_float(void);       // [0, 1]
+
+#endif
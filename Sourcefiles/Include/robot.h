@@ -10,9 +10,12 @@ bool execute_action(Individual *individual, Action action, Simulationcontext *co
 bool reached_goal(Robot *robot, Simulationcontext *context);
 bool check_collision(Robot *robot, float x, float y, float angle, Simulationcontext *context);
 float simulate_ultrasonic(Individual *individual, int sensor_id, Simulationcontext *context);
+int front_readings_ahead(Individual *individual, Simulationcontext *context, int steps,
+                         float *readings);
 
 void initialize_robot(Robot *robot, float start_x, float start_y);
 void update_orientation(Robot *robot);
+void restore_robot_pose(Robot *robot, float x, float y, float angle);
 void get_direction_vector(Robot *robot, float *dx, float *dy);
 void print_robot_status(Robot *robot);
 
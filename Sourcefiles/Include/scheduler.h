@@ -0,0 +1,28 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// Arbetsstjälande schemaläggare för små uppgifter (en individ, en del av en
+// labyrint, en loggpost). Varje arbetare har en egen kö: den lägger till och
+// tar uppgifter längst bak, och en arbetare utan uppgifter stjäl den äldsta
+// från en annan kö. Tråden som skapar schemaläggaren är arbetare 0 och hjälper
+// till medan den väntar, med en arbetare körs allt direkt i den tråden.
+
+// worker is the index of the worker running the task, 0..worker_count-1,
+// for per-worker state such as heatmap lanes
+typedef void (*TaskFunction)(void *arg, int worker);
+typedef void (*TaskRangeFunction)(void *arg, int index, int worker);
+
+typedef struct TaskScheduler TaskScheduler;
+
+// Huvudfunktioner
+TaskScheduler *scheduler_create(int worker_count);
+void scheduler_destroy(TaskScheduler *scheduler);
+int scheduler_worker_count(const TaskScheduler *scheduler);
+
+// Uppgifter. A NULL scheduler runs everything at once on the calling thread
+void scheduler_spawn(TaskScheduler *scheduler, TaskFunction function, void *arg);
+void scheduler_wait(TaskScheduler *scheduler);
+void scheduler_parallel_for(TaskScheduler *scheduler, int count, int grain,
+                            TaskRangeFunction body, void *arg);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <stdbool.h>
+#include "types.h"
+#include "configuration.h"
+#include "scheduler.h"
+
+// Urval och avel. Alla metoder kostar O(n) per generation utan fullständig
+// sortering och använder bara trådens egen slumpström, så öarna kan avla parallellt.
+typedef enum {
+    SELECTION_ELITE,        // parents drawn from the k best
+    SELECTION_TOURNAMENT,   // best of tournament_size random individuals
+    SELECTION_RANK,         // linear ranking through a probabilistic binary tournament
+    SELECTION_PARETO        // NSGA-II, binary tournament on front and crowding distance, see pareto.h
+} SelectionMethod;
+
+typedef struct {
+    SelectionMethod method;
+    int elite_count;        // best individuals copied unchanged, also the parent pool for SELECTION_ELITE
+    int tournament_size;
+    float rank_pressure;    // 1 = no pressure, 2 = maximum
+    float mutation_rate;
+} SelectionConfig;
+
+// Inställningar som nästa körning använder, ändras från menyn
+extern SelectionConfig selection_config;
+
+// Eliten och resten av populationen i en steady-state-körning, var för sig
+// som min-heapar på fitness. Den svagaste eliten och den sämsta av resten
+// ligger först, så ett barn som ersätter den sämsta sorteras in i O(log n)
+// i stället för att eliten väljs om och populationen söks igenom varje gång.
+typedef struct {
+    int elite[POP_SIZE];    // indices of the elite_count best, the parents under SELECTION_ELITE
+    int elite_count;
+    int rest[POP_SIZE];     // indices of the others
+    int rest_count;
+} SteadyRanking;
+
+// Uppskattad fitness för en ny kromosom, högre är mer lovande. Kandidaterna
+// poängsätts parallellt, så funktionen får bara läsa arg
+typedef float (*ChildScore)(const Chromosome *child, void *arg);
+
+// Huvudfunktioner. Avelsfunktionerna returnerar false utan att ha fyllt new_pop
+// när minnet tar slut
+bool breed_population(const SelectionConfig *config, Individual old_pop[], Individual new_pop[],
+                      int count, int generation, int *id_counter);
+bool breed_population_screened(const SelectionConfig *config, Individual old_pop[], Individual new_pop[],
+                               int count, int generation, int *id_counter,
+                               int candidates, ChildScore score, void *score_arg,
+                               TaskScheduler *scheduler);
+Individual *tournament_select(Individual population[], int count, int tournament_size);
+Individual *rank_select(Individual population[], int count, float pressure);
+int select_top_k(const Individual population[], int count, int k, int *indices);
+void select_parents(const SelectionConfig *config, Individual population[], int count,
+                    const SteadyRanking *ranking, Chromosome *parent1, Chromosome *parent2);
+void breed_child(const SelectionConfig *config, Chromosome *parent1, Chromosome *parent2,
+                 Chromosome *child);
+void ranking_build(SteadyRanking *ranking, const SelectionConfig *config,
+                   const Individual population[], int count);
+int ranking_worst(const SteadyRanking *ranking);
+void ranking_replaced(SteadyRanking *ranking, const Individual population[]);
+
+// Hjälpfunktioner
+const char *selection_method_name(SelectionMethod method);
+
+#endif
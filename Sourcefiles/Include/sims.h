@@ -4,5 +4,10 @@
 #include "types.h" 
 
 void simulate_population_batch(Simulationcontext *context, Individual *elite, int use_elite);
+void simulate_islands(Simulationcontext *context, Individual *elite, int use_elite);
+void simulate_distributed(Simulationcontext *context, Individual *elite, int use_elite);
+void simulate_steady_state(Simulationcontext *context, Individual *elite, int use_elite);
+void evaluate_individual(Simulationcontext *context, Individual *individual, int max_steps,
+                         MovementLog *movement_log, int *movement_count);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include <stdbool.h>
+#include "types.h"
+#include "configuration.h"
+
+// Surrogatmodell för förhandsurval av avkomman (SURROGATE=1). Modellen minns
+// fitness för de SURROGATE_ARCHIVE senast utvärderade individerna på den
+// aktuella labyrinten och uppskattar en ny kromosom med ett avståndsviktat
+// medel av de SURROGATE_NEIGHBOURS närmaste i generummet.
+#define SURROGATE_GENES 14
+
+typedef struct {
+    float genes[SURROGATE_GENES];     // scaled so every gene spans about 1
+    float fitness;
+} SurrogateSample;
+
+typedef struct {
+    SurrogateSample *samples;         // ring of SURROGATE_ARCHIVE samples
+    int count;
+    int next;                         // slot the next sample overwrites
+    int maze_id;                      // maze the samples ran on, -1 when empty
+} SurrogateModel;
+
+// Huvudfunktioner
+bool surrogate_init(SurrogateModel *model);
+void surrogate_free(SurrogateModel *model);
+void surrogate_add(SurrogateModel *model, int maze_id, const Chromosome *chromosome, float fitness);
+bool surrogate_ready(const SurrogateModel *model);
+float surrogate_predict(const SurrogateModel *model, const Chromosome *chromosome);
+
+// For breed_population_screened, arg is the SurrogateModel
+float surrogate_score(const Chromosome *chromosome, void *arg);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "configuration.h"
+
+// Tidslinje i Chrome trace-format. Slås på vid kompilering med TRACING=1
+// (cmake -DTRACING=ON). Varje tråd skriver sina händelser till en egen
+// ringbuffert utan lås, och allt skrivs till TRACE_FILE när programmet avslutas.
+// Filen öppnas i Perfetto (ui.perfetto.dev) eller chrome://tracing.
+
+typedef struct {
+    uint64_t timestamp_ns;
+    const char *name;       // must be a string literal, only the pointer is kept
+    int arg;                // shown as "arg" on the slice, -1 for none
+    char phase;             // 'B' begin or 'E' end
+} TraceEvent;
+
+#if TRACING
+
+#define TRACE_BEGIN(name)           trace_event((name), 'B', -1)
+#define TRACE_BEGIN_ARG(name, arg)  trace_event((name), 'B', (arg))
+#define TRACE_END(name)             trace_event((name), 'E', -1)
+#define TRACE_THREAD_NAME(...)      trace_thread_name(__VA_ARGS__)
+#define TRACE_OUTPUT(...)           trace_output(__VA_ARGS__)
+#define TRACE_FLUSH()               trace_flush()
+
+#else
+
+#define TRACE_BEGIN(name)           ((void)0)
+#define TRACE_BEGIN_ARG(name, arg)  ((void)0)
+#define TRACE_END(name)             ((void)0)
+#define TRACE_THREAD_NAME(...)      ((void)0)
+#define TRACE_OUTPUT(...)           ((void)0)
+#define TRACE_FLUSH()               ((void)0)
+
+#endif
+
+// Huvudfunktioner
+void trace_event(const char *name, char phase, int arg);
+void trace_thread_name(const char *format, ...);
+void trace_output(const char *format, ...);   // file written by trace_flush, TRACE_FILE by default
+bool trace_flush(void);
+
+#endif
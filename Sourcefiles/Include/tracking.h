@@ -2,9 +2,9 @@
 #define TRACKING_H
 
 
-#include "../include/types.h"
-#include "../include/configuration.h"
-#include "../include/robot.h"
+#include "../Include/types.h"
+#include "../Include/configuration.h"
+#include "../Include/robot.h"
 
 
 void start_tracking_individual(int id);
@@ -2,6 +2,7 @@
 #define TYPES_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct Chromosome Chromosome;
 typedef struct Individual Individual;
@@ -28,6 +29,7 @@ typedef struct Robot{
     float width, height;
     float angle;
     int orientation;
+    float heading_x, heading_y;   // cos and sin of angle, kept in step with the turns
 } Robot;
 
 typedef struct Individual{
@@ -41,6 +43,11 @@ typedef struct Individual{
     int id;
     int collision_count;
     bool reached_goal;
+    int parents[2];         // indices in the previous generation, -1 for none
+    bool aborted;           // stopped by BOUND_ABORT, fitness is then its upper bound
+    float predicted_fitness;  // surrogate or coarse estimate it was bred on, NAN when not screened
+    float coarse_fitness;     // COARSE_SCREENING: fitness on the cell grid, NAN when not evaluated
+    float novelty;            // NOVELTY_SEARCH: added to the fitness for selection, 0 otherwise
 } Individual;
 
 typedef struct {
@@ -55,7 +62,11 @@ typedef struct {
     int start_x, start_y;
     int goal_x, goal_y;
     int maze_width, maze_height;
+    int maze_id;
     int **maze;
+    uint64_t *solid;        // walls and borders in 8x8 bit tiles, see maze_is_solid
+    int solid_stride;       // tiles per row
+    int *goal_distance;     // steps to the goal per cell (y * width + x), -1 if unreachable
     Sensor sensors[5];
 } Simulationcontext;
 
@@ -2,13 +2,14 @@
 #include <math.h>
 #include <time.h>
 #include <stdio.h>
-#include "../include/configuration.h"
-#include "../include/chromosome.h"
-#include "../include/maze.h"
-#include "../include/robot.h"
+#include "../Include/configuration.h"
+#include "../Include/chromosome.h"
+#include "../Include/maze.h"
+#include "../Include/robot.h"
+#include "../Include/rng.h"
 
 float random_float(float min, float max) {
-    return min + (float)rand() / RAND_MAX * (max - min);
+    return min + rng_float() * (max - min);
 }
 
 int find_best_index(Individual population[POP_SIZE]){
@@ -77,7 +78,7 @@ void mutate_chromosome(Chromosome *chr, float mutation_rate) {
 void crossover_chromosomes(Chromosome *parent1, Chromosome *parent2, 
                           Chromosome *child1, Chromosome *child2) {
     for(int i = 0; i < 5; i++) {
-        if(rand() % 2) {
+        if(rng_int(2)) {
             child1->sensor_weights[i] = parent1->sensor_weights[i];
             child2->sensor_weights[i] = parent2->sensor_weights[i];
         } else {
@@ -87,7 +88,7 @@ void crossover_chromosomes(Chromosome *parent1, Chromosome *parent2,
     }
     
     for(int i = 0; i < 3; i++) {
-        if(rand() % 2) {
+        if(rng_int(2)) {
             child1->distance_thresholds[i] = parent1->distance_thresholds[i];
             child2->distance_thresholds[i] = parent2->distance_thresholds[i];
         } else {
@@ -97,7 +98,7 @@ void crossover_chromosomes(Chromosome *parent1, Chromosome *parent2,
     }
     
     for(int i = 0; i < 4; i++) {
-        if(rand() % 2) {
+        if(rng_int(2)) {
             child1->action_priorities[i] = parent1->action_priorities[i];
             child2->action_priorities[i] = parent2->action_priorities[i];
         } else {
@@ -106,7 +107,7 @@ void crossover_chromosomes(Chromosome *parent1, Chromosome *parent2,
         }
     }
     
-    if(rand() % 2) {
+    if(rng_int(2)) {
         child1->turn_aggressiveness = parent1->turn_aggressiveness;
         child2->turn_aggressiveness = parent2->turn_aggressiveness;
         child1->collision_avoidance = parent1->collision_avoidance;
@@ -119,74 +120,9 @@ void crossover_chromosomes(Chromosome *parent1, Chromosome *parent2,
     }
 }
 
-void elite_selection(Individual old_pop[POP_SIZE], Individual new_pop[POP_SIZE], 
-                     int generation, int *id_counter) {
-    int best1 = 0, best2 = 1;
-    if (old_pop[1].fitness > old_pop[0].fitness) {
-        best1 = 1; best2 = 0;
-    }
-    for (int i = 2; i < POP_SIZE; i++) {
-        if (old_pop[i].fitness > old_pop[best1].fitness) {
-            best2 = best1;
-            best1 = i;
-        } else if (old_pop[i].fitness > old_pop[best2].fitness) {
-            best2 = i;
-        }
-    }
-
-    new_pop[0] = old_pop[best1];
-    new_pop[1] = old_pop[best2];
-    new_pop[0].is_best = 1;
-    new_pop[1].is_best = 0;
-    
-    new_pop[0].reached_goal = false;
-    new_pop[1].reached_goal = false;
-    new_pop[0].collision_count = 0;
-    new_pop[1].collision_count = 0;
-
-    for (int i = 2; i < POP_SIZE; i += 2) {
-        Individual *parent1 = &old_pop[best1];
-        Individual *parent2 = &old_pop[best2];
-
-        Chromosome c1, c2;
-        crossover_chromosomes(&parent1->chromosome, &parent2->chromosome, &c1, &c2);
-        mutate_chromosome(&c1, 0.1f);
-        mutate_chromosome(&c2, 0.1f);
-
-        initialize_robot(&new_pop[i].robot, 1.0f, 1.0f);
-        new_pop[i].chromosome = c1;
-        new_pop[i].active = 1;
-        new_pop[i].id = (*id_counter)++;
-        new_pop[i].generation = generation + 1;
-        new_pop[i].is_best = 0;
-        new_pop[i].reached_goal = false;
-        new_pop[i].collision_count = 0;
-        new_pop[i].fitness = 0;
-        new_pop[i].steps_taken = 0;
-
-        if (i + 1 < POP_SIZE) {
-            initialize_robot(&new_pop[i + 1].robot, 1.0f, 1.0f);
-            new_pop[i + 1].chromosome = c2;
-            new_pop[i + 1].active = 1;
-            new_pop[i + 1].id = (*id_counter)++;
-            new_pop[i + 1].generation = generation + 1;
-            new_pop[i + 1].is_best = 0;
-            new_pop[i + 1].reached_goal = false;
-            new_pop[i + 1].collision_count = 0;
-            new_pop[i + 1].fitness = 0;
-            new_pop[i + 1].steps_taken = 0;
-        }
-    }
-}
-// works on a point system which is based on the sensors and the chromosomes of the indiviudal 
-Action decide_action(Individual *individual, Simulationcontext *context) {
-    Chromosome *chr = &individual->chromosome;
-    float sensor_readings[5];
-
-    for (int i = 0; i < 5; i++) {
-       sensor_readings[i] = simulate_ultrasonic(individual, i, context);
-    }
-
+// works on a point system which is based on the sensors and the chromosomes of the indiviudal.
+// The readings are all it sees, so the same readings always give the same action
+Action decide_action(const Chromosome *chr, const float sensor_readings[5]) {
     float action_scores[4] = {0}; // 0: FORWARD, 1: LEFT, 2: RIGHT, 3: BACKWARD
 
 
@@ -244,30 +180,77 @@ Action decide_action(Individual *individual, Simulationcontext *context) {
     return (Action)best_action;
 }
 
-float calculate_fitness(Individual *individual, int steps_taken, Simulationcontext *context) {
-    Robot *robot = &individual->robot;
-    float base_line = BASE_LINE_FITNESS;
+// The side and diagonal sensors are only compared with the near threshold, so
+// each of them is below, at or above it. FORWARD dominates for a front reading
+// if decide_action picks it for all 81 combinations of those states
+bool forward_dominates(const Chromosome *chr, float front_reading) {
+    const float states[3] = {-INFINITY, chr->distance_thresholds[0], INFINITY};
+    float readings[5] = {front_reading, 0, 0, 0, 0};
+
+    for (int combination = 0; combination < 81; combination++) {
+        int rest = combination;
+        for (int i = 1; i < 5; i++) {
+            readings[i] = states[rest % 3];
+            rest /= 3;
+        }
+        if (decide_action(chr, readings) != FORWARD) return false;
+    }
+    return true;
+}
+
+void fitness_terms(const Individual *individual, int steps_taken, Simulationcontext *context,
+                   FitnessTerms *terms) {
+    const Robot *robot = &individual->robot;
     // weights for the penalties and bonus
     float alpha = 1.0, beta = 0.5, gamma = 0.3, delta = 2.0, epsilon = 10.0;
     
-    float time_penalty = alpha * steps_taken;
-    float energy_penalty = beta * steps_taken * 0.1; // Approximation will change when i start with robot
+    terms->time_penalty = alpha * steps_taken;
+    terms->energy_penalty = beta * steps_taken * 0.1; // Approximation will change when i start with robot
     
 
-    float distance_to_goal = sqrt(pow(robot->x - context->goal_x, 2) + 
-                                  pow(robot->y - context->goal_y, 2));
-    float distance_penalty = gamma * distance_to_goal;
+    float distance_to_goal = maze_goal_distance(context, robot->x, robot->y);
+    terms->distance_penalty = gamma * distance_to_goal;
     
     float number_of_collisons = individual->collision_count;
-    float collison_penalty = delta * number_of_collisons;
+    terms->collision_penalty = delta * number_of_collisons;
     
-    float goal_bonus = 0;
+    terms->goal_bonus = 0;
     if(individual->reached_goal) { 
-        goal_bonus = epsilon * 100;
+        terms->goal_bonus = epsilon * 100;
     }
+}
+
+float calculate_fitness(Individual *individual, int steps_taken, Simulationcontext *context) {
+    float base_line = BASE_LINE_FITNESS;
+    FitnessTerms terms;
+    fitness_terms(individual, steps_taken, context, &terms);
     
     // Higher fitness is better 
-    float fitness = base_line + goal_bonus - (time_penalty + energy_penalty + distance_penalty + collison_penalty);
+    float fitness = base_line + terms.goal_bonus - (terms.time_penalty + terms.energy_penalty +
+                                                    terms.distance_penalty + terms.collision_penalty);
     if (fitness <= 0) fitness = 1.0f;
     return fitness;
-}
\ No newline at end of file
+}
+
+// The highest fitness an active individual can still end with: stopping on
+// the next step with no distance left, or reaching the goal after as few
+// steps as the straight line to it allows. calculate_fitness only falls with
+// more steps, distance and collisions, so no run from here ends higher
+float fitness_upper_bound(const Individual *individual, int max_steps, Simulationcontext *context) {
+    Individual best = *individual;
+    best.robot.x = (float)context->goal_x;
+    best.robot.y = (float)context->goal_y;
+    best.reached_goal = false;
+    float bound = calculate_fitness(&best, individual->steps_taken + 1, context);
+
+    float dx = individual->robot.x - context->goal_x;
+    float dy = individual->robot.y - context->goal_y;
+    float moves = floorf((sqrtf(dx * dx + dy * dy) - GOAL_THRESHOLD) / MOVE_DISTANCE);
+    int steps = individual->steps_taken + (moves > 1 ? (int)moves : 1);
+    if (steps <= max_steps) {
+        best.reached_goal = true;
+        float with_goal = calculate_fitness(&best, steps, context);
+        if (with_goal > bound) bound = with_goal;
+    }
+    return bound;
+}
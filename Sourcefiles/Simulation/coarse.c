@@ -0,0 +1,158 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "../Include/coarse.h"
+#include "../Include/chromosome.h"
+#include "../Include/maze.h"
+
+// Neighbouring cell for each of the eight orientations, in the order of the
+// robot's octants (0 along +x, turning right towards +y)
+static const int CELL_STEPS[8][2] = {
+    { 1, 0}, { 1, 1}, { 0, 1}, {-1, 1},
+    {-1, 0}, {-1,-1}, { 0,-1}, { 1,-1}
+};
+
+typedef struct {
+    int x, y;
+    int octant;
+} CoarsePose;
+
+static bool cell_blocked(const Simulationcontext *context, int x, int y) {
+    return x < 0 || y < 0 || x >= context->maze_width || y >= context->maze_height ||
+           maze_is_solid(context, x, y);
+}
+
+// Distance to the first blocked cell along the octant, one cell length per
+// cell, so a wall next to the robot reads 1 like the full sensor does
+static float cell_reading(const Simulationcontext *context, CoarsePose pose, int octant, float range) {
+    float length = (octant & 1) ? (float)M_SQRT2 : 1.0f;
+    int x = pose.x, y = pose.y;
+    for (float distance = length; distance < range; distance += length) {
+        x += CELL_STEPS[octant][0];
+        y += CELL_STEPS[octant][1];
+        if (cell_blocked(context, x, y)) return distance;
+    }
+    return range;
+}
+
+// Runs the chromosome on the cell grid and returns its fitness. A collision
+// or the goal ends the run like in the full simulation. A pose seen again
+// within REPEAT_WINDOW steps is a loop without either, so the run jumps to
+// where the loop stands after the last step
+float coarse_evaluate(const Chromosome *chromosome, Simulationcontext *context, int max_steps) {
+    int offsets[5];
+    float ranges[5];
+    for (int s = 0; s < 5; s++) {
+        offsets[s] = (int)lroundf(context->sensors[s].angle / (float)(M_PI / 4));
+        ranges[s] = context->sensors[s].range;
+    }
+
+    CoarsePose pose = {.x = context->start_x, .y = context->start_y, .octant = 0};
+    CoarsePose recent[REPEAT_WINDOW];
+    int step = 0, collisions = 0;
+    bool goal = false;
+    while (step < max_steps) {
+        int window = step < REPEAT_WINDOW ? step : REPEAT_WINDOW;
+        int period = 0;
+        for (int p = 1; p <= window && period == 0; p++) {
+            const CoarsePose *seen = &recent[(step - p) % REPEAT_WINDOW];
+            if (seen->x == pose.x && seen->y == pose.y && seen->octant == pose.octant) period = p;
+        }
+        if (period > 0) {
+            pose = recent[(step - period + (max_steps - step) % period) % REPEAT_WINDOW];
+            step = max_steps;
+            break;
+        }
+        recent[step % REPEAT_WINDOW] = pose;
+
+        float readings[5];
+        for (int s = 0; s < 5; s++) {
+            readings[s] = cell_reading(context, pose, (pose.octant + offsets[s] + 8) % 8, ranges[s]);
+        }
+        Action action = decide_action(chromosome, readings);
+        step++;
+
+        if (action == TURN_LEFT_45) {
+            pose.octant = (pose.octant + 7) % 8;
+        } else if (action == TURN_RIGHT_45) {
+            pose.octant = (pose.octant + 1) % 8;
+        } else {
+            int sign = action == BACKWARD ? -1 : 1;
+            int x = pose.x + sign * CELL_STEPS[pose.octant][0];
+            int y = pose.y + sign * CELL_STEPS[pose.octant][1];
+            if (cell_blocked(context, x, y)) {
+                collisions++;
+                break;
+            }
+            pose.x = x;
+            pose.y = y;
+        }
+
+        float dx = (float)(pose.x - context->goal_x), dy = (float)(pose.y - context->goal_y);
+        if (dx * dx + dy * dy <= GOAL_THRESHOLD * GOAL_THRESHOLD) {
+            goal = true;
+            break;
+        }
+    }
+
+    Individual result = {.collision_count = collisions, .reached_goal = goal};
+    result.robot.x = (float)pose.x;
+    result.robot.y = (float)pose.y;
+    return calculate_fitness(&result, step, context);
+}
+
+float coarse_score(const Chromosome *chromosome, void *arg) {
+    return coarse_evaluate(chromosome, (Simulationcontext *)arg, MAX_STEPS);
+}
+
+typedef struct {
+    float value;
+    int index;
+} RankEntry;
+
+static int compare_rank_entries(const void *a, const void *b) {
+    float x = ((const RankEntry *)a)->value, y = ((const RankEntry *)b)->value;
+    return (x > y) - (x < y);
+}
+
+// ranks[i] is the rank of values[i] from 1, tied values share their mean rank
+static bool average_ranks(const float *values, int count, float *ranks) {
+    RankEntry *entries = malloc(count * sizeof(RankEntry));
+    if (!entries) return false;
+    for (int i = 0; i < count; i++) {
+        entries[i].value = values[i];
+        entries[i].index = i;
+    }
+    qsort(entries, count, sizeof(RankEntry), compare_rank_entries);
+    for (int first = 0; first < count;) {
+        int last = first;
+        while (last + 1 < count && entries[last + 1].value == entries[first].value) last++;
+        float rank = (first + last) / 2.0f + 1.0f;
+        for (int i = first; i <= last; i++) ranks[entries[i].index] = rank;
+        first = last + 1;
+    }
+    free(entries);
+    return true;
+}
+
+// Pearson's correlation of the ranks
+float rank_correlation(const float *a, const float *b, int count) {
+    if (count < 2) return NAN;
+    float *ranks = malloc(2 * (size_t)count * sizeof(float));
+    if (!ranks || !average_ranks(a, count, ranks) || !average_ranks(b, count, ranks + count)) {
+        free(ranks);
+        return NAN;
+    }
+    const float *ra = ranks, *rb = ranks + count;
+    double mean = (count + 1) / 2.0;   // the same for both, ties keep the sum
+    double covariance = 0, variance_a = 0, variance_b = 0;
+    for (int i = 0; i < count; i++) {
+        double da = ra[i] - mean, db = rb[i] - mean;
+        covariance += da * db;
+        variance_a += da * da;
+        variance_b += db * db;
+    }
+    free(ranks);
+    if (variance_a <= 0 || variance_b <= 0) return NAN;
+    return (float)(covariance / sqrt(variance_a * variance_b));
+}
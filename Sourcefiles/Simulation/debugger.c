@@ -1,6 +1,6 @@
-#include "../include/debugger.h"
+#include "../Include/debugger.h"
 #include <math.h>
-#include"../include/maze.h"
+#include"../Include/maze.h"
 #include <stdio.h>
 
 void debug_print_individual(const Individual *ind, int step) {
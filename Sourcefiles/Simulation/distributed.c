@@ -0,0 +1,626 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../Include/distributed.h"
+#include "../Include/sims.h"
+#include "../Include/maze.h"
+#include "../Include/robot.h"
+#include "../Include/trace.h"
+
+#ifdef _WIN32
+
+DistCoordinator *coordinator_start(const char *address) {
+    printf("Warning: Distributed evaluation is not supported on Windows (%s)\n", address);
+    return NULL;
+}
+
+void coordinator_stop(DistCoordinator *coordinator) {
+    (void)coordinator;
+}
+
+int coordinator_evaluate(DistCoordinator *coordinator, Simulationcontext *context,
+                         Individual *population, int count,
+                         MovementLog (*movement_logs)[MAX_STEPS], int *movement_counts) {
+    (void)coordinator; (void)context; (void)population; (void)count;
+    (void)movement_logs; (void)movement_counts;
+    return 0;
+}
+
+int worker_run(const char *address) {
+    printf("Distributed workers are not supported on Windows (%s)\n", address);
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define DIST_MAX_WORKERS   64
+#define DIST_FALLBACK_MS   1000   // evaluate locally once no worker has been connected this long
+#define DIST_IO_TIMEOUT_S  30     // a worker that stalls this long mid-message is dropped
+#define DIST_POLL_MS       100
+
+typedef struct {
+    int fd;
+    int maze_id;    // maze the worker holds, -1 for none
+    int batch;      // batch id in flight, -1 when idle
+} DistWorker;
+
+struct DistCoordinator {
+    int listen_fd;
+    char unix_path[108];
+    DistWorker workers[DIST_MAX_WORKERS];
+    int worker_count;
+    int next_batch_id;
+};
+
+typedef struct {
+    bool is_unix;
+    char path[108];
+    char host[256];
+    char port[16];
+} DistAddress;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool read_full(int fd, void *buffer, size_t length) {
+    char *p = buffer;
+    while (length > 0) {
+        ssize_t n = read(fd, p, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void *buffer, size_t length) {
+    const char *p = buffer;
+    while (length > 0) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+static bool send_message(int fd, uint32_t type, const void *head, size_t head_length,
+                         const void *body, size_t body_length) {
+    DistHeader header = {DIST_MAGIC, type, (uint32_t)(head_length + body_length)};
+    return write_full(fd, &header, sizeof(header)) &&
+           (head_length == 0 || write_full(fd, head, head_length)) &&
+           (body_length == 0 || write_full(fd, body, body_length));
+}
+
+static bool read_header(int fd, DistHeader *header) {
+    return read_full(fd, header, sizeof(*header)) && header->magic == DIST_MAGIC;
+}
+
+// "unix:/path/to/socket" or "tcp:[host:]port"
+static bool parse_address(const char *address, DistAddress *out) {
+    memset(out, 0, sizeof(*out));
+    if (strncmp(address, "unix:", 5) == 0) {
+        out->is_unix = true;
+        if (strlen(address + 5) >= sizeof(out->path)) return false;
+        strcpy(out->path, address + 5);
+        return out->path[0] != '\0';
+    }
+    if (strncmp(address, "tcp:", 4) == 0) {
+        const char *rest = address + 4;
+        const char *colon = strrchr(rest, ':');
+        const char *port = colon ? colon + 1 : rest;
+        size_t host_length = colon ? (size_t)(colon - rest) : 0;
+        if (host_length >= sizeof(out->host) || strlen(port) >= sizeof(out->port)) return false;
+        memcpy(out->host, rest, host_length);
+        strcpy(out->port, port);
+        return out->port[0] != '\0';
+    }
+    return false;
+}
+
+static int open_socket(const DistAddress *address, bool listening) {
+    if (address->is_unix) {
+        struct sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", address->path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (listening) {
+            // left behind by a coordinator that did not stop cleanly
+            unlink(address->path);
+            if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0 || listen(fd, 16) != 0) {
+                close(fd);
+                return -1;
+            }
+        } else if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    struct addrinfo hints, *found;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (listening) hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(address->host[0] ? address->host : NULL, address->port, &hints, &found) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = found; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 16) == 0) break;
+        } else if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(found);
+    return fd;
+}
+
+// Coordinator
+
+DistCoordinator *coordinator_start(const char *address) {
+    DistAddress parsed;
+    if (!parse_address(address, &parsed)) {
+        printf("Warning: Invalid coordinator address %s\n", address);
+        return NULL;
+    }
+    // a worker that disappears must not take the coordinator with it
+    signal(SIGPIPE, SIG_IGN);
+
+    DistCoordinator *coordinator = calloc(1, sizeof(DistCoordinator));
+    if (!coordinator) return NULL;
+    coordinator->listen_fd = open_socket(&parsed, true);
+    if (coordinator->listen_fd < 0) {
+        printf("Warning: Could not listen on %s\n", address);
+        free(coordinator);
+        return NULL;
+    }
+    fcntl(coordinator->listen_fd, F_SETFL, fcntl(coordinator->listen_fd, F_GETFL) | O_NONBLOCK);
+    if (parsed.is_unix) {
+        strcpy(coordinator->unix_path, parsed.path);
+    }
+
+    printf("Coordinator listening on %s\n", address);
+    return coordinator;
+}
+
+void coordinator_stop(DistCoordinator *coordinator) {
+    if (!coordinator) return;
+    for (int i = 0; i < coordinator->worker_count; i++) {
+        send_message(coordinator->workers[i].fd, DIST_BYE, NULL, 0, NULL, 0);
+        close(coordinator->workers[i].fd);
+    }
+    close(coordinator->listen_fd);
+    if (coordinator->unix_path[0]) {
+        unlink(coordinator->unix_path);
+    }
+    free(coordinator);
+}
+
+static void accept_workers(DistCoordinator *coordinator) {
+    while (coordinator->worker_count < DIST_MAX_WORKERS) {
+        int fd = accept(coordinator->listen_fd, NULL, NULL);
+        if (fd < 0) return;
+
+        // workers are served with blocking reads, bounded by a timeout
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        struct timeval timeout = {DIST_IO_TIMEOUT_S, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        DistWorker *worker = &coordinator->workers[coordinator->worker_count++];
+        worker->fd = fd;
+        worker->maze_id = -1;
+        worker->batch = -1;
+        printf("Worker connected (%d connected)\n", coordinator->worker_count);
+    }
+}
+
+// Closes workers marked with fd -1 and puts their batches back in the queue
+static void drop_lost_workers(DistCoordinator *coordinator, unsigned char *state, int first_batch_id) {
+    int kept = 0;
+    for (int i = 0; i < coordinator->worker_count; i++) {
+        DistWorker *worker = &coordinator->workers[i];
+        if (worker->fd >= 0) {
+            coordinator->workers[kept++] = *worker;
+            continue;
+        }
+        if (worker->batch >= 0) {
+            state[worker->batch - first_batch_id] = 0;
+            printf("Worker lost, batch %d requeued\n", worker->batch);
+        } else {
+            printf("Worker lost\n");
+        }
+    }
+    coordinator->worker_count = kept;
+}
+
+static void lose_worker(DistWorker *worker) {
+    close(worker->fd);
+    worker->fd = -1;
+}
+
+static bool send_maze(DistWorker *worker, Simulationcontext *context) {
+    int w = context->maze_width, h = context->maze_height;
+    unsigned char *cells = malloc((size_t)w * h);
+    if (!cells) return false;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            cells[(size_t)y * w + x] = (unsigned char)context->maze[y][x];
+        }
+    }
+
+    DistMazeHeader header = {
+        .maze_id = context->maze_id,
+        .width = w, .height = h,
+        .start_x = context->start_x, .start_y = context->start_y,
+        .goal_x = context->goal_x, .goal_y = context->goal_y,
+    };
+    memcpy(header.sensors, context->sensors, sizeof(header.sensors));
+
+    bool ok = send_message(worker->fd, DIST_MAZE, &header, sizeof(header), cells, (size_t)w * h);
+    free(cells);
+    if (ok) worker->maze_id = context->maze_id;
+    return ok;
+}
+
+static bool send_batch(DistWorker *worker, Simulationcontext *context, Individual *population,
+                       int count, int batch_index, int batch_id, bool with_movements) {
+    if (worker->maze_id != context->maze_id && !send_maze(worker, context)) return false;
+
+    int start = batch_index * DIST_BATCH_SIZE;
+    int n = count - start < DIST_BATCH_SIZE ? count - start : DIST_BATCH_SIZE;
+    Chromosome chromosomes[DIST_BATCH_SIZE];
+    for (int i = 0; i < n; i++) {
+        chromosomes[i] = population[start + i].chromosome;
+    }
+
+    DistBatchHeader header = {batch_id, context->maze_id, n, with_movements};
+    if (!send_message(worker->fd, DIST_BATCH, &header, sizeof(header),
+                      chromosomes, n * sizeof(Chromosome))) {
+        return false;
+    }
+    worker->batch = batch_id;
+    return true;
+}
+
+static void apply_result(Individual *individual, const DistResult *result) {
+    individual->fitness = result->fitness;
+    individual->steps_taken = result->steps_taken;
+    individual->collision_count = result->collision_count;
+    individual->reached_goal = result->reached_goal != 0;
+    individual->robot.x = result->final_x;
+    individual->robot.y = result->final_y;
+    individual->robot.angle = result->final_angle;
+    update_orientation(&individual->robot);
+    individual->active = 0;
+}
+
+static bool receive_results(DistWorker *worker, int batch_index, Individual *population, int count,
+                            MovementLog (*movement_logs)[MAX_STEPS], int *movement_counts,
+                            int *goals) {
+    int start = batch_index * DIST_BATCH_SIZE;
+    int n = count - start < DIST_BATCH_SIZE ? count - start : DIST_BATCH_SIZE;
+
+    DistHeader header;
+    DistResultsHeader results_header;
+    DistResult results[DIST_BATCH_SIZE];
+    if (!read_header(worker->fd, &header) || header.type != DIST_RESULTS) return false;
+    if (!read_full(worker->fd, &results_header, sizeof(results_header))) return false;
+    if (results_header.batch_id != worker->batch || results_header.count != n) return false;
+    if (!read_full(worker->fd, results, n * sizeof(DistResult))) return false;
+
+    size_t expected = sizeof(results_header) + n * sizeof(DistResult);
+    for (int i = 0; i < n; i++) {
+        if (results[i].movement_count < 0 || results[i].movement_count > MAX_STEPS) return false;
+        if (movement_logs) expected += results[i].movement_count * sizeof(MovementLog);
+    }
+    if (header.length != expected) return false;
+
+    for (int i = 0; i < n; i++) {
+        if (movement_logs) {
+            if (!read_full(worker->fd, movement_logs[start + i],
+                           results[i].movement_count * sizeof(MovementLog))) {
+                return false;
+            }
+            movement_counts[start + i] = results[i].movement_count;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        apply_result(&population[start + i], &results[i]);
+        if (results[i].reached_goal) (*goals)++;
+    }
+    worker->batch = -1;
+    return true;
+}
+
+static int evaluate_batch_locally(Simulationcontext *context, Individual *population, int count,
+                                  int batch_index, MovementLog (*movement_logs)[MAX_STEPS],
+                                  int *movement_counts) {
+    int start = batch_index * DIST_BATCH_SIZE;
+    int end = start + DIST_BATCH_SIZE < count ? start + DIST_BATCH_SIZE : count;
+    int goals = 0;
+    TRACE_BEGIN_ARG("local batch", batch_index);
+    for (int i = start; i < end; i++) {
+        int moves = 0;
+        evaluate_individual(context, &population[i], MAX_STEPS, movement_logs ? movement_logs[i] : NULL, &moves);
+        if (movement_counts) movement_counts[i] = moves;
+        if (population[i].reached_goal) goals++;
+    }
+    TRACE_END("local batch");
+    return goals;
+}
+
+// Evaluates the population on the connected workers and returns the number
+// of individuals that reached the goal. Batches of lost workers go back in
+// the queue; without any worker the coordinator evaluates them itself.
+int coordinator_evaluate(DistCoordinator *coordinator, Simulationcontext *context,
+                         Individual *population, int count,
+                         MovementLog (*movement_logs)[MAX_STEPS], int *movement_counts) {
+    int batch_count = (count + DIST_BATCH_SIZE - 1) / DIST_BATCH_SIZE;
+    int first_batch_id = coordinator->next_batch_id;
+    coordinator->next_batch_id += batch_count;
+
+    unsigned char *state = calloc(batch_count, 1);   // 0 queued, 1 sent, 2 done
+    if (!state) {
+        int goals = 0;
+        for (int b = 0; b < batch_count; b++) {
+            goals += evaluate_batch_locally(context, population, count, b, movement_logs, movement_counts);
+        }
+        return goals;
+    }
+
+    int done = 0, goals = 0;
+    long long unattended_since = now_ms();
+    while (done < batch_count) {
+        accept_workers(coordinator);
+
+        // hand queued batches to idle workers
+        int queued = 0;
+        for (int w = 0; w < coordinator->worker_count; w++) {
+            DistWorker *worker = &coordinator->workers[w];
+            if (worker->batch >= 0) continue;
+            while (queued < batch_count && state[queued] != 0) queued++;
+            if (queued == batch_count) break;
+            if (send_batch(worker, context, population, count, queued,
+                           first_batch_id + queued, movement_logs != NULL)) {
+                state[queued] = 1;
+            } else {
+                lose_worker(worker);
+            }
+        }
+        drop_lost_workers(coordinator, state, first_batch_id);
+
+        if (coordinator->worker_count > 0) {
+            unattended_since = now_ms();
+        } else if (now_ms() - unattended_since >= DIST_FALLBACK_MS) {
+            // nobody to send to, so keep the run going here
+            for (int b = 0; b < batch_count; b++) {
+                if (state[b] != 0) continue;
+                goals += evaluate_batch_locally(context, population, count, b,
+                                                movement_logs, movement_counts);
+                state[b] = 2;
+                done++;
+                break;
+            }
+            continue;
+        }
+
+        struct pollfd fds[DIST_MAX_WORKERS + 1];
+        int owners[DIST_MAX_WORKERS + 1];
+        int nfds = 0;
+        fds[nfds].fd = coordinator->listen_fd;
+        fds[nfds].events = POLLIN;
+        owners[nfds++] = -1;
+        for (int w = 0; w < coordinator->worker_count; w++) {
+            if (coordinator->workers[w].batch < 0) continue;
+            fds[nfds].fd = coordinator->workers[w].fd;
+            fds[nfds].events = POLLIN;
+            owners[nfds++] = w;
+        }
+        TRACE_BEGIN("wait for workers");
+        int ready = poll(fds, nfds, DIST_POLL_MS);
+        TRACE_END("wait for workers");
+        if (ready <= 0) continue;
+
+        for (int i = 1; i < nfds; i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            DistWorker *worker = &coordinator->workers[owners[i]];
+            int batch_index = worker->batch - first_batch_id;
+            if (receive_results(worker, batch_index, population, count,
+                                movement_logs, movement_counts, &goals)) {
+                state[batch_index] = 2;
+                done++;
+            } else {
+                lose_worker(worker);
+            }
+        }
+        drop_lost_workers(coordinator, state, first_batch_id);
+    }
+
+    free(state);
+    return goals;
+}
+
+// Worker
+
+static bool receive_maze(int fd, uint32_t length, Simulationcontext *context) {
+    DistMazeHeader header;
+    if (length < sizeof(header) || !read_full(fd, &header, sizeof(header))) return false;
+    if (header.width <= 2 || header.height <= 2 ||
+        length != sizeof(header) + (size_t)header.width * header.height) {
+        return false;
+    }
+
+    unsigned char *cells = malloc((size_t)header.width * header.height);
+    if (!cells) return false;
+    if (!read_full(fd, cells, (size_t)header.width * header.height)) {
+        free(cells);
+        return false;
+    }
+
+    maze_release(context);
+    context->maze = create_matrix(header.height, header.width);
+    for (int y = 0; y < header.height; y++) {
+        for (int x = 0; x < header.width; x++) {
+            context->maze[y][x] = cells[(size_t)y * header.width + x];
+        }
+    }
+    free(cells);
+
+    context->maze_id = header.maze_id;
+    context->maze_width = header.width;
+    context->maze_height = header.height;
+    context->start_x = header.start_x;
+    context->start_y = header.start_y;
+    context->goal_x = header.goal_x;
+    context->goal_y = header.goal_y;
+    memcpy(context->sensors, header.sensors, sizeof(context->sensors));
+    maze_prepare(context, NULL);
+    return true;
+}
+
+static bool serve_batch(int fd, uint32_t length, Simulationcontext *context,
+                        MovementLog (*movement_logs)[MAX_STEPS]) {
+    DistBatchHeader header;
+    Chromosome chromosomes[DIST_BATCH_SIZE];
+    DistResult results[DIST_BATCH_SIZE];
+
+    if (length < sizeof(header) || !read_full(fd, &header, sizeof(header))) return false;
+    if (header.count <= 0 || header.count > DIST_BATCH_SIZE ||
+        length != sizeof(header) + header.count * sizeof(Chromosome)) {
+        return false;
+    }
+    if (!read_full(fd, chromosomes, header.count * sizeof(Chromosome))) return false;
+    if (!context->maze || header.maze_id != context->maze_id) {
+        printf("Batch %d is for maze %d, which was never received\n", header.batch_id, header.maze_id);
+        return false;
+    }
+
+    size_t reply_length = sizeof(DistResultsHeader) + header.count * sizeof(DistResult);
+    TRACE_BEGIN_ARG("batch", header.batch_id);
+    for (int i = 0; i < header.count; i++) {
+        Individual individual;
+        memset(&individual, 0, sizeof(individual));
+        individual.chromosome = chromosomes[i];
+        individual.active = 1;
+        initialize_robot(&individual.robot, (float)context->start_x, (float)context->start_y);
+
+        int moves = 0;
+        evaluate_individual(context, &individual, MAX_STEPS, movement_logs[i], &moves);
+
+        results[i].fitness = individual.fitness;
+        results[i].steps_taken = individual.steps_taken;
+        results[i].collision_count = individual.collision_count;
+        results[i].reached_goal = individual.reached_goal;
+        results[i].final_x = individual.robot.x;
+        results[i].final_y = individual.robot.y;
+        results[i].final_angle = individual.robot.angle;
+        results[i].movement_count = header.with_movements ? moves : 0;
+        reply_length += results[i].movement_count * sizeof(MovementLog);
+    }
+    TRACE_END("batch");
+
+    DistHeader reply = {DIST_MAGIC, DIST_RESULTS, (uint32_t)reply_length};
+    DistResultsHeader results_header = {header.batch_id, header.count};
+    if (!write_full(fd, &reply, sizeof(reply)) ||
+        !write_full(fd, &results_header, sizeof(results_header)) ||
+        !write_full(fd, results, header.count * sizeof(DistResult))) {
+        return false;
+    }
+    for (int i = 0; i < header.count; i++) {
+        if (results[i].movement_count > 0 &&
+            !write_full(fd, movement_logs[i], results[i].movement_count * sizeof(MovementLog))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int worker_run(const char *address) {
+    DistAddress parsed;
+    if (!parse_address(address, &parsed)) {
+        printf("Invalid coordinator address %s\n", address);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    TRACE_THREAD_NAME("worker");
+    TRACE_OUTPUT("robot_trace.worker%d.json", (int)getpid());
+
+    MovementLog (*movement_logs)[MAX_STEPS] = malloc(DIST_BATCH_SIZE * sizeof(*movement_logs));
+    if (!movement_logs) return 1;
+    Simulationcontext context;
+    memset(&context, 0, sizeof(context));
+
+    bool waiting = false;
+    while (true) {
+        int fd = open_socket(&parsed, false);
+        if (fd < 0) {
+            if (!waiting) {
+                printf("Waiting for coordinator on %s\n", address);
+                fflush(stdout);
+                waiting = true;
+            }
+            sleep(1);
+            continue;
+        }
+        waiting = false;
+        printf("Connected to coordinator on %s\n", address);
+        fflush(stdout);
+
+        // a new coordinator knows nothing about the maze held from the last one
+        context.maze_id = -1;
+        int batches = 0;
+        DistHeader header;
+        while (read_header(fd, &header)) {
+            bool ok = false;
+            if (header.type == DIST_MAZE) {
+                ok = receive_maze(fd, header.length, &context);
+            } else if (header.type == DIST_BATCH) {
+                ok = serve_batch(fd, header.length, &context, movement_logs);
+                batches++;
+            }
+            if (!ok) break;
+        }
+        close(fd);
+        TRACE_FLUSH();
+        printf("Coordinator disconnected after %d batches\n", batches);
+        fflush(stdout);
+    }
+}
+
+#endif
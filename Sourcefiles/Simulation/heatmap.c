@@ -0,0 +1,324 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../Include/configuration.h"
+#include "../Include/heatmap.h"
+#include "../Include/manifest.h"
+#include "../Include/types.h"
+
+void heatmap_records_path(const char *log_filename, char *out, size_t size) {
+    log_derived_path(log_filename, ".heatmaps.bin", out, size);
+}
+
+void heatmap_totals_path(const char *log_filename, char *out, size_t size) {
+    log_derived_path(log_filename, ".heatmap_totals.bin", out, size);
+}
+
+static void grid_free(HeatmapGrid *grid) {
+    free(grid->layout);
+    free(grid->counts);
+    grid->layout = NULL;
+    grid->counts = NULL;
+    grid->width = 0;
+    grid->height = 0;
+}
+
+// Makes the grid width x height; the counts are cleared if the size changed
+static bool grid_resize(HeatmapGrid *grid, int kind, int phase, int width, int height) {
+    grid->kind = kind;
+    grid->phase = phase;
+    if (grid->width == width && grid->height == height && grid->counts) return true;
+
+    grid_free(grid);
+    size_t cells = (size_t)width * height;
+    grid->layout = calloc(cells, 1);
+    grid->counts = calloc(cells, sizeof(unsigned int));
+    if (!grid->layout || !grid->counts) {
+        grid_free(grid);
+        return false;
+    }
+    grid->width = width;
+    grid->height = height;
+    return true;
+}
+
+static void grid_add(HeatmapGrid *dest, const HeatmapGrid *src) {
+    size_t cells = (size_t)dest->width * dest->height;
+    for (size_t i = 0; i < cells; i++) {
+        dest->counts[i] += src->counts[i];
+    }
+    memcpy(dest->layout, src->layout, cells);
+    dest->generation = src->generation;
+}
+
+static bool grid_write(FILE *f, const HeatmapGrid *grid) {
+    int header[6] = {HEATMAP_MAGIC, grid->kind, grid->generation, grid->phase,
+                     grid->width, grid->height};
+    size_t cells = (size_t)grid->width * grid->height;
+    return fwrite(header, sizeof(int), 6, f) == 6 &&
+           fwrite(grid->layout, 1, cells, f) == cells &&
+           fwrite(grid->counts, sizeof(unsigned int), cells, f) == cells;
+}
+
+static bool grid_read(FILE *f, HeatmapGrid *grid) {
+    int header[6];
+    if (fread(header, sizeof(int), 6, f) != 6 || header[0] != HEATMAP_MAGIC) return false;
+    if (header[4] <= 0 || header[5] <= 0) return false;
+    if (!grid_resize(grid, header[1], header[3], header[4], header[5])) return false;
+    grid->generation = header[2];
+
+    size_t cells = (size_t)grid->width * grid->height;
+    return fread(grid->layout, 1, cells, f) == cells &&
+           fread(grid->counts, sizeof(unsigned int), cells, f) == cells;
+}
+
+// Picks up the overall, best and phase grids of an earlier session
+static void load_totals(HeatmapAccumulator *acc) {
+    FILE *f = fopen(acc->totals_path, "rb");
+    if (!f) return;
+
+    HeatmapGrid grid = {0};
+    while (grid_read(f, &grid)) {
+        HeatmapGrid *dest = NULL;
+        if (grid.kind == HEATMAP_OVERALL) dest = &acc->overall;
+        else if (grid.kind == HEATMAP_BEST) dest = &acc->best;
+        else if (grid.kind == HEATMAP_PHASE && grid.phase >= 0 && grid.phase < HEATMAP_MAX_PHASES)
+            dest = &acc->phases[grid.phase];
+
+        if (dest) {
+            grid_free(dest);
+            *dest = grid;
+            memset(&grid, 0, sizeof(grid));
+        }
+    }
+    grid_free(&grid);
+    fclose(f);
+}
+
+static void save_totals(HeatmapAccumulator *acc) {
+    char tmp_path[LOG_PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", acc->totals_path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return;
+
+    bool ok = true;
+    if (acc->overall.counts) ok = ok && grid_write(f, &acc->overall);
+    if (acc->best.counts) ok = ok && grid_write(f, &acc->best);
+    for (int p = 0; p < HEATMAP_MAX_PHASES; p++) {
+        if (acc->phases[p].counts) ok = ok && grid_write(f, &acc->phases[p]);
+    }
+    if (fclose(f) != 0 || !ok) {
+        remove(tmp_path);
+        printf("Warning: Could not write heatmap totals\n");
+        return;
+    }
+#ifdef _WIN32
+    remove(acc->totals_path);
+#endif
+    rename(tmp_path, acc->totals_path);
+}
+
+HeatmapAccumulator *heatmap_create(const char *log_filename, int lane_count) {
+    HeatmapAccumulator *acc = calloc(1, sizeof(HeatmapAccumulator));
+    if (!acc) return NULL;
+
+    acc->lanes = calloc(lane_count, sizeof(unsigned int *));
+    if (!acc->lanes) {
+        free(acc);
+        return NULL;
+    }
+    acc->lane_count = lane_count;
+    heatmap_records_path(log_filename, acc->records_path, sizeof(acc->records_path));
+    heatmap_totals_path(log_filename, acc->totals_path, sizeof(acc->totals_path));
+
+    load_totals(acc);
+    return acc;
+}
+
+// Length of the records before the first one of start_generation or later,
+// or before a record cut short. -1 when every record is kept
+static long records_kept_length(FILE *f, int start_generation) {
+    if (fseek(f, 0, SEEK_END) != 0) return -1;
+    long size = ftell(f);
+    rewind(f);
+
+    long offset = 0;
+    int header[6];
+    while (offset < size) {
+        if (fread(header, sizeof(int), 6, f) != 6 || header[0] != HEATMAP_MAGIC ||
+            header[4] <= 0 || header[5] <= 0 || header[2] >= start_generation) {
+            return offset;
+        }
+        long cells = (long)header[4] * header[5];
+        long end = offset + 6 * (long)sizeof(int) + cells * (1 + (long)sizeof(unsigned int));
+        if (end > size || fseek(f, end, SEEK_SET) != 0) return offset;
+        offset = end;
+    }
+    return -1;
+}
+
+// stdio cannot truncate, so the kept records are copied to a new file
+void heatmap_resume(HeatmapAccumulator *acc, int start_generation) {
+    if (!acc) return;
+    FILE *f = fopen(acc->records_path, "rb");
+    if (!f) return;
+    long kept = records_kept_length(f, start_generation);
+    if (kept < 0) {
+        fclose(f);
+        return;
+    }
+
+    char tmp_path[LOG_PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", acc->records_path);
+    FILE *out = fopen(tmp_path, "wb");
+    bool ok = out != NULL && fseek(f, 0, SEEK_SET) == 0;
+    char buffer[64 * 1024];
+    for (long left = kept; ok && left > 0;) {
+        size_t chunk = left < (long)sizeof(buffer) ? (size_t)left : sizeof(buffer);
+        ok = fread(buffer, 1, chunk, f) == chunk && fwrite(buffer, 1, chunk, out) == chunk;
+        left -= (long)chunk;
+    }
+    fclose(f);
+    if (out && fclose(out) != 0) ok = false;
+    if (!ok) {
+        remove(tmp_path);
+        printf("Warning: Could not drop the heatmaps from generation %d on, they will be duplicated\n",
+               start_generation);
+        return;
+    }
+#ifdef _WIN32
+    remove(acc->records_path);
+#endif
+    rename(tmp_path, acc->records_path);
+}
+
+void heatmap_destroy(HeatmapAccumulator *acc) {
+    if (!acc) return;
+    if (acc->totals_dirty) save_totals(acc);
+    for (int i = 0; i < acc->lane_count; i++) {
+        free(acc->lanes[i]);
+    }
+    free(acc->lanes);
+    grid_free(&acc->current);
+    grid_free(&acc->overall);
+    grid_free(&acc->best);
+    for (int p = 0; p < HEATMAP_MAX_PHASES; p++) {
+        grid_free(&acc->phases[p]);
+    }
+    free(acc);
+}
+
+void heatmap_begin_generation(HeatmapAccumulator *acc, Simulationcontext *context,
+                              int generation, int phase) {
+    if (!acc) return;
+    int w = context->maze_width, h = context->maze_height;
+    size_t cells = (size_t)w * h;
+
+    if (acc->width != w || acc->height != h) {
+        for (int i = 0; i < acc->lane_count; i++) {
+            free(acc->lanes[i]);
+            acc->lanes[i] = malloc(cells * sizeof(unsigned int));
+            if (!acc->lanes[i]) {
+                printf("Warning: Could not allocate heatmap lane %d, its visits are not counted\n", i);
+            }
+        }
+        acc->width = w;
+        acc->height = h;
+    }
+    for (int i = 0; i < acc->lane_count; i++) {
+        if (acc->lanes[i]) memset(acc->lanes[i], 0, cells * sizeof(unsigned int));
+    }
+
+    if (!grid_resize(&acc->current, HEATMAP_GENERATION, phase, w, h)) return;
+    memset(acc->current.counts, 0, cells * sizeof(unsigned int));
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            acc->current.layout[(size_t)y * w + x] = (unsigned char)context->maze[y][x];
+        }
+    }
+    acc->current.generation = generation;
+    acc->generation = generation;
+    acc->phase = phase;
+}
+
+// Same cell mapping as the python heatmaps: nearest cell, clamped to the maze
+void heatmap_visit(HeatmapAccumulator *acc, int lane, float x, float y) {
+    unsigned int *counts = acc->lanes[lane];
+    if (!counts) return;
+
+    int cx = (int)floorf(x + 0.5f);
+    int cy = (int)floorf(y + 0.5f);
+    if (cx < 0) cx = 0;
+    if (cx >= acc->width) cx = acc->width - 1;
+    if (cy < 0) cy = 0;
+    if (cy >= acc->height) cy = acc->height - 1;
+    counts[(size_t)cy * acc->width + cx]++;
+}
+
+void heatmap_end_generation(HeatmapAccumulator *acc, const MovementLog *best_movements,
+                            int best_movement_count) {
+    if (!acc || !acc->current.counts) return;
+    int w = acc->width, h = acc->height;
+    size_t cells = (size_t)w * h;
+
+    // Merge the worker lanes
+    for (int i = 0; i < acc->lane_count; i++) {
+        const unsigned int *lane = acc->lanes[i];
+        if (!lane) continue;
+        for (size_t c = 0; c < cells; c++) {
+            acc->current.counts[c] += lane[c];
+        }
+    }
+
+    // A grid of a large maze is several bytes per cell, too much to append
+    // every generation; those runs keep the totals only
+    bool large = cells > HEATMAP_RECORD_MAX_CELLS;
+    FILE *f = large ? NULL : fopen(acc->records_path, "ab");
+    if (f) {
+        if (!grid_write(f, &acc->current)) {
+            printf("Warning: Could not write heatmap for generation %d\n", acc->generation);
+        }
+        fclose(f);
+    }
+
+    // Overall spans every maze of this size and is drawn over the latest one
+    if (grid_resize(&acc->overall, HEATMAP_OVERALL, -1, w, h)) {
+        grid_add(&acc->overall, &acc->current);
+    }
+
+    // A phase grid follows the maze of its phase and restarts with a new one
+    if (acc->phase >= 0 && acc->phase < HEATMAP_MAX_PHASES) {
+        HeatmapGrid *phase = &acc->phases[acc->phase];
+        bool same_maze = phase->counts && phase->width == w && phase->height == h &&
+                         memcmp(phase->layout, acc->current.layout, cells) == 0;
+        if (grid_resize(phase, HEATMAP_PHASE, acc->phase, w, h)) {
+            if (!same_maze) memset(phase->counts, 0, cells * sizeof(unsigned int));
+            grid_add(phase, &acc->current);
+        }
+    }
+
+    // The best individual is only known now, so its cells come from its log
+    if (grid_resize(&acc->best, HEATMAP_BEST, -1, w, h)) {
+        for (int i = 0; i < best_movement_count; i++) {
+            int cx = (int)floorf(best_movements[i].x + 0.5f);
+            int cy = (int)floorf(best_movements[i].y + 0.5f);
+            if (cx < 0) cx = 0;
+            if (cx >= w) cx = w - 1;
+            if (cy < 0) cy = 0;
+            if (cy >= h) cy = h - 1;
+            acc->best.counts[(size_t)cy * w + cx]++;
+        }
+        memcpy(acc->best.layout, acc->current.layout, cells);
+        acc->best.generation = acc->generation;
+    }
+
+    // and rewrite the totals once per log segment instead of every generation
+    acc->totals_dirty = true;
+    if (!large || (acc->generation + 1) % LOG_SEGMENT_GENERATIONS == 0) {
+        save_totals(acc);
+        acc->totals_dirty = false;
+    }
+}
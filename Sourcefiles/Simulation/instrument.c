@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../Include/instrument.h"
+
+_Thread_local InstrumentStats instrument_stats;
+
+#if INSTRUMENTATION
+// Tick rate, measured against the monotonic clock since the first reset
+static _Thread_local uint64_t calibration_ticks;
+static _Thread_local double calibration_ns;
+
+static double monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+#endif
+
+void instrument_reset(void) {
+    uint64_t step_clock = instrument_stats.step_clock;
+    memset(&instrument_stats, 0, sizeof(instrument_stats));
+    instrument_stats.step_clock = step_clock;
+#if INSTRUMENTATION
+    if (calibration_ns == 0) {
+        calibration_ticks = instrument_ticks();
+        calibration_ns = monotonic_ns();
+    }
+#endif
+}
+
+void instrument_report(InstrumentReport *report) {
+    memset(report, 0, sizeof(*report));
+    memcpy(report->counters, instrument_stats.counters, sizeof(report->counters));
+#if INSTRUMENTATION
+    double ns_per_tick = 1.0;
+    uint64_t ticks = instrument_ticks() - calibration_ticks;
+    if (ticks > 0 && calibration_ns > 0) {
+        ns_per_tick = (monotonic_ns() - calibration_ns) / (double)ticks;
+    }
+    for (int t = 0; t < INSTR_TIMER_COUNT; t++) {
+        double scale = (t <= INSTR_MOVEMENT) ? INSTRUMENT_SAMPLE_INTERVAL : 1;
+        report->ms[t] = (double)instrument_stats.ticks[t] * ns_per_tick * scale / 1e6;
+    }
+#endif
+}
+
+// One line for the console, next to the generation results
+void instrument_format(const InstrumentReport *r, char *out, size_t size) {
+    const double *ms = r->ms;
+    double step_ms = ms[INSTR_SENSORS] + ms[INSTR_DECISION] + ms[INSTR_MOVEMENT];
+    if (step_ms <= 0) step_ms = 1;
+    snprintf(out, size,
+             "simulate %.2f ms (sensors %.0f%%, decision %.0f%%, movement %.0f%%), fitness %.2f ms, "
+             "log %.2f ms, evolve %.2f ms, maze %.2f ms | steps %llu, raycast cells %llu, "
+             "collisions %llu, early stops %llu, goals %llu, straight-run steps %llu, replayed steps %llu, shared steps %llu, logged %.1f kB",
+             ms[INSTR_SIMULATE], 100.0 * ms[INSTR_SENSORS] / step_ms,
+             100.0 * ms[INSTR_DECISION] / step_ms, 100.0 * ms[INSTR_MOVEMENT] / step_ms,
+             ms[INSTR_FITNESS], ms[INSTR_LOGGING], ms[INSTR_EVOLVE], ms[INSTR_MAZE],
+             (unsigned long long)r->counters[INSTR_STEPS],
+             (unsigned long long)r->counters[INSTR_RAYCAST_CELLS],
+             (unsigned long long)r->counters[INSTR_COLLISIONS],
+             (unsigned long long)r->counters[INSTR_EARLY_TERMINATIONS],
+             (unsigned long long)r->counters[INSTR_GOALS_REACHED],
+             (unsigned long long)r->counters[INSTR_STRAIGHT_RUN_STEPS],
+             (unsigned long long)r->counters[INSTR_REPLAYED_STEPS],
+             (unsigned long long)r->counters[INSTR_SHARED_STEPS],
+             r->counters[INSTR_BYTES_LOGGED] / 1024.0);
+}
+
+// Single-line object for the run log
+void instrument_format_json(const InstrumentReport *r, char *out, size_t size) {
+    const double *ms = r->ms;
+    snprintf(out, size,
+             "{\"sensors_ms\": %.3f, \"decision_ms\": %.3f, \"movement_ms\": %.3f, "
+             "\"fitness_ms\": %.3f, \"simulate_ms\": %.3f, \"logging_ms\": %.3f, "
+             "\"evolve_ms\": %.3f, \"maze_ms\": %.3f, \"steps\": %llu, \"raycast_cells\": %llu, "
+             "\"collisions\": %llu, \"early_terminations\": %llu, \"goals_reached\": %llu, \"straight_run_steps\": %llu, \"replayed_steps\": %llu, "
+             "\"shared_steps\": %llu, \"bytes_logged\": %llu}",
+             ms[INSTR_SENSORS], ms[INSTR_DECISION], ms[INSTR_MOVEMENT], ms[INSTR_FITNESS],
+             ms[INSTR_SIMULATE], ms[INSTR_LOGGING], ms[INSTR_EVOLVE], ms[INSTR_MAZE],
+             (unsigned long long)r->counters[INSTR_STEPS],
+             (unsigned long long)r->counters[INSTR_RAYCAST_CELLS],
+             (unsigned long long)r->counters[INSTR_COLLISIONS],
+             (unsigned long long)r->counters[INSTR_EARLY_TERMINATIONS],
+             (unsigned long long)r->counters[INSTR_GOALS_REACHED],
+             (unsigned long long)r->counters[INSTR_STRAIGHT_RUN_STEPS],
+             (unsigned long long)r->counters[INSTR_REPLAYED_STEPS],
+             (unsigned long long)r->counters[INSTR_SHARED_STEPS],
+             (unsigned long long)r->counters[INSTR_BYTES_LOGGED]);
+}
+
+void instrument_drain(InstrumentStats *total) {
+    for (int c = 0; c < INSTR_COUNTER_COUNT; c++) {
+        total->counters[c] += instrument_stats.counters[c];
+        instrument_stats.counters[c] = 0;
+    }
+    for (int t = 0; t < INSTR_TIMER_COUNT; t++) {
+        total->ticks[t] += instrument_stats.ticks[t];
+        instrument_stats.ticks[t] = 0;
+    }
+}
+
+void instrument_absorb(InstrumentStats *total) {
+    for (int c = 0; c < INSTR_COUNTER_COUNT; c++) {
+        instrument_stats.counters[c] += total->counters[c];
+    }
+    for (int t = 0; t < INSTR_TIMER_COUNT; t++) {
+        instrument_stats.ticks[t] += total->ticks[t];
+    }
+    memset(total, 0, sizeof(*total));
+}
@@ -0,0 +1,53 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "../Include/island.h"
+
+void mailbox_init(MigrantMailbox *mailbox) {
+    atomic_init(&mailbox->head, 0);
+    atomic_init(&mailbox->tail, 0);
+}
+
+// A full mailbox drops the migrant, the receiver is just behind
+bool mailbox_push(MigrantMailbox *mailbox, const Individual *migrant) {
+    unsigned int tail = atomic_load_explicit(&mailbox->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&mailbox->head, memory_order_acquire);
+    if (tail - head >= MAILBOX_CAPACITY) return false;
+
+    mailbox->slots[tail % MAILBOX_CAPACITY] = *migrant;
+    atomic_store_explicit(&mailbox->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool mailbox_pop(MigrantMailbox *mailbox, Individual *migrant) {
+    unsigned int head = atomic_load_explicit(&mailbox->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&mailbox->tail, memory_order_acquire);
+    if (head == tail) return false;
+
+    *migrant = mailbox->slots[head % MAILBOX_CAPACITY];
+    atomic_store_explicit(&mailbox->head, head + 1, memory_order_release);
+    return true;
+}
+
+int core_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int count = (int)info.dwNumberOfProcessors;
+#else
+    int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return count < 1 ? 1 : count;
+}
+
+int island_count(void) {
+    int count = ISLAND_COUNT;
+    if (count <= 0) count = core_count();
+    if (count < 1) count = 1;
+    if (count > MAX_ISLANDS) count = MAX_ISLANDS;
+    return count;
+}
@@ -1,171 +1,632 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdbool.h>
-#include <windows.h> 
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
-#include "../include/types.h"
-#include "../include/logger.h"
-#include "../include/chromosome.h"
-#include "../include/configuration.h"
-#include "../include/robot.h"
+#include "../Include/types.h"
+#include "../Include/logger.h"
+#include "../Include/chromosome.h"
+#include "../Include/configuration.h"
+#include "../Include/robot.h"
+#include "../Include/instrument.h"
 
-static void truncate_file(FILE *f, long pos) {
-    fflush(f);
-    HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(f));
-    if (hFile != INVALID_HANDLE_VALUE) {
-        LARGE_INTEGER li;
-        li.QuadPart = pos;
-        SetFilePointerEx(hFile, li, NULL, FILE_BEGIN);
-        SetEndOfFile(hFile);
+#define LOG_HEADER_MARKER     "\"generations\": [\n"
+#define LOG_GENERATION_MARKER "\"best_individual_id\""
+#define LOG_GENERATION_CLOSE  "}\n    }"
+#define LOG_FOOTER            "\n  ]\n}\n"
+#define LOG_TAIL_WINDOW       (64 * 1024)
+#define LOG_BUFFER_INITIAL    (64 * 1024)
+
+// File backend. The log is written through a plain descriptor: records are
+// formatted into the logger's buffer and flushed with positioned writes, and
+// on reopen only the tail of the file is examined.
+#ifdef _WIN32
+static int log_open(const char *filename, bool create) {
+    int flags = _O_RDWR | _O_BINARY | (create ? (_O_CREAT | _O_TRUNC) : 0);
+    return _open(filename, flags, _S_IREAD | _S_IWRITE);
+}
+
+static long long log_file_size(int fd) {
+    return _lseeki64(fd, 0, SEEK_END);
+}
+
+static int log_truncate(int fd, long long size) {
+    return _chsize_s(fd, size) == 0 ? 0 : -1;
+}
+
+static int log_write_at(int fd, const char *data, size_t len, long long offset) {
+    if (_lseeki64(fd, offset, SEEK_SET) < 0) return -1;
+    while (len > 0) {
+        int n = _write(fd, data, (unsigned int)len);
+        if (n <= 0) return -1;
+        data += n;
+        len -= (size_t)n;
     }
+    return 0;
 }
 
-JsonLogger* init_json_logger(const char *filename) {
-    JsonLogger *logger = malloc(sizeof(JsonLogger));
-    if (!logger) return NULL;
+static void log_close(int fd) {
+    _close(fd);
+}
+
+static long long log_page_size(void) {
+    return 4096;
+}
+
+// The CRT has no mmap, so the tail is read into a heap buffer instead
+static const char *log_map_tail(int fd, long long start, size_t len, void **handle) {
+    char *data = malloc(len);
+    if (!data) return NULL;
+    if (_lseeki64(fd, start, SEEK_SET) < 0 || _read(fd, data, (unsigned int)len) != (int)len) {
+        free(data);
+        return NULL;
+    }
+    *handle = data;
+    return data;
+}
+
+static void log_unmap_tail(void *handle, size_t len) {
+    (void)len;
+    free(handle);
+}
+#else
+static int log_open(const char *filename, bool create) {
+    int flags = O_RDWR | (create ? (O_CREAT | O_TRUNC) : 0);
+    return open(filename, flags, 0644);
+}
+
+static long long log_file_size(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return -1;
+    return (long long)st.st_size;
+}
+
+static int log_truncate(int fd, long long size) {
+    return ftruncate(fd, (off_t)size);
+}
+
+static int log_write_at(int fd, const char *data, size_t len, long long offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return 0;
+}
+
+static void log_close(int fd) {
+    close(fd);
+}
+
+static long long log_page_size(void) {
+    return sysconf(_SC_PAGESIZE);
+}
+
+static const char *log_map_tail(int fd, long long start, size_t len, void **handle) {
+    void *data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, (off_t)start);
+    if (data == MAP_FAILED) return NULL;
+    *handle = data;
+    return data;
+}
+
+static void log_unmap_tail(void *handle, size_t len) {
+    munmap(handle, len);
+}
+#endif
+
+static const char *find_first(const char *data, size_t len, const char *needle) {
+    size_t n = strlen(needle);
+    if (len < n) return NULL;
+    for (size_t i = 0; i + n <= len; i++) {
+        if (data[i] == needle[0] && memcmp(data + i, needle, n) == 0) return data + i;
+    }
+    return NULL;
+}
+
+static const char *find_last(const char *data, size_t len, const char *needle) {
+    size_t n = strlen(needle);
+    if (len < n) return NULL;
+    for (size_t i = len - n + 1; i-- > 0;) {
+        if (data[i] == needle[0] && memcmp(data + i, needle, n) == 0) return data + i;
+    }
+    return NULL;
+}
+
+// Finds the offset just past the last generation that was written completely.
+// Only the tail of the file is mapped; the window doubles until a complete
+// generation (or, for a log without generations, the header) is found.
+// Returns -1 if the file does not look like a robot log at all.
+static long long find_reopen_point(int fd, long long size, bool *has_generations) {
+    long long page = log_page_size();
+    long long window = LOG_TAIL_WINDOW;
 
-    FILE *f = fopen(filename, "rb+");
-    if (f) {
-        // File exists → append mode
-        fseek(f, 0, SEEK_END);
-        long size = ftell(f);
-
-        // Find the last ']' in the generations list
-        long pos = size - 1;
-        int ch;
-        while (pos > 0) {
-            fseek(f, pos, SEEK_SET);
-            ch = fgetc(f);
-            if (ch == ']') break;
-            pos--;
+    while (true) {
+        long long start = size > window ? ((size - window) / page) * page : 0;
+        size_t len = (size_t)(size - start);
+        void *handle = NULL;
+        const char *data = log_map_tail(fd, start, len, &handle);
+        if (!data) return -1;
+
+        long long point = -1;
+        size_t search_len = len;
+        const char *marker;
+        while ((marker = find_last(data, search_len, LOG_GENERATION_MARKER)) != NULL) {
+            size_t from = (size_t)(marker - data);
+            const char *end = find_first(marker, len - from, LOG_GENERATION_CLOSE);
+            if (end) {
+                point = start + (end - data) + (long long)strlen(LOG_GENERATION_CLOSE);
+                *has_generations = true;
+                break;
+            }
+            // This generation was cut off, fall back to the one before it
+            search_len = from;
+        }
+
+        if (point < 0 && start == 0) {
+            const char *header = find_first(data, len, LOG_HEADER_MARKER);
+            if (header) {
+                point = (header - data) + (long long)strlen(LOG_HEADER_MARKER);
+                *has_generations = false;
+            }
         }
 
-        // Truncate after ']' and add comma for new entries
-        truncate_file(f, pos);
-        fseek(f, 0, SEEK_END);
-        fputs(",\n", f);
+        log_unmap_tail(handle, len);
+        if (point >= 0 || start == 0) return point;
+        window *= 2;
+    }
+}
+
+// Finds the offset just past the opening of the generations list
+static long long find_header_end(int fd, long long size) {
+    size_t len = size < LOG_TAIL_WINDOW ? (size_t)size : LOG_TAIL_WINDOW;
+    void *handle = NULL;
+    const char *data = log_map_tail(fd, 0, len, &handle);
+    if (!data) return -1;
+
+    const char *header = find_first(data, len, LOG_HEADER_MARKER);
+    long long point = header ? (header - data) + (long long)strlen(LOG_HEADER_MARKER) : -1;
+    log_unmap_tail(handle, len);
+    return point;
+}
 
-        logger->file = f;
-        logger->first_entry = false;
-        logger->first_generation = false; 
-        printf("Appending to existing JSON log: %s\n", filename);
+// Makes room for `length` more bytes in the buffer
+static bool log_reserve(JsonLogger *logger, size_t length) {
+    if (logger->buffer_cap - logger->buffer_len > length) return true;
+    size_t cap = logger->buffer_cap * 2;
+    while (cap - logger->buffer_len <= length) cap *= 2;
+    char *grown = realloc(logger->buffer, cap);
+    if (!grown) return false;
+    logger->buffer = grown;
+    logger->buffer_cap = cap;
+    return true;
+}
+
+static void log_printf(JsonLogger *logger, const char *format, ...) {
+    while (true) {
+        size_t room = logger->buffer_cap - logger->buffer_len;
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(logger->buffer + logger->buffer_len, room, format, args);
+        va_end(args);
+        if (n < 0) return;
+        if ((size_t)n < room) {
+            logger->buffer_len += (size_t)n;
+            return;
+        }
+        if (!log_reserve(logger, (size_t)n)) return;
+    }
+}
 
+static void log_flush(JsonLogger *logger) {
+    if (logger->buffer_len == 0) return;
+    if (log_write_at(logger->fd, logger->buffer, logger->buffer_len, logger->offset) != 0) {
+        printf("Warning: Failed to write to JSON log\n");
     } else {
-        // New file
-        f = fopen(filename, "wb");
-        if (!f) {
-            free(logger);
-            return NULL;
+        logger->offset += (long long)logger->buffer_len;
+        INSTR_COUNT(INSTR_BYTES_LOGGED, logger->buffer_len);
+    }
+    logger->buffer_len = 0;
+}
+
+// Opens segment `index` for appending. A segment the manifest already knows
+// is cut back to the end of its last listed generation, so the manifest and
+// the file always agree; an unlisted leftover file is repaired from its tail.
+static bool open_segment(JsonLogger *logger, int index) {
+    char path[LOG_PATH_MAX];
+    log_segment_path(logger->filename, index, path, sizeof(path));
+    logger->layout_maze_id = -1;
+
+    LogSegment *segment = manifest_find_segment(&logger->manifest, index);
+    int fd = log_open(path, false);
+    if (fd >= 0) {
+        long long size = log_file_size(fd);
+        bool has_generations = false;
+        long long point = -1;
+
+        if (segment && segment->generation_count > 0) {
+            if (segment->generations[segment->generation_count - 1].end > size) {
+                // the file lost data the manifest had listed, fall back to its tail
+                point = find_reopen_point(fd, size, &has_generations);
+                manifest_truncate_segment(segment, point);
+            } else {
+                point = segment->generations[segment->generation_count - 1].end;
+            }
+            has_generations = segment->generation_count > 0;
+            if (!has_generations) point = find_header_end(fd, size);
+        } else if (size > 0) {
+            // generations the manifest never listed have no index entry, drop them
+            point = find_header_end(fd, size);
+        }
+
+        if (point >= 0) {
+            long long trailing = size - point;
+            if (trailing != (long long)strlen(LOG_FOOTER)) {
+                printf("Recovered JSON log after unclean shutdown, discarded %lld trailing bytes\n",
+                       trailing);
+            }
+            log_truncate(fd, point);
+
+            logger->fd = fd;
+            logger->offset = point;
+            logger->first_entry = false;
+            logger->first_generation = !has_generations;
+            logger->segment_index = index;
+            if (!segment) manifest_add_segment(&logger->manifest, index, path);
+            printf("Appending to existing JSON log segment: %s\n", path);
+            return true;
         }
-        fprintf(f, "{\n");
-        fprintf(f, "  \"simulation_info\": {\n");
-        fprintf(f, "    \"version\": \"1.0\",\n");
-        fprintf(f, "    \"created\": \"2024\"\n");
-        fprintf(f, "  },\n");
-        fprintf(f, "  \"generations\": [\n");
 
-        logger->file = f;
-        logger->first_entry = true;
-        logger->first_generation = true;
-        printf("Created new JSON log: %s\n", filename);
+        log_close(fd);
+    }
+
+    // New segment
+    fd = log_open(path, true);
+    if (fd < 0) {
+        printf("Warning: Could not create JSON log segment %s\n", path);
+        return false;
+    }
+    logger->fd = fd;
+    logger->offset = 0;
+    logger->segment_index = index;
+
+    log_printf(logger, "{\n");
+    log_printf(logger, "  \"simulation_info\": {\n");
+    log_printf(logger, "    \"version\": \"1.0\",\n");
+    log_printf(logger, "    \"created\": \"2024\",\n");
+    log_printf(logger, "    \"segment\": %d\n", index);
+    log_printf(logger, "  },\n");
+    log_printf(logger, "  \"generations\": [\n");
+    log_flush(logger);
+
+    logger->first_entry = true;
+    logger->first_generation = true;
+    if (segment) {
+        // the listed generations were lost with the file
+        segment->generation_count = 0;
+        segment->first_generation = -1;
+        segment->last_generation = -1;
+    } else {
+        manifest_add_segment(&logger->manifest, index, path);
+    }
+    printf("Created new JSON log segment: %s\n", path);
+    return true;
+}
+
+static void close_segment(JsonLogger *logger) {
+    if (logger->fd < 0) return;
+    log_printf(logger, LOG_FOOTER);
+    log_flush(logger);
+    log_close(logger->fd);
+    logger->fd = -1;
+    logger->segment_index = -1;
+}
+
+JsonLogger* init_json_logger(const char *filename) {
+    JsonLogger *logger = calloc(1, sizeof(JsonLogger));
+    if (!logger) return NULL;
+
+    logger->buffer = malloc(LOG_BUFFER_INITIAL);
+    if (!logger->buffer) {
+        free(logger);
+        return NULL;
+    }
+    logger->buffer_cap = LOG_BUFFER_INITIAL;
+    logger->fd = -1;
+    logger->segment_index = -1;
+    logger->layout_maze_id = -1;
+    snprintf(logger->filename, sizeof(logger->filename), "%s", filename);
+
+    if (load_log_manifest(filename, &logger->manifest)) {
+        LogSegment *last = &logger->manifest.segments[logger->manifest.segment_count - 1];
+        printf("Found JSON log manifest with %d segments (last generation %d)\n",
+               logger->manifest.segment_count, last->last_generation);
+
+        // Repair the newest segment now so readers of the resume counters
+        // see the same generations as the manifest
+        if (open_segment(logger, last->index)) {
+            save_log_manifest(filename, &logger->manifest);
+        }
     }
 
     return logger;
 }
 
 void close_json_logger(JsonLogger *logger) {
-    if (!logger || !logger->file) return;
-    fputs("\n  ]\n}\n", logger->file);
-    fclose(logger->file);
+    if (!logger) return;
+    close_segment(logger);
+    free_log_manifest(&logger->manifest);
+    for (int i = 0; i < logger->record_count; i++) {
+        free(logger->records[i].buffer);
+    }
+    free(logger->records);
+    free(logger->buffer);
     free(logger);
 }
 
 void log_generation_start(JsonLogger *logger, int generation, const char *maze_type,
                          Simulationcontext *context) {
-    if (!logger || !logger->file) return;
+    if (!logger) return;
+
+    // Rotate to the segment that holds this generation
+    int segment = log_segment_for_generation(generation);
+    if (logger->segment_index != segment) {
+        close_segment(logger);
+        if (!open_segment(logger, segment)) return;
+    }
     
     // Add comma before new generation (except for first)
     if (!logger->first_generation) {
-        fprintf(logger->file, ",\n");
+        log_printf(logger, ",\n");
     }
     logger->first_generation = false;
+    logger->generation_start = logger->offset + (long long)logger->buffer_len;
+    logger->current_generation = generation;
+    logger->max_individual_id = -1;
     
-    fprintf(logger->file, "    {\n");
-    fprintf(logger->file, "      \"generation\": %d,\n", generation);
-    fprintf(logger->file, "      \"maze_info\": {\n");
-    fprintf(logger->file, "        \"type\": \"%s\",\n", maze_type);
-    fprintf(logger->file, "        \"width\": %d,\n", context->maze_width);
-    fprintf(logger->file, "        \"height\": %d,\n", context->maze_height);
-    fprintf(logger->file, "        \"start\": [%d, %d],\n", context->start_x, context->start_y);
-    fprintf(logger->file, "        \"goal\": [%d, %d],\n", context->goal_x, context->goal_y);
-    fprintf(logger->file, "        \"layout\": ");
-    write_maze(logger->file, context->maze, context->maze_width, context->maze_height);
-    fprintf(logger->file, "\n      },\n");
-    fprintf(logger->file, "      \"individuals\": [\n");
+    log_printf(logger, "    {\n");
+    log_printf(logger, "      \"generation\": %d,\n", generation);
+    log_printf(logger, "      \"maze_info\": {\n");
+    log_printf(logger, "        \"type\": \"%s\",\n", maze_type);
+    log_printf(logger, "        \"width\": %d,\n", context->maze_width);
+    log_printf(logger, "        \"height\": %d,\n", context->maze_height);
+    log_printf(logger, "        \"start\": [%d, %d],\n", context->start_x, context->start_y);
+    log_printf(logger, "        \"goal\": [%d, %d],\n", context->goal_x, context->goal_y);
+    log_printf(logger, "        \"maze_id\": %d", context->maze_id);
+    // The layout is written once per maze and segment, later generations refer
+    // to it by maze_id. A large maze would otherwise be most of every generation
+    if (logger->layout_maze_id != context->maze_id) {
+        log_printf(logger, ",\n        \"layout\": ");
+        write_maze(logger, context->maze, context->maze_width, context->maze_height);
+        logger->layout_maze_id = context->maze_id;
+    }
+    log_printf(logger, "\n      },\n");
+    log_printf(logger, "      \"individuals\": [\n");
     
     logger->generation_count = 0;
-    fflush(logger->file);
+    log_flush(logger);
 }
 
-void log_individual_complete(JsonLogger *logger, Individual *ind,
-                           MovementLog *movements, int movement_count) {
-    if (!logger || !logger->file) return;
-    
+// Separates the record from the previous one of the generation
+static void begin_individual(JsonLogger *logger, const Individual *ind) {
     // Add comma before individual (except first)
     if (logger->generation_count > 0) {
-        fprintf(logger->file, ",\n");
+        log_printf(logger, ",\n");
     }
     logger->generation_count++;
-    
+    if (ind->id > logger->max_individual_id) {
+        logger->max_individual_id = ind->id;
+    }
+}
+
+// Only touches the logger's buffer, so it can fill a record on another thread
+static void format_individual(JsonLogger *logger, Individual *ind,
+                              MovementLog *movements, int movement_count) {
     float distance_to_goal = 0.0f; // Placeholder
     
-    fprintf(logger->file, "        {\n");
-    fprintf(logger->file, "          \"id\": %d,\n", ind->id);
-    fprintf(logger->file, "          \"fitness\": %.3f,\n", ind->fitness);
-    fprintf(logger->file, "          \"steps_taken\": %d,\n", ind->steps_taken);
-    fprintf(logger->file, "          \"reached_goal\": %s,\n", ind->reached_goal ? "true" : "false");
-    fprintf(logger->file, "          \"is_best\": %s,\n", ind->is_best ? "true" : "false");
-    fprintf(logger->file, "          \"collision_count\": %d,\n", ind->collision_count);
-    fprintf(logger->file, "          \"final_position\": {\n");
-    fprintf(logger->file, "            \"x\": %.3f,\n", ind->robot.x);
-    fprintf(logger->file, "            \"y\": %.3f,\n", ind->robot.y);
-    fprintf(logger->file, "            \"angle\": %.3f,\n", ind->robot.angle);
-    fprintf(logger->file, "            \"distance_to_goal\": %.3f\n", distance_to_goal);
-    fprintf(logger->file, "          },\n");
-    fprintf(logger->file, "          \"chromosome\": ");
-    write_chromosome(logger->file, &ind->chromosome);
+    log_printf(logger, "        {\n");
+    log_printf(logger, "          \"id\": %d,\n", ind->id);
+    log_printf(logger, "          \"fitness\": %.3f,\n", ind->fitness);
+    log_printf(logger, "          \"steps_taken\": %d,\n", ind->steps_taken);
+    log_printf(logger, "          \"reached_goal\": %s,\n", ind->reached_goal ? "true" : "false");
+    log_printf(logger, "          \"is_best\": %s,\n", ind->is_best ? "true" : "false");
+    if (ind->aborted) {
+        // stopped early by BOUND_ABORT, the fitness is the most it could have reached
+        log_printf(logger, "          \"aborted\": true,\n");
+    }
+#if SURROGATE
+    if (!isnan(ind->predicted_fitness)) {
+        log_printf(logger, "          \"predicted_fitness\": %.3f,\n", ind->predicted_fitness);
+    }
+#endif
+#if NOVELTY_SEARCH
+    log_printf(logger, "          \"novelty\": %.3f,\n", ind->novelty);
+#endif
+#if COARSE_SCREENING
+    if (!isnan(ind->coarse_fitness)) {
+        log_printf(logger, "          \"coarse_fitness\": %.3f,\n", ind->coarse_fitness);
+    }
+#endif
+    log_printf(logger, "          \"collision_count\": %d,\n", ind->collision_count);
+    log_printf(logger, "          \"final_position\": {\n");
+    log_printf(logger, "            \"x\": %.3f,\n", ind->robot.x);
+    log_printf(logger, "            \"y\": %.3f,\n", ind->robot.y);
+    log_printf(logger, "            \"angle\": %.3f,\n", ind->robot.angle);
+    log_printf(logger, "            \"distance_to_goal\": %.3f\n", distance_to_goal);
+    log_printf(logger, "          },\n");
+    log_printf(logger, "          \"chromosome\": ");
+    write_chromosome(logger, &ind->chromosome);
     
     if (movements && movement_count > 0) {
-        fprintf(logger->file, ",\n          \"movements\": ");
-        write_movements(logger->file, movements, movement_count);
+        log_printf(logger, ",\n          \"movements\": ");
+        write_movements(logger, movements, movement_count);
     }
     
-    fprintf(logger->file, "\n        }");
-    fflush(logger->file);
-}
-
-void log_generation_end(JsonLogger *logger, int goals_reached, float avg_fitness,
-                        float best_fitness, int best_individual_id) {
-    if (!logger || !logger->file) return;
-
-    fprintf(logger->file, "\n      ],\n");
-    fprintf(logger->file, "      \"generation_stats\": {\n");
-    fprintf(logger->file, "        \"goals_reached\": %d,\n", goals_reached);
-    fprintf(logger->file, "        \"avg_fitness\": %.3f,\n", avg_fitness);
-    fprintf(logger->file, "        \"best_fitness\": %.3f,\n", best_fitness);
-    fprintf(logger->file, "        \"best_individual_id\": %d\n", best_individual_id);
-    fprintf(logger->file, "      }\n");
-    fprintf(logger->file, "    }");  // NOTE: No trailing comma here!
+    log_printf(logger, "\n        }");
+}
+
+void log_individual_complete(JsonLogger *logger, Individual *ind,
+                           MovementLog *movements, int movement_count) {
+    if (!logger || logger->fd < 0) return;
+    begin_individual(logger, ind);
+    format_individual(logger, ind, movements, movement_count);
+    log_flush(logger);
+}
+
+typedef struct {
+    JsonLogger *logger;
+    Individual *population;
+    MovementLog (*movement_logs)[MAX_STEPS];
+    const int *movement_counts;
+} RecordJob;
+
+static void format_record_task(void *arg, int index, int worker) {
+    (void)worker;
+    RecordJob *job = arg;
+    LogRecord *record = &job->logger->records[index];
+    JsonLogger scratch = {.fd = -1, .buffer = record->buffer, .buffer_cap = record->cap};
+    if (!scratch.buffer) {
+        scratch.buffer = malloc(LOG_BUFFER_INITIAL);
+        scratch.buffer_cap = scratch.buffer ? LOG_BUFFER_INITIAL : 0;
+    }
+    if (scratch.buffer) {
+        format_individual(&scratch, &job->population[index], job->movement_logs[index],
+                          job->movement_counts[index]);
+    }
+    record->buffer = scratch.buffer;
+    record->cap = scratch.buffer_cap;
+    record->len = scratch.buffer_len;
+}
+
+// The records of a whole generation, as log_individual_complete would write
+// them one by one. Formatting is most of the cost of logging, so the records
+// are formatted on the scheduler's workers into buffers of their own and then
+// written in order
+void log_individuals(JsonLogger *logger, Individual *population,
+                     MovementLog (*movement_logs)[MAX_STEPS], const int *movement_counts,
+                     int count, TaskScheduler *scheduler) {
+    if (!logger || logger->fd < 0) return;
+    if (count > logger->record_count) {
+        LogRecord *grown = realloc(logger->records, (size_t)count * sizeof(LogRecord));
+        if (grown) {
+            memset(grown + logger->record_count, 0,
+                   (size_t)(count - logger->record_count) * sizeof(LogRecord));
+            logger->records = grown;
+            logger->record_count = count;
+        }
+    }
+    if (count > logger->record_count || scheduler_worker_count(scheduler) == 1) {
+        for (int i = 0; i < count; i++) {
+            log_individual_complete(logger, &population[i], movement_logs[i], movement_counts[i]);
+        }
+        return;
+    }
+
+    RecordJob job = {
+        .logger = logger,
+        .population = population,
+        .movement_logs = movement_logs,
+        .movement_counts = movement_counts,
+    };
+    scheduler_parallel_for(scheduler, count, 1, format_record_task, &job);
+
+    for (int i = 0; i < count; i++) {
+        const LogRecord *record = &logger->records[i];
+        begin_individual(logger, &population[i]);
+        if (record->buffer && log_reserve(logger, record->len)) {
+            memcpy(logger->buffer + logger->buffer_len, record->buffer, record->len);
+            logger->buffer_len += record->len;
+        } else {
+            format_individual(logger, &population[i], movement_logs[i], movement_counts[i]);
+        }
+        log_flush(logger);
+    }
+}
+
+// The optional fields are written only when the feature that fills them in
+// is compiled in
+void log_generation_end(JsonLogger *logger, const GenerationStats *stats) {
+    if (!logger || logger->fd < 0) return;
+
+    log_printf(logger, "\n      ],\n");
+    log_printf(logger, "      \"generation_stats\": {\n");
+    log_printf(logger, "        \"goals_reached\": %d,\n", stats->goals_reached);
+    log_printf(logger, "        \"avg_fitness\": %.3f,\n", stats->avg_fitness);
+    log_printf(logger, "        \"best_fitness\": %.3f,\n", stats->best_fitness);
+#if BOUND_ABORT
+    log_printf(logger, "        \"aborted\": %d,\n", stats->aborted);
+    log_printf(logger, "        \"steps_saved\": %d,\n", stats->steps_saved);
+#endif
+#if SURROGATE
+    if (stats->predicted > 0) {
+        log_printf(logger, "        \"surrogate_predicted\": %d,\n", stats->predicted);
+        log_printf(logger, "        \"surrogate_error\": %.3f,\n", stats->surrogate_error);
+    }
+#endif
+#if NOVELTY_SEARCH
+    log_printf(logger, "        \"avg_novelty\": %.3f,\n", stats->avg_novelty);
+#endif
+#if COARSE_SCREENING
+    if (!isnan(stats->coarse_correlation)) {
+        log_printf(logger, "        \"coarse_rank_correlation\": %.3f,\n", stats->coarse_correlation);
+    }
+#endif
+#if INSTRUMENTATION
+    // Before best_individual_id, which closes the generation when the log is reopened
+    InstrumentReport report;
+    char profile[768];
+    instrument_report(&report);
+    instrument_format_json(&report, profile, sizeof(profile));
+    log_printf(logger, "        \"profile\": %s,\n", profile);
+#endif
+    log_printf(logger, "        \"best_individual_id\": %d\n", stats->best_individual_id);
+    log_printf(logger, "      }\n");
+    log_printf(logger, "    }");  // NOTE: No trailing comma here!
     
-    fflush(logger->file);
+    log_flush(logger);
+
+    // The generation is on disk, now list it in the manifest
+    LogSegment *segment = manifest_find_segment(&logger->manifest, logger->segment_index);
+    if (segment) {
+        LogGenerationEntry entry = {
+            .generation = logger->current_generation,
+            .start = logger->generation_start,
+            .end = logger->offset,
+            .best_fitness = stats->best_fitness,
+            .best_individual_id = stats->best_individual_id
+        };
+        manifest_add_generation(segment, &entry, logger->max_individual_id);
+        if (!save_log_manifest(logger->filename, &logger->manifest)) {
+            printf("Warning: Could not update JSON log manifest\n");
+        }
+    }
 }
 
-void write_maze(FILE *f, int **maze, int width, int height) {
-    fprintf(f, "[\n");
+void write_maze(JsonLogger *logger, int **maze, int width, int height) {
+    log_printf(logger, "[\n");
     for (int y = 0; y < height; y++) {
-        fprintf(f, "  [");
+        // a row is written straight into the buffer, "X", per cell
+        if (!log_reserve(logger, (size_t)width * 5 + 8)) return;
+        char *p = logger->buffer + logger->buffer_len;
+        *p++ = ' ';
+        *p++ = ' ';
+        *p++ = '[';
         for (int x = 0; x < width; x++) {
             char cell;
             switch (maze[y][x]) {
@@ -176,76 +637,103 @@ void write_maze(FILE *f, int **maze, int width, int height) {
                 case EMPTY:  cell = 'O'; break;
                 default:     cell = '?'; break;
             }
-            fprintf(f, "\"%c\"", cell);
-            if (x < width - 1) fprintf(f, ", ");
+            *p++ = '"';
+            *p++ = cell;
+            *p++ = '"';
+            if (x < width - 1) {
+                *p++ = ',';
+                *p++ = ' ';
+            }
         }
-        fprintf(f, "]");
-        if (y < height - 1) fprintf(f, ",");
-        fprintf(f, "\n");
+        *p++ = ']';
+        if (y < height - 1) *p++ = ',';
+        *p++ = '\n';
+        logger->buffer_len = (size_t)(p - logger->buffer);
     }
-    fprintf(f, "]\n");
+    log_printf(logger, "]\n");
 }
 
-void write_chromosome(FILE *file, Chromosome *chr) {
-    fprintf(file, "{\n");
-    fprintf(file, "            \"sensor_weights\": [");
+void write_chromosome(JsonLogger *logger, Chromosome *chr) {
+    log_printf(logger, "{\n");
+    log_printf(logger, "            \"sensor_weights\": [");
     for (int i = 0; i < 5; i++) {
-        fprintf(file, "%.3f", chr->sensor_weights[i]);
-        if (i < 4) fprintf(file, ", ");
+        log_printf(logger, "%.3f", chr->sensor_weights[i]);
+        if (i < 4) log_printf(logger, ", ");
     }
-    fprintf(file, "],\n");
+    log_printf(logger, "],\n");
     
-    fprintf(file, "            \"distance_thresholds\": [");
+    log_printf(logger, "            \"distance_thresholds\": [");
     for (int i = 0; i < 3; i++) {
-        fprintf(file, "%.3f", chr->distance_thresholds[i]);
-        if (i < 2) fprintf(file, ", ");
+        log_printf(logger, "%.3f", chr->distance_thresholds[i]);
+        if (i < 2) log_printf(logger, ", ");
     }
-    fprintf(file, "],\n");
+    log_printf(logger, "],\n");
     
-    fprintf(file, "            \"action_priorities\": [");
+    log_printf(logger, "            \"action_priorities\": [");
     for (int i = 0; i < 4; i++) {
-        fprintf(file, "%.3f", chr->action_priorities[i]);
-        if (i < 3) fprintf(file, ", ");
+        log_printf(logger, "%.3f", chr->action_priorities[i]);
+        if (i < 3) log_printf(logger, ", ");
     }
-    fprintf(file, "],\n");
+    log_printf(logger, "],\n");
     
-    fprintf(file, "            \"turn_aggressiveness\": %.3f,\n", chr->turn_aggressiveness);
-    fprintf(file, "            \"collision_avoidance\": %.3f\n", chr->collision_avoidance);
-    fprintf(file, "          }");
+    log_printf(logger, "            \"turn_aggressiveness\": %.3f,\n", chr->turn_aggressiveness);
+    log_printf(logger, "            \"collision_avoidance\": %.3f\n", chr->collision_avoidance);
+    log_printf(logger, "          }");
 }
 
-void write_movements(FILE *file, MovementLog *movements, int count) {
+void write_movements(JsonLogger *logger, MovementLog *movements, int count) {
     const char* action_names[] = {"FORWARD", "TURN_LEFT_45", "TURN_RIGHT_45", "BACKWARD"};
     
-    fprintf(file, "[\n");
+    log_printf(logger, "[\n");
     for (int i = 0; i < count; i++) {
         MovementLog *mov = &movements[i];
         const char* action_name = (mov->action >= 0 && mov->action <= 3) ? 
                                  action_names[mov->action] : "UNKNOWN";
         
-        fprintf(file, "            {\n");
-        fprintf(file, "              \"step\": %d,\n", mov->step);
-        fprintf(file, "              \"position\": [%.3f, %.3f],\n", mov->x, mov->y);
-        fprintf(file, "              \"angle\": %.3f,\n", mov->angle);
-        fprintf(file, "              \"action\": \"%s\",\n", action_name);
-        fprintf(file, "              \"sensors\": [%.2f, %.2f, %.2f, %.2f, %.2f]\n", 
+        log_printf(logger, "            {\n");
+        log_printf(logger, "              \"step\": %d,\n", mov->step);
+        log_printf(logger, "              \"position\": [%.3f, %.3f],\n", mov->x, mov->y);
+        log_printf(logger, "              \"angle\": %.3f,\n", mov->angle);
+        log_printf(logger, "              \"action\": \"%s\",\n", action_name);
+        log_printf(logger, "              \"sensors\": [%.2f, %.2f, %.2f, %.2f, %.2f]\n", 
                 mov->sensor_readings[0], mov->sensor_readings[1], mov->sensor_readings[2],
                 mov->sensor_readings[3], mov->sensor_readings[4]);
-        fprintf(file, "            }");
+        log_printf(logger, "            }");
         
-        if (i < count - 1) fprintf(file, ",");
-        fprintf(file, "\n");
+        if (i < count - 1) log_printf(logger, ",");
+        log_printf(logger, "\n");
     }
-    fprintf(file, "          ]");
+    log_printf(logger, "          ]");
 }
 
 // Rest of the functions remain the same...
 Individual* load_best_individual_from_file(const char *filename, int *found) {
-    FILE *file = fopen(filename, "r");
+    // With a manifest only the generation that holds the best individual is
+    // read, otherwise the whole single-file log is scanned
+    char path[LOG_PATH_MAX];
+    long long start = 0, end = -1;
+    snprintf(path, sizeof(path), "%s", filename);
+
+    LogManifest manifest;
+    if (load_log_manifest(filename, &manifest)) {
+        const LogSegment *segment = NULL;
+        const LogGenerationEntry *entry = manifest_best_generation(&manifest, &segment);
+        if (entry) {
+            log_segment_path(filename, segment->index, path, sizeof(path));
+            start = entry->start;
+            end = entry->end;
+        }
+        free_log_manifest(&manifest);
+    }
+
+    FILE *file = fopen(path, "r");
     if (!file) {
         *found = 0;
         return NULL;
     }
+    if (start > 0) {
+        fseek(file, (long)start, SEEK_SET);
+    }
     
     Individual *best = malloc(sizeof(Individual));
     if (!best) {
@@ -262,7 +750,7 @@ Individual* load_best_individual_from_file(const char *filename, int *found) {
     int parsing_individual = 0;
     int parsing_chromosome = 0;
     
-    while (fgets(line, sizeof(line), file)) {
+    while ((end < 0 || ftell(file) < end) && fgets(line, sizeof(line), file)) {
         if (strstr(line, "\"id\":")) {
             parsing_individual = 1;
             memset(&current, 0, sizeof(Individual));
@@ -423,11 +911,18 @@ int load_best_individual_from_file_wrapper(Individual *dest, const char *filenam
     return 0;
 }
 
+static pthread_mutex_t maze_log_lock = PTHREAD_MUTEX_INITIALIZER;
+
 void save_maze_to_log(int maze_id, int **maze, int width, int height,
                       const char *maze_type, int clear_percent,
                       const char *filename) {
+    // the islands share the maze log, one record at a time
+    pthread_mutex_lock(&maze_log_lock);
     FILE *f = fopen(filename, "a");
-    if (!f) return;
+    if (!f) {
+        pthread_mutex_unlock(&maze_log_lock);
+        return;
+    }
 
     fprintf(f, "{\n");
     fprintf(f, "  \"maze_id\": %d,\n", maze_id);
@@ -457,9 +952,28 @@ void save_maze_to_log(int maze_id, int **maze, int width, int height,
     fprintf(f, "}\n");
 
     fclose(f);
+    pthread_mutex_unlock(&maze_log_lock);
 }
 
 int get_last_generation_from_file(const char *filename) {
+    LogManifest manifest;
+    if (load_log_manifest(filename, &manifest)) {
+        int last_generation = -1;
+        for (int i = 0; i < manifest.segment_count; i++) {
+            if (manifest.segments[i].last_generation > last_generation) {
+                last_generation = manifest.segments[i].last_generation;
+            }
+        }
+        free_log_manifest(&manifest);
+
+        if (last_generation >= 0) {
+            printf("Found previous data, last generation was: %d\n", last_generation);
+        } else {
+            printf("No valid generation data found in file\n");
+        }
+        return last_generation;
+    }
+
     FILE *file = fopen(filename, "r");
     if (!file) {
         return -1;
@@ -491,12 +1005,26 @@ int get_last_generation_from_file(const char *filename) {
 }
 
 int get_last_individual_id_from_file(const char *filename) {
+    int last_id = 0;
+
+    LogManifest manifest;
+    if (load_log_manifest(filename, &manifest)) {
+        for (int i = 0; i < manifest.segment_count; i++) {
+            if (manifest.segments[i].max_individual_id > last_id) {
+                last_id = manifest.segments[i].max_individual_id;
+            }
+        }
+        free_log_manifest(&manifest);
+
+        printf("Found highest individual ID: %d, next ID will be: %d\n", last_id, last_id + 1);
+        return last_id + 1;
+    }
+
     FILE *file = fopen(filename, "r");
     if (!file) {
         return 0;
     }
-    
-    int last_id = 0;
+
     char line[1024];
     
     while (fgets(line, sizeof(line), file)) {
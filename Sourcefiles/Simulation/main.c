@@ -1,4 +1,4 @@
-#include "../include/menus.h"
+#include "../Include/menus.h"
 
 int main() {
     mainmenu();
@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "../Include/manifest.h"
+#include "../Include/configuration.h"
+
+// strips a trailing ".json" so derived files sit beside the log
+static void log_stem(const char *log_filename, char *out, size_t size) {
+    snprintf(out, size, "%s", log_filename);
+    size_t len = strlen(out);
+    if (len > 5 && strcmp(out + len - 5, ".json") == 0) {
+        out[len - 5] = '\0';
+    }
+}
+
+static const char *path_basename(const char *path) {
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash && (!slash || backslash > slash)) slash = backslash;
+    return slash ? slash + 1 : path;
+}
+
+void log_derived_path(const char *log_filename, const char *suffix, char *out, size_t size) {
+    char stem[LOG_PATH_MAX];
+    log_stem(log_filename, stem, sizeof(stem));
+    snprintf(out, size, "%s%s", stem, suffix);
+}
+
+void log_manifest_path(const char *log_filename, char *out, size_t size) {
+    log_derived_path(log_filename, ".manifest.json", out, size);
+}
+
+void log_segment_path(const char *log_filename, int segment, char *out, size_t size) {
+    char stem[LOG_PATH_MAX];
+    log_stem(log_filename, stem, sizeof(stem));
+    snprintf(out, size, "%s.seg%04d.json", stem, segment);
+}
+
+int log_segment_for_generation(int generation) {
+    return generation / LOG_SEGMENT_GENERATIONS;
+}
+
+void free_log_manifest(LogManifest *manifest) {
+    for (int i = 0; i < manifest->segment_count; i++) {
+        free(manifest->segments[i].generations);
+    }
+    free(manifest->segments);
+    manifest->segments = NULL;
+    manifest->segment_count = 0;
+    manifest->segment_cap = 0;
+}
+
+LogSegment *manifest_find_segment(LogManifest *manifest, int index) {
+    for (int i = manifest->segment_count - 1; i >= 0; i--) {
+        if (manifest->segments[i].index == index) return &manifest->segments[i];
+    }
+    return NULL;
+}
+
+LogSegment *manifest_add_segment(LogManifest *manifest, int index, const char *file) {
+    if (manifest->segment_count == manifest->segment_cap) {
+        int cap = manifest->segment_cap ? manifest->segment_cap * 2 : 16;
+        LogSegment *grown = realloc(manifest->segments, cap * sizeof(LogSegment));
+        if (!grown) return NULL;
+        manifest->segments = grown;
+        manifest->segment_cap = cap;
+    }
+
+    LogSegment *segment = &manifest->segments[manifest->segment_count++];
+    memset(segment, 0, sizeof(LogSegment));
+    segment->index = index;
+    snprintf(segment->file, sizeof(segment->file), "%s", path_basename(file));
+    segment->first_generation = -1;
+    segment->last_generation = -1;
+    segment->best_individual_id = -1;
+    return segment;
+}
+
+void manifest_add_generation(LogSegment *segment, const LogGenerationEntry *entry, int max_individual_id) {
+    if (segment->generation_count == segment->generation_cap) {
+        int cap = segment->generation_cap ? segment->generation_cap * 2 : LOG_SEGMENT_GENERATIONS;
+        LogGenerationEntry *grown = realloc(segment->generations, cap * sizeof(LogGenerationEntry));
+        if (!grown) return;
+        segment->generations = grown;
+        segment->generation_cap = cap;
+    }
+    segment->generations[segment->generation_count++] = *entry;
+
+    if (segment->first_generation < 0) segment->first_generation = entry->generation;
+    segment->last_generation = entry->generation;
+    if (segment->best_individual_id < 0 || entry->best_fitness > segment->best_fitness) {
+        segment->best_fitness = entry->best_fitness;
+        segment->best_individual_id = entry->best_individual_id;
+    }
+    if (max_individual_id > segment->max_individual_id) {
+        segment->max_individual_id = max_individual_id;
+    }
+}
+
+void manifest_truncate_segment(LogSegment *segment, long long size) {
+    int kept = 0;
+    while (kept < segment->generation_count && segment->generations[kept].end <= size) kept++;
+    if (kept == segment->generation_count) return;
+
+    // recompute the summary from what is left, the max id is kept so that
+    // ids stay unique after a resume
+    int count = kept;
+    segment->generation_count = 0;
+    segment->first_generation = -1;
+    segment->last_generation = -1;
+    segment->best_individual_id = -1;
+    segment->best_fitness = 0;
+    for (int g = 0; g < count; g++) {
+        LogGenerationEntry entry = segment->generations[g];
+        manifest_add_generation(segment, &entry, segment->max_individual_id);
+    }
+}
+
+const LogGenerationEntry *manifest_find_generation(const LogManifest *manifest, int generation,
+                                                   const LogSegment **segment) {
+    for (int i = 0; i < manifest->segment_count; i++) {
+        const LogSegment *seg = &manifest->segments[i];
+        if (generation < seg->first_generation || generation > seg->last_generation) continue;
+        for (int g = 0; g < seg->generation_count; g++) {
+            if (seg->generations[g].generation == generation) {
+                if (segment) *segment = seg;
+                return &seg->generations[g];
+            }
+        }
+    }
+    return NULL;
+}
+
+const LogGenerationEntry *manifest_best_generation(const LogManifest *manifest,
+                                                   const LogSegment **segment) {
+    const LogSegment *best_segment = NULL;
+    for (int i = 0; i < manifest->segment_count; i++) {
+        const LogSegment *seg = &manifest->segments[i];
+        if (seg->generation_count == 0) continue;
+        if (!best_segment || seg->best_fitness > best_segment->best_fitness) {
+            best_segment = seg;
+        }
+    }
+    if (!best_segment) return NULL;
+
+    for (int g = 0; g < best_segment->generation_count; g++) {
+        if (best_segment->generations[g].best_individual_id == best_segment->best_individual_id) {
+            if (segment) *segment = best_segment;
+            return &best_segment->generations[g];
+        }
+    }
+    return NULL;
+}
+
+// The manifest is written one record per line so it can be read back with
+// the same line scanning as the rest of the logs, and as JSON by the analysis
+bool save_log_manifest(const char *log_filename, const LogManifest *manifest) {
+    char path[LOG_PATH_MAX], tmp_path[LOG_PATH_MAX + 8];
+    log_manifest_path(log_filename, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) return false;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"version\": \"1.0\",\n");
+    fprintf(f, "  \"generations_per_segment\": %d,\n", LOG_SEGMENT_GENERATIONS);
+    fprintf(f, "  \"segments\": [\n");
+    for (int i = 0; i < manifest->segment_count; i++) {
+        const LogSegment *seg = &manifest->segments[i];
+        fprintf(f, "    {\"segment\": %d, \"file\": \"%s\", \"first_generation\": %d, "
+                   "\"last_generation\": %d, \"best_fitness\": %.3f, \"best_individual_id\": %d, "
+                   "\"max_individual_id\": %d, \"generations\": [\n",
+                seg->index, seg->file, seg->first_generation, seg->last_generation,
+                seg->best_fitness, seg->best_individual_id, seg->max_individual_id);
+        for (int g = 0; g < seg->generation_count; g++) {
+            const LogGenerationEntry *e = &seg->generations[g];
+            fprintf(f, "      {\"generation\": %d, \"start\": %lld, \"end\": %lld, "
+                       "\"best_fitness\": %.3f, \"best_individual_id\": %d}%s\n",
+                    e->generation, e->start, e->end, e->best_fitness, e->best_individual_id,
+                    (g < seg->generation_count - 1) ? "," : "");
+        }
+        fprintf(f, "    ]}%s\n", (i < manifest->segment_count - 1) ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+
+    if (fclose(f) != 0) {
+        remove(tmp_path);
+        return false;
+    }
+
+    // replace the old manifest in one step so readers never see half of it
+#ifdef _WIN32
+    remove(path);
+#endif
+    return rename(tmp_path, path) == 0;
+}
+
+bool load_log_manifest(const char *log_filename, LogManifest *manifest) {
+    memset(manifest, 0, sizeof(LogManifest));
+
+    char path[LOG_PATH_MAX];
+    log_manifest_path(log_filename, path, sizeof(path));
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    char line[1024];
+    LogSegment *segment = NULL;
+    while (fgets(line, sizeof(line), f)) {
+        int index, first, last, best_id, max_id;
+        float best;
+        char file[LOG_PATH_MAX];
+        LogGenerationEntry entry;
+
+        if (sscanf(line, " {\"segment\": %d, \"file\": \"%511[^\"]\", \"first_generation\": %d, "
+                         "\"last_generation\": %d, \"best_fitness\": %f, \"best_individual_id\": %d, "
+                         "\"max_individual_id\": %d",
+                   &index, file, &first, &last, &best, &best_id, &max_id) == 7) {
+            segment = manifest_add_segment(manifest, index, file);
+            if (segment) segment->max_individual_id = max_id;
+        } else if (segment &&
+                   sscanf(line, " {\"generation\": %d, \"start\": %lld, \"end\": %lld, "
+                                "\"best_fitness\": %f, \"best_individual_id\": %d",
+                          &entry.generation, &entry.start, &entry.end,
+                          &entry.best_fitness, &entry.best_individual_id) == 5) {
+            manifest_add_generation(segment, &entry, segment->max_individual_id);
+        }
+    }
+    fclose(f);
+
+    return manifest->segment_count > 0;
+}
@@ -1,13 +1,18 @@
 #include <stdlib.h>
+#include <stdint.h>
 #include <time.h>
 #include <string.h>
-#include "../include/configuration.h"
-#include "../include/maze.h"
-#include "../include/debugger.h"
-#include "../include/logger.h"
+#include <stdatomic.h>
+#include "../Include/configuration.h"
+#include "../Include/maze.h"
+#include "../Include/debugger.h"
+#include "../Include/logger.h"
+#include "../Include/rng.h"
+#include "../Include/scheduler.h"
 
 
-static int next_maze_id = 1;
+// shared by the islands, so handed out atomically
+static atomic_int next_maze_id = 1;
 
 int **create_matrix(int rows, int cols) {
     int **matrix = malloc(rows * sizeof(int*));
@@ -24,17 +29,58 @@ void free_matrix(int **matrix, int rows) {
     free(matrix);
 }
 
+// (Re)builds context->solid from context->maze
+bool maze_build_solid(Simulationcontext *context) {
+    free(context->solid);
+    int w = context->maze_width, h = context->maze_height;
+    int stride = (w + MAZE_TILE_MASK) >> MAZE_TILE_SHIFT;
+    int rows = (h + MAZE_TILE_MASK) >> MAZE_TILE_SHIFT;
+    context->solid = calloc((size_t)stride * rows, sizeof(uint64_t));
+    context->solid_stride = stride;
+    if (!context->solid) return false;
+
+    for (int y = 0; y < h; y++) {
+        uint64_t *tiles = context->solid + (size_t)(y >> MAZE_TILE_SHIFT) * stride;
+        int shift = (y & MAZE_TILE_MASK) << MAZE_TILE_SHIFT;
+        for (int x = 0; x < w; x++) {
+            int cell = context->maze[y][x];
+            if (cell == WALL || cell == BORDER) {
+                tiles[x >> MAZE_TILE_SHIFT] |= 1ULL << (shift | (x & MAZE_TILE_MASK));
+            }
+        }
+    }
+    return true;
+}
+
+// Frees the maze of the context, its tiles and distance field
+void maze_release(Simulationcontext *context) {
+    if (context->maze) free_matrix(context->maze, context->maze_height);
+    free(context->solid);
+    free(context->goal_distance);
+    context->maze = NULL;
+    context->solid = NULL;
+    context->goal_distance = NULL;
+}
+
 void carve_random_paths(int **maze, int width, int height, int clear_chance_percent) {
     for (int y = 1; y < height - 1; y++) {
         for (int x = 1; x < width - 1; x++) {
-            maze[y][x] = (rand() % 100 < clear_chance_percent) ? EMPTY : WALL;
+            maze[y][x] = (rng_int(100) < clear_chance_percent) ? EMPTY : WALL;
         }
     }
 }
 
+// *width and *height give the size to generate, DEFAULT_MAZE_WIDTH/HEIGHT
+// when they are not set
 int **generate_labyrinthe(LabyrinthType type, int *width, int *height, 
                           Simulationcontext *context) {
     int max_attempts = MAX_ATTEMPTS;
+    int w = *width > 0 ? *width : DEFAULT_MAZE_WIDTH;
+    int h = *height > 0 ? *height : DEFAULT_MAZE_HEIGHT;
+    if (w < MIN_MAZE_SIZE) w = MIN_MAZE_SIZE;
+    if (h < MIN_MAZE_SIZE) h = MIN_MAZE_SIZE;
+    if (w > MAX_MAZE_SIZE) w = MAX_MAZE_SIZE;
+    if (h > MAX_MAZE_SIZE) h = MAX_MAZE_SIZE;
     const char *type_str;
     int clear_percent;
     
@@ -68,7 +114,6 @@ int **generate_labyrinthe(LabyrinthType type, int *width, int *height,
     
     for (int attempt = 0; attempt < max_attempts; attempt++) {
 
-        int w = DEFAULT_MAZE_WIDTH, h = DEFAULT_MAZE_HEIGHT;
         *width = w;
         *height = h;
 
@@ -96,14 +141,11 @@ int **generate_labyrinthe(LabyrinthType type, int *width, int *height,
         context->maze_height = h;
 
         place_goal_on_edge(maze, w, h, context);
-        place_start(maze, w, h, context);
-        
-        maze[context->start_y][context->start_x] = START;
         
-        if (is_maze_solvable(maze, w, h, context->start_x, context->start_y, 
-                             context->goal_x, context->goal_y)) {
+        if (place_start(maze, w, h, context)) {
             
             int id = get_next_maze_id();
+            context->maze_id = id;
             save_maze_to_log(id, maze, w, h, type_str, clear_percent, "maze_log.txt");
             return maze;
         }
@@ -117,25 +159,25 @@ int **generate_labyrinthe(LabyrinthType type, int *width, int *height,
 }
 
 void place_goal_on_edge(int **maze, int width, int height, Simulationcontext *context) {
-    int x, y;
-    int side = rand() % 4;
+    int x = 0, y = 0;
+    int side = rng_int(4);
     
     switch (side) {
         case 0: // Top
-            x = 1 + rand() % (width - 2);
+            x = 1 + rng_int(width - 2);
             y = 0;
             break;
         case 1: // bottom
-            x = 1 + rand() % (width - 2);
+            x = 1 + rng_int(width - 2);
             y = height - 1;
             break;
         case 2: // left
             x = 0;
-            y = 1 + rand() % (height - 2);
+            y = 1 + rng_int(height - 2);
             break;
         case 3: // right
             x = width - 1;
-            y = 1 + rand() % (height - 2);
+            y = 1 + rng_int(height - 2);
             break;
     }
     
@@ -144,17 +186,249 @@ void place_goal_on_edge(int **maze, int width, int height, Simulationcontext *co
     maze[y][x] = GOAL;
 }
 
-void place_start(int **maze, int width, int height, Simulationcontext *context) {
+// Growable ring of cell indices (y * width + x) for the breadth-first searches
+typedef struct {
+    uint32_t *cells;
+    size_t capacity, front, count;
+} CellQueue;
+
+static bool queue_init(CellQueue *queue, size_t capacity) {
+    queue->cells = malloc(capacity * sizeof(uint32_t));
+    queue->capacity = capacity;
+    queue->front = 0;
+    queue->count = 0;
+    return queue->cells != NULL;
+}
+
+static bool queue_push(CellQueue *queue, uint32_t cell) {
+    if (queue->count == queue->capacity) {
+        // unroll the ring into a buffer twice the size
+        uint32_t *grown = malloc(2 * queue->capacity * sizeof(uint32_t));
+        if (!grown) return false;
+        for (size_t k = 0; k < queue->count; k++) {
+            grown[k] = queue->cells[(queue->front + k) % queue->capacity];
+        }
+        free(queue->cells);
+        queue->cells = grown;
+        queue->front = 0;
+        queue->capacity *= 2;
+    }
+    queue->cells[(queue->front + queue->count) % queue->capacity] = cell;
+    queue->count++;
+    return true;
+}
+
+static uint32_t queue_pop(CellQueue *queue) {
+    uint32_t cell = queue->cells[queue->front];
+    queue->front = (queue->front + 1) % queue->capacity;
+    queue->count--;
+    return cell;
+}
+
+static bool is_open(int **maze, int x, int y) {
+    return maze[y][x] != WALL && maze[y][x] != BORDER;
+}
+
+static int popcount64(uint64_t v) {
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (int)((v * 0x0101010101010101ULL) >> 56);
+}
+
+// A start drawn from every open interior cell, as generate_labyrinthe used
+// to, reaches the goal with probability component / open cells, and a maze
+// whose start could not was thrown away. One draw with those odds keeps the
+// same mazes without drawing starts until one connects
+static int count_open_interior(int **maze, int width, int height) {
+    int count = 0;
+    for (int y = 1; y < height - 1; y++) {
+        for (int x = 1; x < width - 1; x++) {
+            if (maze[y][x] != WALL) count++;
+        }
+    }
+    return count;
+}
+
+// Picks the start among the open cells connected to the goal. Returns false
+// when the maze should be thrown away: the goal is walled in, or the draw
+// above rejects it. The start is then placed on any open cell
+bool place_start(int **maze, int width, int height, Simulationcontext *context) {
     int x, y;
+    CellMask component;
+    bool connected = false;
+
+    if (maze_connected_component(maze, width, height, context->goal_x, context->goal_y,
+                                 &component)) {
+        // the goal is the only border cell that can be in the component
+        component.bits[(size_t)context->goal_y * component.stride + context->goal_x / 64] &=
+            ~(1ULL << (context->goal_x % 64));
+        size_t words = (size_t)component.stride * height;
+        int count = 0;
+        for (size_t k = 0; k < words; k++) count += popcount64(component.bits[k]);
 
-    do {
-        x = 1 + rand() % (width - 2);
-        y = 1 + rand() % (height - 2);
-    } while ((x == context->goal_x && y == context->goal_y) || maze[y][x] == WALL);
+        int open_cells = count > 0 ? count_open_interior(maze, width, height) : 0;
+        if (count > 0 && rng_int(open_cells) < count) {
+            int pick = rng_int(count);
+            size_t k = 0;
+            while (popcount64(component.bits[k]) <= pick) pick -= popcount64(component.bits[k++]);
+            uint64_t word = component.bits[k];
+            while (pick-- > 0) word &= word - 1;  // drop the lower set bits
+            int bit = 0;
+            while (!((word >> bit) & 1)) bit++;
+            x = (int)(k % component.stride) * 64 + bit;
+            y = (int)(k / component.stride);
+            connected = true;
+        }
+        mask_free(&component);
+    }
+
+    if (!connected) {
+        do {
+            x = 1 + rng_int(width - 2);
+            y = 1 + rng_int(height - 2);
+        } while ((x == context->goal_x && y == context->goal_y) || maze[y][x] == WALL);
+    }
 
     context->start_x = x;
     context->start_y = y;
     maze[y][x] = START;
+    return connected;
+}
+
+CellMask mask_create(int width, int height) {
+    CellMask mask;
+    mask.width = width;
+    mask.height = height;
+    mask.stride = (width + 63) / 64;
+    mask.bits = calloc((size_t)mask.stride * height, sizeof(uint64_t));
+    return mask;
+}
+
+void mask_free(CellMask *mask) {
+    free(mask->bits);
+    mask->bits = NULL;
+}
+
+// Spreads the set bits of fill along the runs of open bits in a word, towards
+// the high bits (up) or the low bits (down), in six shift/AND/OR rounds
+static uint64_t fill_up(uint64_t fill, uint64_t open) {
+    fill |= open & (fill << 1);  open &= open << 1;
+    fill |= open & (fill << 2);  open &= open << 2;
+    fill |= open & (fill << 4);  open &= open << 4;
+    fill |= open & (fill << 8);  open &= open << 8;
+    fill |= open & (fill << 16); open &= open << 16;
+    fill |= open & (fill << 32);
+    return fill;
+}
+
+static uint64_t fill_down(uint64_t fill, uint64_t open) {
+    fill |= open & (fill >> 1);  open &= open >> 1;
+    fill |= open & (fill >> 2);  open &= open >> 2;
+    fill |= open & (fill >> 4);  open &= open >> 4;
+    fill |= open & (fill >> 8);  open &= open >> 8;
+    fill |= open & (fill >> 16); open &= open >> 16;
+    fill |= open & (fill >> 32);
+    return fill;
+}
+
+// Fills a row of the component to the ends of its open runs, carrying across
+// word boundaries. Returns true if the row changed
+static bool fill_row(uint64_t *row, const uint64_t *open, int stride) {
+    bool changed = false;
+    uint64_t carry = 0;
+    for (int k = 0; k < stride; k++) {
+        uint64_t filled = fill_up(row[k] | (carry & open[k]), open[k]);
+        carry = filled >> 63;
+        changed |= filled != row[k];
+        row[k] = filled;
+    }
+    carry = 0;
+    for (int k = stride - 1; k >= 0; k--) {
+        uint64_t filled = fill_down(row[k] | ((carry << 63) & open[k]), open[k]);
+        carry = filled & 1;
+        changed |= filled != row[k];
+        row[k] = filled;
+    }
+    return changed;
+}
+
+// Pulls the component into a row from a neighbouring row
+static bool fill_from(uint64_t *row, const uint64_t *neighbour, const uint64_t *open, int stride) {
+    bool grew = false;
+    for (int k = 0; k < stride; k++) {
+        uint64_t reached = neighbour[k] & open[k] & ~row[k];
+        if (reached) {
+            row[k] |= reached;
+            grew = true;
+        }
+    }
+    if (grew) fill_row(row, open, stride);
+    return grew;
+}
+
+static void pack_open_row(int **maze, CellMask *open, int row) {
+    uint64_t *bits = open->bits + (size_t)row * open->stride;
+    for (int col = 0; col < open->width; col++) {
+        if (is_open(maze, col, row)) bits[col / 64] |= 1ULL << (col % 64);
+    }
+}
+
+// The open cells 4-connected to (x, y), found as a flood fill over rows of
+// 64-bit words: every row is filled along its open runs, then the component
+// is pulled down and up through the rows, until a pass changes nothing.
+// Each pass handles a word per 64 cells, and a pass down and back up
+// follows any path that turns between up and down at most once.
+bool maze_connected_component(int **maze, int width, int height, int x, int y,
+                              CellMask *component) {
+    *component = mask_create(width, height);
+    CellMask open = mask_create(width, height);
+    if (!component->bits || !open.bits) {
+        mask_free(component);
+        mask_free(&open);
+        return false;
+    }
+
+    int stride = open.stride;
+    if (x >= 0 && x < width && y >= 0 && y < height && is_open(maze, x, y)) {
+        // rows of the open mask are packed the first time the fill reaches
+        // them, so a small component costs a few rows and not the whole maze
+        int packed_first = y, packed_last = y;
+        pack_open_row(maze, &open, y);
+
+        uint64_t *seed = component->bits + (size_t)y * stride;
+        seed[x / 64] |= 1ULL << (x % 64);
+        fill_row(seed, open.bits + (size_t)y * stride, stride);
+
+        int first = y, last = y;  // rows the component has reached so far
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int row = first + 1; row < height; row++) {
+                if (row > packed_last) pack_open_row(maze, &open, packed_last = row);
+                uint64_t *bits = component->bits + (size_t)row * stride;
+                if (fill_from(bits, bits - stride, open.bits + (size_t)row * stride, stride)) {
+                    changed = true;
+                    if (row > last) last = row;
+                } else if (row > last) {
+                    break;
+                }
+            }
+            for (int row = last - 1; row >= 0; row--) {
+                if (row < packed_first) pack_open_row(maze, &open, packed_first = row);
+                uint64_t *bits = component->bits + (size_t)row * stride;
+                if (fill_from(bits, bits + stride, open.bits + (size_t)row * stride, stride)) {
+                    changed = true;
+                    if (row < first) first = row;
+                } else if (row < first) {
+                    break;
+                }
+            }
+        }
+    }
+
+    mask_free(&open);
+    return true;
 }
 
 bool is_maze_solvable(int **maze, int width, int height, int start_x, int start_y, 
@@ -164,38 +438,91 @@ bool is_maze_solvable(int **maze, int width, int height, int start_x, int start_
         return false;
     }
 
-    bool visited[height][width];
-    memset(visited, 0, sizeof(visited));
+    CellMask component;
+    if (!maze_connected_component(maze, width, height, start_x, start_y, &component)) {
+        return false;
+    }
+    bool found = mask_test(&component, goal_x, goal_y);
+    mask_free(&component);
+    return found;
+}
 
-    typedef struct { int x, y; } Point;
-    Point queue[width * height];
-    int front = 0, rear = 0;
+// Steps from every open cell to the goal, walls taken into account: a
+// breadth-first search started from all open cells within GOAL_THRESHOLD of
+// the goal at once. Cells that cannot reach the goal get -1.
+bool maze_build_goal_distance(Simulationcontext *context) {
+    free(context->goal_distance);
+    int w = context->maze_width, h = context->maze_height;
+    size_t cells = (size_t)w * h;
+    context->goal_distance = malloc(cells * sizeof(int));
+    CellQueue queue;
+    if (!context->goal_distance || !queue_init(&queue, 4 * ((size_t)w + h))) {
+        free(context->goal_distance);
+        context->goal_distance = NULL;
+        return false;
+    }
+    int *distance = context->goal_distance;
+    for (size_t c = 0; c < cells; c++) distance[c] = -1;
 
-    queue[rear++] = (Point){start_x, start_y};
-    visited[start_y][start_x] = true;
+    int reach = (int)GOAL_THRESHOLD;
+    for (int y = context->goal_y - reach; y <= context->goal_y + reach; y++) {
+        for (int x = context->goal_x - reach; x <= context->goal_x + reach; x++) {
+            if (x < 0 || x >= w || y < 0 || y >= h) continue;
+            float dx = (float)(x - context->goal_x), dy = (float)(y - context->goal_y);
+            if (dx * dx + dy * dy > GOAL_THRESHOLD * GOAL_THRESHOLD) continue;
+            if (!is_open(context->maze, x, y) && !(x == context->goal_x && y == context->goal_y)) continue;
+            distance[(size_t)y * w + x] = 0;
+            queue_push(&queue, (uint32_t)y * w + x);
+        }
+    }
 
     int directions[4][2] = {{1,0},{-1,0},{0,1},{0,-1}};
+    bool ok = true;
+    while (queue.count > 0) {
+        uint32_t p = queue_pop(&queue);
+        int px = (int)(p % w), py = (int)(p / w);
+        for (int i = 0; i < 4; i++) {
+            int nx = px + directions[i][0];
+            int ny = py + directions[i][1];
+            if (nx < 0 || nx >= w || ny < 0 || ny >= h) continue;
 
-    while (front < rear) {
-        Point p = queue[front++];
-        if (p.x == goal_x && p.y == goal_y) {
-            return true;  // goal reached
+            size_t n = (size_t)ny * w + nx;
+            if (distance[n] >= 0 || !is_open(context->maze, nx, ny)) continue;
+            distance[n] = distance[p] + 1;
+            if (!queue_push(&queue, (uint32_t)n)) ok = false;
         }
+        if (!ok) break;
+    }
 
-        for (int i=0; i<4; i++) {
-            int nx = p.x + directions[i][0];
-            int ny = p.y + directions[i][1];
-
-            if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-                if (!visited[ny][nx] && maze[ny][nx] != WALL && maze[ny][nx] != BORDER) {
-                    visited[ny][nx] = true;
-                    queue[rear++] = (Point){nx, ny};
-                }
-            }
-        }
+    free(queue.cells);
+    if (!ok) {
+        free(context->goal_distance);
+        context->goal_distance = NULL;
     }
+    return ok;
+}
+
+typedef struct {
+    Simulationcontext *context;
+    bool built;
+} MazeBuild;
+
+static void build_solid_task(void *arg, int worker) {
+    (void)worker;
+    MazeBuild *build = arg;
+    build->built = maze_build_solid(build->context);
+}
 
-    return false;  // impossible to reache goal
+// Everything the simulation reads besides the grid: the wall tiles and the
+// distance field. Called once a maze is complete. The two only read the grid,
+// so with a scheduler the tiles are built on another worker while this thread
+// runs the search
+bool maze_prepare(Simulationcontext *context, TaskScheduler *scheduler) {
+    MazeBuild solid = {.context = context, .built = false};
+    scheduler_spawn(scheduler, build_solid_task, &solid);
+    bool distance = maze_build_goal_distance(context);
+    scheduler_wait(scheduler);
+    return solid.built && distance;
 }
 
 
@@ -218,5 +545,5 @@ void init_maze_id_counter(const char *filename){
     }
 
 int get_next_maze_id() {
-    return next_maze_id++;
+    return atomic_fetch_add(&next_maze_id, 1);
 }
\ No newline at end of file
@@ -2,14 +2,15 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "../include/configuration.h"
-#include "../include/types.h"
-#include "../include/menus.h"
-#include "../include/sims.h"
-#include "../include/logger.h"
-#include "../include/maze.h"
+#include "../Include/configuration.h"
+#include "../Include/types.h"
+#include "../Include/menus.h"
+#include "../Include/sims.h"
+#include "../Include/logger.h"
+#include "../Include/maze.h"
+#include "../Include/selection.h"
 
-int checkInput(char *choice_buffer, size_t buf_size, int *choice) {
+int checkInput(char *choice_buffer, size_t buf_size, int *choice, int max_choice) {
     if (!fgets(choice_buffer, buf_size, stdin)) {
         printf("Error reading input. Please try again.\n");
         return -1;
@@ -31,8 +32,8 @@ int checkInput(char *choice_buffer, size_t buf_size, int *choice) {
         return -1;
     }
 
-    if (*choice < 1 || *choice > 4) {
-        printf("Invalid choice! Please enter a number between 1 and 4.\n");
+    if (*choice < 1 || *choice > max_choice) {
+        printf("Invalid choice! Please enter a number between 1 and %d.\n", max_choice);
         return -1;
     }
     return 0;
@@ -66,12 +67,17 @@ void mainmenu()
     {
         printf("\n=== MAIN MENU ===\n");
         printf("1. Run simulation\n");
-        printf("2. Analysis submenu\n");
-        printf("3. Load maze (TBD)\n");
-        printf("4. Quit program\n");
-        printf("Enter your choice (1-4):");
+        printf("2. Run island simulation (one population per core)\n");
+        printf("3. Run distributed simulation (coordinator for robotworker)\n");
+        printf("4. Run steady-state simulation (no generation barrier, all cores)\n");
+        printf("5. Selection settings\n");
+        printf("6. Maze size (%dx%d)\n", context.maze_width, context.maze_height);
+        printf("7. Analysis submenu\n");
+        printf("8. Load maze (TBD)\n");
+        printf("9. Quit program\n");
+        printf("Enter your choice (1-9):");
         
-        if (checkInput(choice_buffer, sizeof(choice_buffer), &choice) != 0) {
+        if (checkInput(choice_buffer, sizeof(choice_buffer), &choice, 9) != 0) {
         continue;
         }
         
@@ -91,20 +97,56 @@ void mainmenu()
                 break;
 
             case 2:
+                printf("\nStarting island simulation...\n");
+                use_elite = load_best_individual_from_file_wrapper(&elite, "robot_log.json");
+                if (use_elite) {
+                    printf("Elite individual found, fitness %.2f, seeding every island\n", elite.fitness);
+                }
+
+                simulate_islands(&context, &elite, use_elite);
+                printf("\nEvolution completed!\n");
+                break;
+
+            case 3:
+                printf("\nStarting distributed simulation...\n");
+                use_elite = load_best_individual_from_file_wrapper(&elite, "robot_log.json");
+
+                simulate_distributed(&context, &elite, use_elite);
+                printf("\nEvolution completed!\n");
+                break;
+
+            case 4:
+                printf("\nStarting steady-state simulation...\n");
+                use_elite = load_best_individual_from_file_wrapper(&elite, "robot_log.json");
+                if (use_elite) {
+                    printf("Elite individual found, fitness %.2f\n", elite.fitness);
+                }
+
+                simulate_steady_state(&context, &elite, use_elite);
+                printf("\nEvolution completed!\n");
+                break;
+
+            case 5:
+                selection_submenu();
+                break;
+
+            case 6:
+                maze_size_setting(&context);
+                break;
+
+            case 7:
                 analysis_submenu();
                 break;
             
-            case 3:
+            case 8:
                 printf("\nLoad maze feature not implemented yet.\n");
                 break;
             
-            case 4:
+            case 9:
                 printf("\nThank you for using the simulation program. Goodbye!\n");
                 
                 // Cleanup before exit
-                if (context.maze) {
-                    free_matrix(context.maze, context.maze_height);
-                }
+                maze_release(&context);
                 return;
             
             default:
@@ -114,6 +156,104 @@ void mainmenu()
     }
 }
 
+// Reads a number for a setting, returns false if the input is not a number
+static bool read_setting(const char *prompt, float *value) {
+    char buffer[100];
+    printf("%s", prompt);
+    if (!fgets(buffer, sizeof(buffer), stdin)) return false;
+
+    char *endptr;
+    *value = strtof(buffer, &endptr);
+    if (endptr == buffer) {
+        printf("Invalid input! Please enter a number.\n");
+        return false;
+    }
+    return true;
+}
+
+// Size of the mazes the next run generates
+void maze_size_setting(Simulationcontext *context) {
+    float width, height;
+    if (!read_setting("Maze width: ", &width) || !read_setting("Maze height: ", &height)) return;
+    if (width < MIN_MAZE_SIZE || width > MAX_MAZE_SIZE ||
+        height < MIN_MAZE_SIZE || height > MAX_MAZE_SIZE) {
+        printf("Width and height must be between %d and %d\n", MIN_MAZE_SIZE, MAX_MAZE_SIZE);
+        return;
+    }
+    context->maze_width = (int)width;
+    context->maze_height = (int)height;
+    printf("Mazes will be %dx%d\n", context->maze_width, context->maze_height);
+}
+
+void selection_submenu() {
+    char choice_buffer[100];
+    int choice;
+    float value;
+    SelectionConfig *config = &selection_config;
+
+    while(true) {
+        printf("\n=== SELECTION SETTINGS ===\n");
+        printf("Current: %s, %d elites, tournament size %d, rank pressure %.2f, mutation rate %.2f\n",
+               selection_method_name(config->method), config->elite_count,
+               config->tournament_size, config->rank_pressure, config->mutation_rate);
+        printf("1. Tournament selection\n");
+        printf("2. Rank selection\n");
+        printf("3. k-elite selection (parents drawn from the elites)\n");
+        printf("4. NSGA-II (time, energy, distance, collisions and goal as separate objectives)\n");
+        printf("5. Set elite count\n");
+        printf("6. Set tournament size\n");
+        printf("7. Set rank pressure\n");
+        printf("8. Set mutation rate\n");
+        printf("9. Return to main menu\n");
+        printf("Choose option (1-9): ");
+
+        if (checkInput(choice_buffer, sizeof(choice_buffer), &choice, 9) != 0) {
+            continue;
+        }
+
+        switch (choice) {
+            case 1:
+                config->method = SELECTION_TOURNAMENT;
+                break;
+            case 2:
+                config->method = SELECTION_RANK;
+                break;
+            case 3:
+                config->method = SELECTION_ELITE;
+                break;
+            case 4:
+                config->method = SELECTION_PARETO;
+                break;
+            case 5:
+                if (read_setting("Elite count: ", &value)) {
+                    if (value >= 0 && value < POP_SIZE) config->elite_count = (int)value;
+                    else printf("Elite count must be between 0 and %d\n", POP_SIZE - 1);
+                }
+                break;
+            case 6:
+                if (read_setting("Tournament size: ", &value)) {
+                    if (value >= 1 && value <= POP_SIZE) config->tournament_size = (int)value;
+                    else printf("Tournament size must be between 1 and %d\n", POP_SIZE);
+                }
+                break;
+            case 7:
+                if (read_setting("Rank pressure (1-2): ", &value)) {
+                    if (value >= 1.0f && value <= 2.0f) config->rank_pressure = value;
+                    else printf("Rank pressure must be between 1 and 2\n");
+                }
+                break;
+            case 8:
+                if (read_setting("Mutation rate (0-1): ", &value)) {
+                    if (value >= 0.0f && value <= 1.0f) config->mutation_rate = value;
+                    else printf("Mutation rate must be between 0 and 1\n");
+                }
+                break;
+            case 9:
+                return;
+        }
+    }
+}
+
 void analysis_submenu() {
     char choice_buffer[100];
     int choice;
@@ -247,7 +387,7 @@ void analysis_submenu() {
                     endptr++;
                 }
                 if (endptr == choice_buffer || *endptr != '\0' || desired_generation < 0 || desired_generation > NUM_GENERATIONS) {
-                    printf("Invalid choice! Enter a number between 0- %d.\n" NUM_GENERATIONS);
+                    printf("Invalid choice! Enter a number between 0- %d.\n", NUM_GENERATIONS);
                     continue;
                 }
 
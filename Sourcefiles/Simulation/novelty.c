@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <math.h>
+#include "../Include/novelty.h"
+
+static unsigned bucket_of(int cell_x, int cell_y) {
+    return ((unsigned)cell_x * 73856093u ^ (unsigned)cell_y * 19349663u) & (NOVELTY_BUCKETS - 1);
+}
+
+static void file_entry(NoveltyArchive *archive, int slot) {
+    NoveltyEntry *entry = &archive->entries[slot];
+    entry->cell_x = (int)(entry->x / archive->cell_size);
+    entry->cell_y = (int)(entry->y / archive->cell_size);
+    unsigned bucket = bucket_of(entry->cell_x, entry->cell_y);
+    entry->next = archive->buckets[bucket];
+    archive->buckets[bucket] = slot;
+}
+
+static void unfile_entry(NoveltyArchive *archive, int slot) {
+    const NoveltyEntry *entry = &archive->entries[slot];
+    int *link = &archive->buckets[bucket_of(entry->cell_x, entry->cell_y)];
+    while (*link != slot) link = &archive->entries[*link].next;
+    *link = entry->next;
+}
+
+// Cells sized so that about NOVELTY_NEIGHBOURS entries share one if they were
+// spread evenly. Choosing again each time the archive doubles keeps a query to
+// a few cells, and refiling costs O(1) per entry added
+static void reindex(NoveltyArchive *archive) {
+    float area = (float)archive->visited.width * archive->visited.height;
+    archive->cell_size = fmaxf(1.0f, sqrtf(area * NOVELTY_NEIGHBOURS / archive->count));
+    archive->indexed_count = archive->count;
+    for (int b = 0; b < NOVELTY_BUCKETS; b++) archive->buckets[b] = -1;
+    for (int slot = 0; slot < archive->count; slot++) file_entry(archive, slot);
+}
+
+bool novelty_init(NoveltyArchive *archive) {
+    archive->entries = malloc(NOVELTY_ARCHIVE * sizeof(NoveltyEntry));
+    archive->buckets = malloc(NOVELTY_BUCKETS * sizeof(int));
+    archive->count = 0;
+    archive->next = 0;
+    archive->indexed_count = 0;
+    archive->visited = (CellMask){.bits = NULL};
+    archive->maze_id = -1;
+    if (!archive->entries || !archive->buckets) {
+        novelty_free(archive);
+        return false;
+    }
+    return true;
+}
+
+void novelty_free(NoveltyArchive *archive) {
+    free(archive->entries);
+    free(archive->buckets);
+    mask_free(&archive->visited);
+    archive->entries = NULL;
+    archive->buckets = NULL;
+    archive->count = 0;
+}
+
+// Positions and cells are only comparable on one maze
+bool novelty_begin_maze(NoveltyArchive *archive, const Simulationcontext *context) {
+    if (!archive->entries) return false;
+    if (archive->maze_id == context->maze_id && archive->visited.bits) return true;
+    mask_free(&archive->visited);
+    archive->visited = mask_create(context->maze_width, context->maze_height);
+    archive->count = 0;
+    archive->next = 0;
+    archive->indexed_count = 0;
+    archive->maze_id = context->maze_id;
+    return archive->visited.bits != NULL;
+}
+
+// Mean distance to the nearest archived final positions. The cells are read
+// in rings around the one (x, y) is in. An entry in ring r + 1 is at least
+// r cells away, so the search ends once the neighbours found are closer
+static float nearest_mean_distance(const NoveltyArchive *archive, float x, float y) {
+    int k = NOVELTY_NEIGHBOURS < archive->count ? NOVELTY_NEIGHBOURS : archive->count;
+    float nearest[NOVELTY_NEIGHBOURS];        // squared distances, ascending
+    int found = 0;
+
+    float cell_size = archive->cell_size;
+    int cell_x = (int)(x / cell_size), cell_y = (int)(y / cell_size);
+    int cells_x = (int)(archive->visited.width / cell_size) + 1;
+    int cells_y = (int)(archive->visited.height / cell_size) + 1;
+    int last_ring = cells_x > cells_y ? cells_x : cells_y;
+
+    for (int ring = 0; ring <= last_ring; ring++) {
+        for (int dy = -ring; dy <= ring; dy++) {
+            int cy = cell_y + dy;
+            if (cy < 0 || cy >= cells_y) continue;
+            // the whole row on the top and bottom edge, the two ends in between
+            int step = (dy == -ring || dy == ring) ? 1 : 2 * ring;   // ring > 0 in between
+            for (int dx = -ring; dx <= ring; dx += step) {
+                int cx = cell_x + dx;
+                if (cx < 0 || cx >= cells_x) continue;
+                for (int e = archive->buckets[bucket_of(cx, cy)]; e >= 0; e = archive->entries[e].next) {
+                    const NoveltyEntry *entry = &archive->entries[e];
+                    if (entry->cell_x != cx || entry->cell_y != cy) continue;
+                    float ex = entry->x - x, ey = entry->y - y;
+                    float d = ex * ex + ey * ey;
+                    if (found == k && d >= nearest[k - 1]) continue;
+
+                    int i = found < k ? found++ : k - 1;
+                    while (i > 0 && nearest[i - 1] > d) {
+                        nearest[i] = nearest[i - 1];
+                        i--;
+                    }
+                    nearest[i] = d;
+                }
+            }
+        }
+        float reach = ring * cell_size;
+        if (found == k && nearest[k - 1] <= reach * reach) break;
+    }
+
+    float total = 0;
+    for (int i = 0; i < found; i++) total += sqrtf(nearest[i]);
+    return found > 0 ? total / found : 0.0f;
+}
+
+float novelty_score(const NoveltyArchive *archive, const Individual *individual,
+                    const MovementLog *movements, int movement_count) {
+    if (!archive->visited.bits) return 0.0f;
+    float novelty = 0;
+    if (archive->count > 0) {
+        novelty += nearest_mean_distance(archive, individual->robot.x, individual->robot.y);
+    }
+    if (movement_count > 0) {
+        int unseen = 0;
+        for (int m = 0; m < movement_count; m++) {
+            int x = (int)movements[m].x, y = (int)movements[m].y;
+            if (x >= 0 && y >= 0 && x < archive->visited.width && y < archive->visited.height &&
+                !mask_test(&archive->visited, x, y)) {
+                unseen++;
+            }
+        }
+        novelty += NOVELTY_CELL_WEIGHT * unseen / movement_count;
+    }
+    return novelty;
+}
+
+// A full archive replaces its oldest entry. The visited cells are kept for
+// as long as the maze is, the replaced entries' cells included
+void novelty_add(NoveltyArchive *archive, const Individual *individual,
+                 const MovementLog *movements, int movement_count) {
+    if (!archive->visited.bits) return;
+    for (int m = 0; m < movement_count; m++) {
+        int x = (int)movements[m].x, y = (int)movements[m].y;
+        if (x >= 0 && y >= 0 && x < archive->visited.width && y < archive->visited.height) {
+            mask_set(&archive->visited, x, y);
+        }
+    }
+
+    int slot = archive->next;
+    if (archive->count == NOVELTY_ARCHIVE) {
+        unfile_entry(archive, slot);
+    } else {
+        archive->count++;
+    }
+    archive->next = (archive->next + 1) % NOVELTY_ARCHIVE;
+    archive->entries[slot].x = individual->robot.x;
+    archive->entries[slot].y = individual->robot.y;
+    if (archive->count >= 2 * archive->indexed_count) {
+        reindex(archive);
+    } else {
+        file_entry(archive, slot);
+    }
+}
@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "../Include/pareto.h"
+
+#define PARETO_BLOCK 256     // points searched in parallel before they are compared with each other
+
+typedef struct {
+    const float *values;
+    int objective_count;
+    int index;
+} SortEntry;
+
+static int compare_lexicographic(const void *a, const void *b) {
+    const SortEntry *x = a, *y = b;
+    for (int o = 0; o < x->objective_count; o++) {
+        if (x->values[o] < y->values[o]) return -1;
+        if (x->values[o] > y->values[o]) return 1;
+    }
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+static bool dominates(const float *a, const float *b, int objective_count) {
+    bool better = false;
+    for (int o = 0; o < objective_count; o++) {
+        if (a[o] > b[o]) return false;
+        if (a[o] < b[o]) better = true;
+    }
+    return better;
+}
+
+// The fronts found so far, over the points in lexicographic order
+typedef struct {
+    const float *points;
+    int objective_count;
+    int *front;                       // front of each point
+    int *previous;                    // previous point in the same front, -1 at the first
+    int *last;                        // last point of each front
+    int front_count;
+    int block_start;
+} FrontSearch;
+
+static bool front_dominates(const FrontSearch *search, int front, int point) {
+    int m = search->objective_count;
+    const float *p = search->points + (size_t)point * m;
+    for (int q = search->last[front]; q >= 0; q = search->previous[q]) {
+        if (dominates(search->points + (size_t)q * m, p, m)) return true;
+    }
+    return false;
+}
+
+// A point dominated by a member of front f is also dominated by one of each
+// front before f, so the first front without a dominator is found by
+// bisection. Only the fronts before the block are read
+static void search_task(void *arg, int i, int worker) {
+    (void)worker;
+    FrontSearch *search = arg;
+    int point = search->block_start + i;
+    int lo = 0, hi = search->front_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (front_dominates(search, mid, point)) lo = mid + 1;
+        else hi = mid;
+    }
+    search->front[point] = lo;
+}
+
+// Within the block a point can still be dominated by the ones before it
+static void settle_block(FrontSearch *search, int start, int end) {
+    int m = search->objective_count;
+    for (int point = start; point < end; point++) {
+        const float *p = search->points + (size_t)point * m;
+        int front = search->front[point];
+        for (int q = start; q < point; q++) {
+            if (search->front[q] >= front && dominates(search->points + (size_t)q * m, p, m)) {
+                front = search->front[q] + 1;
+            }
+        }
+        search->front[point] = front;
+        if (front == search->front_count) search->last[search->front_count++] = -1;
+        search->previous[point] = search->last[front];
+        search->last[front] = point;
+    }
+}
+
+typedef struct {
+    float value;
+    int point;
+} CrowdingEntry;
+
+static int compare_crowding_entries(const void *a, const void *b) {
+    float x = ((const CrowdingEntry *)a)->value, y = ((const CrowdingEntry *)b)->value;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    const float *points;
+    int objective_count;
+    const int *members;               // points grouped by front
+    const int *offsets;               // first member of each front, front_count + 1 entries
+    CrowdingEntry *entries;           // scratch, a front uses the entries at its offset
+    float *distance;                  // crowding distance of each point
+} CrowdingTasks;
+
+// Sum over the objectives of the gap between a point's neighbours in the
+// front, relative to the front's range. The ends of an objective the front
+// spreads over are kept, one all its points share adds nothing
+static void crowding_task(void *arg, int front, int worker) {
+    (void)worker;
+    CrowdingTasks *tasks = arg;
+    const int *members = tasks->members + tasks->offsets[front];
+    CrowdingEntry *entries = tasks->entries + tasks->offsets[front];
+    int n = tasks->offsets[front + 1] - tasks->offsets[front];
+    int m = tasks->objective_count;
+    for (int k = 0; k < n; k++) tasks->distance[members[k]] = n > 2 ? 0.0f : INFINITY;
+    if (n <= 2) return;
+
+    for (int o = 0; o < m; o++) {
+        for (int k = 0; k < n; k++) {
+            entries[k].value = tasks->points[(size_t)members[k] * m + o];
+            entries[k].point = members[k];
+        }
+        qsort(entries, n, sizeof(CrowdingEntry), compare_crowding_entries);
+        float span = entries[n - 1].value - entries[0].value;
+        if (span <= 0) continue;
+        tasks->distance[entries[0].point] = INFINITY;
+        tasks->distance[entries[n - 1].point] = INFINITY;
+        for (int k = 1; k < n - 1; k++) {
+            tasks->distance[entries[k].point] += (entries[k + 1].value - entries[k - 1].value) / span;
+        }
+    }
+}
+
+// Scratch space of one sort, count entries each (offsets count + 1)
+typedef struct {
+    SortEntry *entries;
+    float *points;
+    int *front, *previous, *last;
+    int *members, *offsets;
+    CrowdingEntry *crowding_entries;
+    float *distance;
+} ParetoBuffers;
+
+static int sort_fronts(const float *objectives, int count, int m, int *fronts, float *crowding,
+                       TaskScheduler *scheduler, const ParetoBuffers *b) {
+    // A point can only be dominated by points before it in lexicographic order
+    for (int i = 0; i < count; i++) {
+        b->entries[i].values = objectives + (size_t)i * m;
+        b->entries[i].objective_count = m;
+        b->entries[i].index = i;
+    }
+    qsort(b->entries, count, sizeof(SortEntry), compare_lexicographic);
+    for (int p = 0; p < count; p++) {
+        for (int o = 0; o < m; o++) b->points[(size_t)p * m + o] = b->entries[p].values[o];
+    }
+
+    FrontSearch search = {
+        .points = b->points,
+        .objective_count = m,
+        .front = b->front,
+        .previous = b->previous,
+        .last = b->last,
+        .front_count = 0,
+    };
+    for (int start = 0; start < count; start += PARETO_BLOCK) {
+        int end = start + PARETO_BLOCK < count ? start + PARETO_BLOCK : count;
+        search.block_start = start;
+        scheduler_parallel_for(scheduler, end - start, 16, search_task, &search);
+        settle_block(&search, start, end);
+    }
+    int front_count = search.front_count;
+
+    // members grouped by front, offsets[f] where front f starts
+    int *offsets = b->offsets;
+    for (int f = 0; f <= front_count; f++) offsets[f] = 0;
+    for (int p = 0; p < count; p++) offsets[b->front[p] + 1]++;
+    for (int f = 0; f < front_count; f++) offsets[f + 1] += offsets[f];
+    for (int p = 0; p < count; p++) b->members[offsets[b->front[p]]++] = p;
+    for (int f = front_count; f > 0; f--) offsets[f] = offsets[f - 1];
+    offsets[0] = 0;
+
+    CrowdingTasks tasks = {
+        .points = b->points,
+        .objective_count = m,
+        .members = b->members,
+        .offsets = offsets,
+        .entries = b->crowding_entries,
+        .distance = b->distance,
+    };
+    scheduler_parallel_for(scheduler, front_count, 1, crowding_task, &tasks);
+
+    for (int p = 0; p < count; p++) {
+        fronts[b->entries[p].index] = b->front[p];
+        crowding[b->entries[p].index] = b->distance[p];
+    }
+    return front_count;
+}
+
+int pareto_sort(const float *objectives, int count, int objective_count,
+                int *fronts, float *crowding, TaskScheduler *scheduler) {
+    if (count <= 0) return 0;
+    ParetoBuffers buffers = {
+        .entries = malloc(count * sizeof(SortEntry)),
+        .points = malloc((size_t)count * objective_count * sizeof(float)),
+        .front = malloc(count * sizeof(int)),
+        .previous = malloc(count * sizeof(int)),
+        .last = malloc(count * sizeof(int)),
+        .members = malloc(count * sizeof(int)),
+        .offsets = malloc((count + 1) * sizeof(int)),
+        .crowding_entries = malloc(count * sizeof(CrowdingEntry)),
+        .distance = malloc(count * sizeof(float)),
+    };
+    int front_count = -1;
+    if (buffers.entries && buffers.points && buffers.front && buffers.previous && buffers.last &&
+        buffers.members && buffers.offsets && buffers.crowding_entries && buffers.distance) {
+        front_count = sort_fronts(objectives, count, objective_count, fronts, crowding, scheduler, &buffers);
+    }
+    free(buffers.entries);
+    free(buffers.points);
+    free(buffers.front);
+    free(buffers.previous);
+    free(buffers.last);
+    free(buffers.members);
+    free(buffers.offsets);
+    free(buffers.crowding_entries);
+    free(buffers.distance);
+    return front_count;
+}
@@ -0,0 +1,31 @@
+#include <stdint.h>
+#include "../Include/rng.h"
+
+// Every thread starts from the same state until it is seeded
+static _Thread_local uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+void rng_seed(uint64_t seed) {
+    // splitmix64 spreads nearby seeds (time, island index) over the state space
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    rng_state = z ? z : 0x9E3779B97F4A7C15ULL;
+}
+
+uint32_t rng_next(void) {
+    uint64_t x = rng_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng_state = x;
+    return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+int rng_int(int n) {
+    return (int)(((uint64_t)rng_next() * (uint32_t)n) >> 32);
+}
+
+float rng_float(void) {
+    return (float)rng_next() / (float)UINT32_MAX;
+}
@@ -2,15 +2,23 @@
 #include <stdbool.h>
 #include <stdio.h>
 
-#include "../include/configuration.h"
-#include "../include/robot.h"
-#include "../include/rotation.h"
-#include "../include/types.h"
-#include "../include/maze.h"
+#include "../Include/configuration.h"
+#include "../Include/robot.h"
+#include "../Include/rotation.h"
+#include "../Include/types.h"
+#include "../Include/maze.h"
+#include "../Include/instrument.h"
 
-#define MOVE_DISTANCE 1.0f
 #define TURN_ANGLE_45 (M_PI / 4.0f)
-#define GOAL_THRESHOLD 2.0f
+
+// Direction for each of the eight orientations, exact so that straight runs
+// do not drift off the grid axes and diagonals
+static const float HEADINGS[8][2] = {
+    { 1.0f, 0.0f}, { (float)M_SQRT1_2,  (float)M_SQRT1_2},
+    { 0.0f, 1.0f}, {-(float)M_SQRT1_2,  (float)M_SQRT1_2},
+    {-1.0f, 0.0f}, {-(float)M_SQRT1_2, -(float)M_SQRT1_2},
+    { 0.0f,-1.0f}, { (float)M_SQRT1_2, -(float)M_SQRT1_2}
+};
 
 // Initiate robot whith standardvalues
 void initialize_robot(Robot *robot, float start_x, float start_y) {
@@ -19,26 +27,60 @@ void initialize_robot(Robot *robot, float start_x, float start_y) {
     robot->angle = 0.0f;        // points towards the right
     robot->width = 2.0f;
     robot->height = 2.0f;
-    robot->orientation = 0;
+    update_orientation(robot);
 }
 
+// Recomputes orientation and heading after robot->angle was set directly.
+// Angles on the 45 degree grid read the table, any other angle the fast sincos
 void update_orientation(Robot *robot) {
-    float normalized_angle = fmod(robot->angle + 2 * M_PI, 2 * M_PI);
-    robot->orientation = (int)((normalized_angle + M_PI / 8) / (M_PI / 4)) % 8;
+    float octants = robot->angle / (float)(M_PI / 4);
+    int nearest = (int)floorf(octants + 0.5f);
+    robot->orientation = ((nearest % 8) + 8) % 8;
+    if (fabsf(octants - nearest) < 1e-4f) {
+        robot->heading_x = HEADINGS[robot->orientation][0];
+        robot->heading_y = HEADINGS[robot->orientation][1];
+    } else {
+        fast_sincosf(robot->angle, &robot->heading_y, &robot->heading_x);
+    }
+}
+
+// Puts the robot back in a pose it had during a simulation. Turns keep the
+// heading on the 45 degree grid, so it comes from the table like in turn,
+// whatever rounding the angle has collected
+void restore_robot_pose(Robot *robot, float x, float y, float angle) {
+    robot->x = x;
+    robot->y = y;
+    robot->angle = angle;
+    int nearest = (int)floorf(angle / (float)(M_PI / 4) + 0.5f);
+    robot->orientation = ((nearest % 8) + 8) % 8;
+    robot->heading_x = HEADINGS[robot->orientation][0];
+    robot->heading_y = HEADINGS[robot->orientation][1];
+}
+
+// Turns by a number of 45 degree steps, positive to the right
+static void turn(Robot *robot, int octants) {
+    robot->angle += octants * TURN_ANGLE_45;
+    while (robot->angle < 0) robot->angle += 2 * M_PI;
+    while (robot->angle >= 2 * M_PI) robot->angle -= 2 * M_PI;
+    robot->orientation = (robot->orientation + octants + 8) % 8;
+    robot->heading_x = HEADINGS[robot->orientation][0];
+    robot->heading_y = HEADINGS[robot->orientation][1];
 }
 
 void get_direction_vector(Robot *robot, float *dx, float *dy) {
-    *dx = cos(robot->angle);
-    *dy = sin(robot->angle);
+    *dx = robot->heading_x;
+    *dy = robot->heading_y;
 }
 
 bool reached_goal(Robot *robot, Simulationcontext *context) {
-    float distance = sqrtf(powf(robot->x - context->goal_x, 2) + 
-                           powf(robot->y - context->goal_y, 2));
-    return distance <= GOAL_THRESHOLD;
+    float dx = robot->x - context->goal_x;
+    float dy = robot->y - context->goal_y;
+    return dx * dx + dy * dy <= GOAL_THRESHOLD * GOAL_THRESHOLD;
 }
 
-bool check_collision(Robot *robot, float x, float y, float angle, Simulationcontext *context) {
+// Corners of the robot rotated by (cos_a, sin_a) and placed at (x, y)
+static bool collides(Robot *robot, float x, float y, float cos_a, float sin_a,
+                     Simulationcontext *context) {
     float local_corners[4][2] = {
         {-robot->width / 2, -robot->height / 2},
         { robot->width / 2, -robot->height / 2},
@@ -47,35 +89,40 @@ bool check_collision(Robot *robot, float x, float y, float angle, Simulationcont
     };
 
     for (int i = 0; i < 4; i++) {
-        float world_x, world_y;
-        rotate_point(local_corners[i][0], local_corners[i][1], angle, &world_x, &world_y);
-        world_x += x;
-        world_y += y;
+        float world_x = local_corners[i][0] * cos_a - local_corners[i][1] * sin_a + x;
+        float world_y = local_corners[i][0] * sin_a + local_corners[i][1] * cos_a + y;
 
-        int grid_x = (int)floor(world_x);
-        int grid_y = (int)floor(world_y);
+        int grid_x = (int)floorf(world_x);
+        int grid_y = (int)floorf(world_y);
 
         if (grid_x < 0 || grid_x >= context->maze_width || 
             grid_y < 0 || grid_y >= context->maze_height)
             return true;
 
-        if (context->maze[grid_y][grid_x] == WALL || context->maze[grid_y][grid_x] == BORDER)
+        if (maze_is_solid(context, grid_x, grid_y))
             return true;
     }
 
     return false;
 }
 
+bool check_collision(Robot *robot, float x, float y, float angle, Simulationcontext *context) {
+    float cos_a = robot->heading_x, sin_a = robot->heading_y;
+    if (angle != robot->angle) fast_sincosf(angle, &sin_a, &cos_a);
+    return collides(robot, x, y, cos_a, sin_a, context);
+}
+
 bool execute_action(Individual *individual, Action action, Simulationcontext *context) {
     Robot *robot = &individual->robot;
 
     switch (action) {
         case FORWARD: {
-            float new_x = robot->x + cos(robot->angle) * MOVE_DISTANCE;
-            float new_y = robot->y + sin(robot->angle) * MOVE_DISTANCE;
+            float new_x = robot->x + robot->heading_x * MOVE_DISTANCE;
+            float new_y = robot->y + robot->heading_y * MOVE_DISTANCE;
 
-            if (check_collision(robot, new_x, new_y, robot->angle, context)) {
+            if (collides(robot, new_x, new_y, robot->heading_x, robot->heading_y, context)) {
                 individual->collision_count++;
+                INSTR_COUNT(INSTR_COLLISIONS, 1);
                 return false;
             }
 
@@ -85,11 +132,12 @@ bool execute_action(Individual *individual, Action action, Simulationcontext *co
         }
 
         case BACKWARD: {
-            float new_x = robot->x - cos(robot->angle) * MOVE_DISTANCE;
-            float new_y = robot->y - sin(robot->angle) * MOVE_DISTANCE;
+            float new_x = robot->x - robot->heading_x * MOVE_DISTANCE;
+            float new_y = robot->y - robot->heading_y * MOVE_DISTANCE;
 
-            if (check_collision(robot, new_x, new_y, robot->angle, context)) {
+            if (collides(robot, new_x, new_y, robot->heading_x, robot->heading_y, context)) {
                 individual->collision_count++;
+                INSTR_COUNT(INSTR_COLLISIONS, 1);
                 return false;
             }
 
@@ -99,20 +147,17 @@ bool execute_action(Individual *individual, Action action, Simulationcontext *co
         }
 
         case TURN_LEFT_45:
-            robot->angle -= TURN_ANGLE_45;
-            while (robot->angle < 0) robot->angle += 2 * M_PI;
+            turn(robot, -1);
             break;
 
         case TURN_RIGHT_45:
-            robot->angle += TURN_ANGLE_45;
-            while (robot->angle >= 2 * M_PI) robot->angle -= 2 * M_PI;
+            turn(robot, 1);
             break;
 
         default:
             return false;
     }
 
-    update_orientation(robot);
     return true;
 }
 
@@ -120,23 +165,74 @@ bool execute_action(Individual *individual, Action action, Simulationcontext *co
 float simulate_ultrasonic(Individual *individual, int sensor_id, Simulationcontext *context) {
     float start_x = individual->robot.x;
     float start_y = individual->robot.y;
-    float angle = individual->robot.angle + context->sensors[sensor_id].angle;
-
+    // the ray is the heading rotated by the mounting angle of the sensor
+    float sin_m, cos_m;
+    fast_sincosf(context->sensors[sensor_id].angle, &sin_m, &cos_m);
+    float dx = individual->robot.heading_x * cos_m - individual->robot.heading_y * sin_m;
+    float dy = individual->robot.heading_x * sin_m + individual->robot.heading_y * cos_m;
+
+    // the cells counted are the samples read, whether the ray hits or runs out
+    int samples = 0;
+    (void)samples;   // only read with INSTRUMENTATION
     for (float dist = 0; dist < context->sensors[sensor_id].range; dist += 0.5f) {
-        int check_x = (int)(start_x + cos(angle) * dist);
-        int check_y = (int)(start_y + sin(angle) * dist);
+        int check_x = (int)(start_x + dx * dist);
+        int check_y = (int)(start_y + dy * dist);
+        samples++;
 
         if (check_x < 0 || check_x >= context->maze_width || 
-            check_y < 0 || check_y >= context->maze_height)
+            check_y < 0 || check_y >= context->maze_height) {
+            INSTR_COUNT(INSTR_RAYCAST_CELLS, samples);
             return dist;
+        }
 
-        if (context->maze[check_y][check_x] == WALL || context->maze[check_y][check_x] == BORDER)
+        if (maze_is_solid(context, check_x, check_y)) {
+            INSTR_COUNT(INSTR_RAYCAST_CELLS, samples);
             return dist;
+        }
     }
 
+    INSTR_COUNT(INSTR_RAYCAST_CELLS, samples);
     return context->sensors[sensor_id].range;
 }
 
+// Front sensor readings for the next steps of a straight FORWARD run from one
+// scan along the ray instead of a ray per step. On an axis-aligned heading the
+// ray stays on one row or column and a step moves every sample exactly two
+// samples along it, as long as the coordinates stay exact in float. Fills
+// readings[j] with what simulate_ultrasonic would return after j steps and
+// returns how many were filled, 0 when the heading or the range rules it out
+int front_readings_ahead(Individual *individual, Simulationcontext *context, int steps,
+                         float *readings) {
+    const Robot *robot = &individual->robot;
+    const Sensor *front = &context->sensors[0];
+    if (steps <= 0 || front->angle != 0.0f || (robot->orientation & 1)) return 0;
+
+    bool along_x = robot->heading_y == 0.0f;
+    float origin = along_x ? robot->x : robot->y;
+    float sign = along_x ? robot->heading_x : robot->heading_y;
+    int across = (int)(along_x ? robot->y : robot->x);
+    int length = along_x ? context->maze_width : context->maze_height;
+    bool across_inside = across >= 0 && across < (along_x ? context->maze_height : context->maze_width);
+
+    int per_reading = (int)ceilf(front->range * 2);   // samples at 0, 0.5, ... below range
+    int total = 2 * (steps - 1) + per_reading;
+    float last = (total - 1) * 0.5f;
+    if ((double)(origin + sign * last) != (double)origin + (double)sign * last) return 0;
+
+    int next_hit = total;   // first solid or outside sample at or after k
+    for (int k = total - 1; k >= 0; k--) {
+        int cell = (int)(origin + sign * (k * 0.5f));
+        bool hit = !across_inside || cell < 0 || cell >= length ||
+                   (along_x ? maze_is_solid(context, cell, across) : maze_is_solid(context, across, cell));
+        if (hit) next_hit = k;
+        if (k % 2 == 0 && k / 2 < steps) {
+            readings[k / 2] = next_hit - k < per_reading ? (next_hit - k) * 0.5f : front->range;
+        }
+    }
+    INSTR_COUNT(INSTR_RAYCAST_CELLS, total);
+    return steps;
+}
+
 void print_robot_status(Robot *robot) {
     printf("Robot: (%.1f, %.1f), angle=%.2f rad, orientation=%d\n",
            robot->x, robot->y, robot->angle, robot->orientation);
@@ -1,10 +1,33 @@
 #include <math.h>
-#include "../include/rotation.h"
-#include "../include/robot.h"
+#include "../Include/rotation.h"
+#include "../Include/robot.h"
+
+// Single precision sine and cosine without libm: the angle is reduced to
+// [-pi/4, pi/4] around the nearest quarter turn, with pi/2 split in three
+// parts so the reduction stays exact for angles of a few turns, and both are
+// evaluated with the Cephes polynomials (about 1 ulp on that interval)
+void fast_sincosf(float angle, float *sin_out, float *cos_out) {
+    float turns = angle * (float)(2.0 / M_PI);
+    int quadrant = (int)(turns + (turns >= 0 ? 0.5f : -0.5f));
+    float r = ((angle - quadrant * 1.5703125f) - quadrant * 4.837512969970703125e-4f)
+              - quadrant * 7.54978995489188216e-8f;
+    float r2 = r * r;
+
+    float s = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    float c = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f +
+              r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+    switch (quadrant & 3) {
+        case 0: *sin_out =  s; *cos_out =  c; break;
+        case 1: *sin_out =  c; *cos_out = -s; break;
+        case 2: *sin_out = -s; *cos_out = -c; break;
+        default: *sin_out = -c; *cos_out =  s; break;
+    }
+}
 
 void rotate_point(float px, float py, float angle, float *rx, float *ry) {
-    float cos_a = cos(angle);
-    float sin_a = sin(angle);
+    float cos_a, sin_a;
+    fast_sincosf(angle, &sin_a, &cos_a);
     *rx = px * cos_a - py * sin_a;
     *ry = px * sin_a + py * cos_a;
 }
@@ -14,9 +37,7 @@ void get_robot_corners(Robot *robot, float corners[4][2]) {
     float local[4][2] = {{-1,-0.5}, {1,-0.5}, {1,0.5}, {-1,0.5}};
     
     for(int i = 0; i < 4; i++) {
-        rotate_point(local[i][0], local[i][1], robot->angle, 
-                    &corners[i][0], &corners[i][1]);
-        corners[i][0] += robot->x;
-        corners[i][1] += robot->y;
+        corners[i][0] = local[i][0] * robot->heading_x - local[i][1] * robot->heading_y + robot->x;
+        corners[i][1] = local[i][0] * robot->heading_y + local[i][1] * robot->heading_x + robot->y;
     }
-}
\ No newline at end of file
+}
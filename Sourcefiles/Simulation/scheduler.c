@@ -0,0 +1,364 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "../Include/scheduler.h"
+#include "../Include/trace.h"
+
+#define DEQUE_INITIAL_CAPACITY 64
+
+typedef struct {
+    TaskFunction function;
+    void *arg;
+} Task;
+
+// The tasks of one worker in a ring. The owner pushes and pops at the bottom,
+// so it keeps working on what it split off last, and thieves take the oldest
+// (largest) piece from the top. One lock per deque is cheap next to tasks
+// that run a whole individual
+typedef struct {
+    pthread_mutex_t lock;
+    Task *tasks;
+    size_t top, bottom;               // the tasks are tasks[top..bottom) modulo capacity
+    size_t capacity;
+} TaskDeque;
+
+typedef struct {
+    TaskScheduler *scheduler;
+    int index;
+    uint32_t victim_state;            // picks where to steal, kept apart from the rng streams
+} Worker;
+
+struct TaskScheduler {
+    int worker_count;                 // running workers
+    int deque_count;                  // one per requested worker, fixed once the threads run
+    TaskDeque *deques;
+    Worker *workers;
+    pthread_t *threads;               // workers 1..started, worker 0 is the creating thread
+    int started;
+    Worker *creator_previous;         // the creating thread's worker before this scheduler
+    atomic_int queued;                // tasks in the deques
+    atomic_int pending;               // tasks spawned and not finished
+    atomic_bool stopping;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t changed;           // a task was queued or a wait may be over
+};
+
+static _Thread_local Worker *current_worker;
+
+static void notify_changed(TaskScheduler *scheduler) {
+    pthread_mutex_lock(&scheduler->idle_lock);
+    pthread_cond_broadcast(&scheduler->changed);
+    pthread_mutex_unlock(&scheduler->idle_lock);
+}
+
+// The worker the calling thread is in this scheduler, 0 for other threads
+static Worker *calling_worker(TaskScheduler *scheduler) {
+    if (current_worker && current_worker->scheduler == scheduler) return current_worker;
+    return &scheduler->workers[0];
+}
+
+static bool deque_push(TaskDeque *deque, Task task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity) {
+        size_t capacity = deque->capacity * 2;
+        Task *grown = malloc(capacity * sizeof(Task));
+        if (!grown) {
+            pthread_mutex_unlock(&deque->lock);
+            return false;
+        }
+        size_t count = deque->bottom - deque->top;
+        for (size_t i = 0; i < count; i++) {
+            grown[i] = deque->tasks[(deque->top + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = grown;
+        deque->capacity = capacity;
+        deque->top = 0;
+        deque->bottom = count;
+    }
+    deque->tasks[deque->bottom % deque->capacity] = task;
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+static bool deque_pop(TaskDeque *deque, Task *task) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->bottom > deque->top;
+    if (found) {
+        deque->bottom--;
+        *task = deque->tasks[deque->bottom % deque->capacity];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool deque_steal(TaskDeque *deque, Task *task) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->bottom > deque->top;
+    if (found) {
+        *task = deque->tasks[deque->top % deque->capacity];
+        deque->top++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// The worker's own newest task, or else the oldest one of another worker,
+// starting from a random victim
+static bool take_task(TaskScheduler *scheduler, Worker *worker, Task *task) {
+    if (atomic_load(&scheduler->queued) == 0) return false;
+    bool found = deque_pop(&scheduler->deques[worker->index], task);
+    int others = scheduler->deque_count - 1;
+    if (!found && others > 0) {
+        uint32_t x = worker->victim_state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        worker->victim_state = x;
+        int first = (int)(x % (uint32_t)others);
+        for (int i = 0; i < others && !found; i++) {
+            int victim = (worker->index + 1 + (first + i) % others) % scheduler->deque_count;
+            found = deque_steal(&scheduler->deques[victim], task);
+        }
+    }
+    if (found) atomic_fetch_sub(&scheduler->queued, 1);
+    return found;
+}
+
+static void run_task(TaskScheduler *scheduler, Worker *worker, Task task) {
+    task.function(task.arg, worker->index);
+    if (atomic_fetch_sub(&scheduler->pending, 1) == 1) notify_changed(scheduler);
+}
+
+// Runs queued tasks until *remaining reaches zero, sleeping while there is
+// nothing to take
+static void help_until_done(TaskScheduler *scheduler, atomic_int *remaining) {
+    Worker *worker = calling_worker(scheduler);
+    while (atomic_load(remaining) > 0) {
+        Task task;
+        if (take_task(scheduler, worker, &task)) {
+            run_task(scheduler, worker, task);
+            continue;
+        }
+        pthread_mutex_lock(&scheduler->idle_lock);
+        while (atomic_load(remaining) > 0 && atomic_load(&scheduler->queued) == 0) {
+            pthread_cond_wait(&scheduler->changed, &scheduler->idle_lock);
+        }
+        pthread_mutex_unlock(&scheduler->idle_lock);
+    }
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    TaskScheduler *scheduler = worker->scheduler;
+    current_worker = worker;
+    TRACE_THREAD_NAME("worker %d", worker->index);
+
+    while (true) {
+        Task task;
+        if (take_task(scheduler, worker, &task)) {
+            run_task(scheduler, worker, task);
+            continue;
+        }
+        pthread_mutex_lock(&scheduler->idle_lock);
+        while (atomic_load(&scheduler->queued) == 0 && !atomic_load(&scheduler->stopping)) {
+            pthread_cond_wait(&scheduler->changed, &scheduler->idle_lock);
+        }
+        bool stop = atomic_load(&scheduler->queued) == 0 && atomic_load(&scheduler->stopping);
+        pthread_mutex_unlock(&scheduler->idle_lock);
+        if (stop) break;
+    }
+    return NULL;
+}
+
+static void free_scheduler(TaskScheduler *scheduler) {
+    for (int i = 0; i < scheduler->deque_count; i++) {
+        free(scheduler->deques[i].tasks);
+        pthread_mutex_destroy(&scheduler->deques[i].lock);
+    }
+    free(scheduler->deques);
+    free(scheduler->workers);
+    free(scheduler->threads);
+    free(scheduler);
+}
+
+// worker_count - 1 threads are started, the calling thread is worker 0. When
+// a thread cannot be started the scheduler runs with the workers it has
+TaskScheduler *scheduler_create(int worker_count) {
+    if (worker_count < 1) worker_count = 1;
+    TaskScheduler *scheduler = calloc(1, sizeof(TaskScheduler));
+    if (!scheduler) return NULL;
+    scheduler->deques = calloc(worker_count, sizeof(TaskDeque));
+    scheduler->workers = calloc(worker_count, sizeof(Worker));
+    scheduler->threads = calloc(worker_count, sizeof(pthread_t));
+    if (!scheduler->deques || !scheduler->workers || !scheduler->threads) {
+        free_scheduler(scheduler);
+        return NULL;
+    }
+    for (int i = 0; i < worker_count; i++) {
+        TaskDeque *deque = &scheduler->deques[i];
+        deque->tasks = malloc(DEQUE_INITIAL_CAPACITY * sizeof(Task));
+        if (!deque->tasks) {
+            free_scheduler(scheduler);
+            return NULL;
+        }
+        deque->capacity = DEQUE_INITIAL_CAPACITY;
+        pthread_mutex_init(&deque->lock, NULL);
+        scheduler->deque_count++;
+
+        Worker *worker = &scheduler->workers[i];
+        worker->scheduler = scheduler;
+        worker->index = i;
+        worker->victim_state = 0x9E3779B9u * (uint32_t)(i + 1);
+    }
+    atomic_init(&scheduler->queued, 0);
+    atomic_init(&scheduler->pending, 0);
+    atomic_init(&scheduler->stopping, false);
+    pthread_mutex_init(&scheduler->idle_lock, NULL);
+    pthread_cond_init(&scheduler->changed, NULL);
+
+    scheduler->creator_previous = current_worker;
+    current_worker = &scheduler->workers[0];
+
+    for (int i = 1; i < worker_count; i++) {
+        if (pthread_create(&scheduler->threads[i], NULL, worker_main, &scheduler->workers[i]) != 0) {
+            printf("Warning: Could only start %d of %d scheduler workers\n", i, worker_count);
+            break;
+        }
+        scheduler->started = i;
+    }
+    // the deques of workers that did not start stay empty, nothing is
+    // queued on them
+    scheduler->worker_count = scheduler->started + 1;
+    return scheduler;
+}
+
+// Runs what is still queued, then stops the workers. Call it from the
+// creating thread
+void scheduler_destroy(TaskScheduler *scheduler) {
+    if (!scheduler) return;
+    help_until_done(scheduler, &scheduler->pending);
+    pthread_mutex_lock(&scheduler->idle_lock);
+    atomic_store(&scheduler->stopping, true);
+    pthread_cond_broadcast(&scheduler->changed);
+    pthread_mutex_unlock(&scheduler->idle_lock);
+    for (int i = 1; i <= scheduler->started; i++) {
+        pthread_join(scheduler->threads[i], NULL);
+    }
+    if (current_worker && current_worker->scheduler == scheduler) {
+        current_worker = scheduler->creator_previous;
+    }
+    pthread_mutex_destroy(&scheduler->idle_lock);
+    pthread_cond_destroy(&scheduler->changed);
+    free_scheduler(scheduler);
+}
+
+int scheduler_worker_count(const TaskScheduler *scheduler) {
+    return scheduler ? scheduler->worker_count : 1;
+}
+
+// Queues the task on the calling worker's deque. It runs inline when there is
+// no scheduler, no other worker to take it or no room to queue it
+void scheduler_spawn(TaskScheduler *scheduler, TaskFunction function, void *arg) {
+    if (!scheduler || scheduler->worker_count == 1) {
+        function(arg, 0);
+        return;
+    }
+    Worker *worker = calling_worker(scheduler);
+    atomic_fetch_add(&scheduler->pending, 1);
+    if (!deque_push(&scheduler->deques[worker->index], (Task){function, arg})) {
+        run_task(scheduler, worker, (Task){function, arg});
+        return;
+    }
+    atomic_fetch_add(&scheduler->queued, 1);
+    notify_changed(scheduler);
+}
+
+// Waits for every task spawned so far, running queued ones meanwhile. A task
+// that waits for its own subtasks uses scheduler_parallel_for instead
+void scheduler_wait(TaskScheduler *scheduler) {
+    if (!scheduler) return;
+    help_until_done(scheduler, &scheduler->pending);
+}
+
+// scheduler_parallel_for: the range is halved until a piece holds at most
+// grain indices, the upper halves are queued for thieves while the worker
+// goes on with the lower half. Uneven indices (an individual that collides at
+// once next to one that runs MAX_STEPS) then spread over the workers that
+// have time, and the split costs log(count / grain) queue operations per worker
+typedef struct ParallelFor ParallelFor;
+
+typedef struct {
+    ParallelFor *loop;
+    int begin, end;
+} RangeTask;
+
+struct ParallelFor {
+    TaskScheduler *scheduler;
+    TaskRangeFunction body;
+    void *arg;
+    int grain;
+    RangeTask *ranges;                // one per piece, at most count
+    atomic_int next_range;
+    atomic_int remaining;             // indices not yet run
+};
+
+static void range_task(void *arg, int worker) {
+    RangeTask *range = arg;
+    ParallelFor *loop = range->loop;
+    int begin = range->begin, end = range->end;
+    while (end - begin > loop->grain) {
+        int middle = begin + (end - begin) / 2;
+        RangeTask *upper = &loop->ranges[atomic_fetch_add(&loop->next_range, 1)];
+        upper->loop = loop;
+        upper->begin = middle;
+        upper->end = end;
+        scheduler_spawn(loop->scheduler, range_task, upper);
+        end = middle;
+    }
+    for (int i = begin; i < end; i++) {
+        loop->body(loop->arg, i, worker);
+    }
+    // the loop lives on the caller's stack and is gone once the last piece
+    // is counted
+    TaskScheduler *scheduler = loop->scheduler;
+    if (atomic_fetch_sub(&loop->remaining, end - begin) == end - begin) {
+        notify_changed(scheduler);
+    }
+}
+
+// Runs body(arg, i, worker) for every i in [0, count) and returns when all
+// have run. The calling thread takes part, so it may be called from a task
+void scheduler_parallel_for(TaskScheduler *scheduler, int count, int grain,
+                            TaskRangeFunction body, void *arg) {
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    RangeTask *ranges = NULL;
+    if (scheduler && scheduler->worker_count > 1 && count > grain) {
+        ranges = malloc((size_t)count * sizeof(RangeTask));
+    }
+    if (!ranges) {
+        int worker = scheduler ? calling_worker(scheduler)->index : 0;
+        for (int i = 0; i < count; i++) body(arg, i, worker);
+        return;
+    }
+
+    ParallelFor loop = {
+        .scheduler = scheduler,
+        .body = body,
+        .arg = arg,
+        .grain = grain,
+        .ranges = ranges,
+    };
+    atomic_init(&loop.next_range, 1);
+    atomic_init(&loop.remaining, count);
+    ranges[0] = (RangeTask){.loop = &loop, .begin = 0, .end = count};
+
+    range_task(&ranges[0], calling_worker(scheduler)->index);
+    help_until_done(scheduler, &loop.remaining);
+    free(ranges);
+}
@@ -0,0 +1,331 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "../Include/configuration.h"
+#include "../Include/selection.h"
+#include "../Include/chromosome.h"
+#include "../Include/rng.h"
+
+SelectionConfig selection_config = {
+    .method = SELECTION_METHOD,
+    .elite_count = ELITE_COUNT,
+    .tournament_size = TOURNAMENT_SIZE,
+    .rank_pressure = RANK_PRESSURE,
+    .mutation_rate = MUTATION_RATE,
+};
+
+const char *selection_method_name(SelectionMethod method) {
+    switch (method) {
+        case SELECTION_ELITE:      return "k-elite";
+        case SELECTION_TOURNAMENT: return "tournament";
+        case SELECTION_RANK:       return "rank";
+        case SELECTION_PARETO:     return "NSGA-II";
+    }
+    return "unknown";
+}
+
+Individual *tournament_select(Individual population[], int count, int tournament_size) {
+    Individual *best = &population[rng_int(count)];
+    for (int i = 1; i < tournament_size; i++) {
+        Individual *challenger = &population[rng_int(count)];
+        if (challenger->fitness > best->fitness) best = challenger;
+    }
+    return best;
+}
+
+// A binary tournament won by the better individual with probability
+// pressure / 2 picks individuals with the same probabilities as linear
+// ranking with that pressure, without having to sort for the ranks
+Individual *rank_select(Individual population[], int count, float pressure) {
+    Individual *a = &population[rng_int(count)];
+    Individual *b = &population[rng_int(count)];
+    Individual *better = a->fitness >= b->fitness ? a : b;
+    Individual *worse = better == a ? b : a;
+    return rng_float() < pressure * 0.5f ? better : worse;
+}
+
+static void swap_indices(int *indices, int a, int b) {
+    int tmp = indices[a];
+    indices[a] = indices[b];
+    indices[b] = tmp;
+}
+
+// Quickselect on an index array: afterwards indices[0..k-1] are the k best
+// (in no particular order). Average O(count) against O(count log count) for a sort.
+int select_top_k(const Individual population[], int count, int k, int *indices) {
+    if (k > count) k = count;
+    if (k <= 0) return 0;
+    for (int i = 0; i < count; i++) indices[i] = i;
+
+    int lo = 0, hi = count - 1;
+    while (lo < hi) {
+        // median of three keeps sorted and reversed populations linear
+        int mid = lo + (hi - lo) / 2;
+        if (population[indices[mid]].fitness > population[indices[lo]].fitness) swap_indices(indices, mid, lo);
+        if (population[indices[hi]].fitness > population[indices[lo]].fitness) swap_indices(indices, hi, lo);
+        if (population[indices[hi]].fitness > population[indices[mid]].fitness) swap_indices(indices, hi, mid);
+        float pivot = population[indices[mid]].fitness;
+
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (population[indices[i]].fitness > pivot) i++;
+            while (population[indices[j]].fitness < pivot) j--;
+            if (i <= j) {
+                swap_indices(indices, i, j);
+                i++;
+                j--;
+            }
+        }
+        if (k - 1 <= j) hi = j;
+        else if (k - 1 >= i) lo = i;
+        else break;
+    }
+    return k;
+}
+
+static Individual *select_parent(const SelectionConfig *config, Individual old_pop[], int count,
+                                 const int *elite, int elite_count) {
+    switch (config->method) {
+        case SELECTION_ELITE:
+            if (elite_count > 0) return &old_pop[elite[rng_int(elite_count)]];
+            break;
+        case SELECTION_RANK:
+            return rank_select(old_pop, count, config->rank_pressure);
+        case SELECTION_PARETO:
+            // fitness holds the crowded comparison here, see pareto_fitness in sims.c
+            return tournament_select(old_pop, count, 2);
+        case SELECTION_TOURNAMENT:
+            break;
+    }
+    return tournament_select(old_pop, count, config->tournament_size);
+}
+
+static void init_child(Individual *child, const Chromosome *chromosome, int parent1, int parent2,
+                       int generation, int *id_counter) {
+    child->chromosome = *chromosome;
+    child->parents[0] = parent1;
+    child->parents[1] = parent2;
+    child->active = 1;
+    child->id = (*id_counter)++;
+    child->generation = generation + 1;
+    child->is_best = 0;
+    child->reached_goal = false;
+    child->collision_count = 0;
+    child->fitness = 0;
+    child->steps_taken = 0;
+    child->predicted_fitness = NAN;
+    child->coarse_fitness = NAN;
+}
+
+// Copies the elite_count best to the front of new_pop (the first one marked
+// best) and returns how many there are. indices starts with their indices
+static int copy_elites(const SelectionConfig *config, Individual old_pop[], Individual new_pop[],
+                       int count, int *indices) {
+    int elite_count = config->elite_count < 0 ? 0 : config->elite_count;
+    elite_count = select_top_k(old_pop, count, elite_count, indices);
+
+    int best = elite_count > 0 ? 0 : -1;
+    for (int e = 1; e < elite_count; e++) {
+        if (old_pop[indices[e]].fitness > old_pop[indices[best]].fitness) best = e;
+    }
+    for (int e = 0; e < elite_count; e++) {
+        new_pop[e] = old_pop[indices[e]];
+        new_pop[e].is_best = (e == best);
+        new_pop[e].reached_goal = false;
+        new_pop[e].collision_count = 0;
+        new_pop[e].parents[0] = indices[e];
+        new_pop[e].parents[1] = -1;
+        new_pop[e].predicted_fitness = NAN;
+    }
+    return elite_count;
+}
+
+// Two mutated children of two selected parents, whose indices go to p1 and p2
+static void breed_pair(const SelectionConfig *config, Individual old_pop[], int count,
+                       const int *elite, int elite_count,
+                       Chromosome *c1, Chromosome *c2, int *p1, int *p2) {
+    Individual *parent1 = select_parent(config, old_pop, count, elite, elite_count);
+    Individual *parent2 = select_parent(config, old_pop, count, elite, elite_count);
+    // two elites breed with each other rather than one with itself
+    if (config->method == SELECTION_ELITE && elite_count > 1) {
+        while (parent2 == parent1) {
+            parent2 = select_parent(config, old_pop, count, elite, elite_count);
+        }
+    }
+
+    crossover_chromosomes(&parent1->chromosome, &parent2->chromosome, c1, c2);
+    mutate_chromosome(c1, config->mutation_rate);
+    mutate_chromosome(c2, config->mutation_rate);
+    *p1 = (int)(parent1 - old_pop);
+    *p2 = (int)(parent2 - old_pop);
+}
+
+// The elite_count best are copied unchanged (the first one marked best), the
+// rest of new_pop is filled with mutated children of selected parents
+bool breed_population(const SelectionConfig *config, Individual old_pop[], Individual new_pop[],
+                      int count, int generation, int *id_counter) {
+    int *indices = malloc(count * sizeof(int));
+    if (!indices) return false;
+
+    int elite_count = copy_elites(config, old_pop, new_pop, count, indices);
+    for (int i = elite_count; i < count; i += 2) {
+        Chromosome c1, c2;
+        int p1, p2;
+        breed_pair(config, old_pop, count, indices, elite_count, &c1, &c2, &p1, &p2);
+        init_child(&new_pop[i], &c1, p1, p2, generation, id_counter);
+        if (i + 1 < count) {
+            init_child(&new_pop[i + 1], &c2, p1, p2, generation, id_counter);
+        }
+    }
+    free(indices);
+    return true;
+}
+
+typedef struct {
+    Individual *pool;
+    ChildScore score;
+    void *score_arg;
+} PoolScoring;
+
+static void score_task(void *arg, int index, int worker) {
+    (void)worker;
+    PoolScoring *scoring = arg;
+    Individual *candidate = &scoring->pool[index];
+    candidate->fitness = scoring->score(&candidate->chromosome, scoring->score_arg);
+}
+
+// breed_population with pre-screening: candidates children are bred for
+// every offspring slot and the ones score rates highest fill the slots, with
+// the score kept in predicted_fitness. Only the kept children get an id.
+// The pool is bred on this thread's random stream and scored on the scheduler
+bool breed_population_screened(const SelectionConfig *config, Individual old_pop[], Individual new_pop[],
+                               int count, int generation, int *id_counter,
+                               int candidates, ChildScore score, void *score_arg,
+                               TaskScheduler *scheduler) {
+    int elites = config->elite_count < 0 ? 0 : config->elite_count;
+    int slots = count - (elites < count ? elites : count);
+    int pool_size = slots * candidates;
+    int *indices = malloc(count * sizeof(int));
+    Individual *pool = pool_size > 0 ? malloc(pool_size * sizeof(Individual)) : NULL;
+    int *kept = pool_size > 0 ? malloc(pool_size * sizeof(int)) : NULL;
+    if (candidates <= 1 || !indices || !pool || !kept) {
+        free(indices);
+        free(pool);
+        free(kept);
+        return breed_population(config, old_pop, new_pop, count, generation, id_counter);
+    }
+
+    int elite_count = copy_elites(config, old_pop, new_pop, count, indices);
+    for (int c = 0; c < pool_size; c += 2) {
+        Chromosome c1, c2;
+        int p1, p2;
+        breed_pair(config, old_pop, count, indices, elite_count, &c1, &c2, &p1, &p2);
+        for (int j = 0; j < 2 && c + j < pool_size; j++) {
+            Individual *candidate = &pool[c + j];
+            candidate->chromosome = j == 0 ? c1 : c2;
+            candidate->parents[0] = p1;
+            candidate->parents[1] = p2;
+        }
+    }
+    PoolScoring scoring = {.pool = pool, .score = score, .score_arg = score_arg};
+    scheduler_parallel_for(scheduler, pool_size, 8, score_task, &scoring);
+
+    // select_top_k ranks on fitness, which holds the score here
+    slots = select_top_k(pool, pool_size, slots, kept);
+    for (int s = 0; s < slots; s++) {
+        const Individual *candidate = &pool[kept[s]];
+        Individual *child = &new_pop[elite_count + s];
+        init_child(child, &candidate->chromosome, candidate->parents[0], candidate->parents[1],
+                   generation, id_counter);
+        child->predicted_fitness = candidate->fitness;
+    }
+    free(indices);
+    free(pool);
+    free(kept);
+    return true;
+}
+
+// Steady-state breeding is split so that only the parents' chromosomes are
+// copied while the population is locked: two parents selected the way
+// breed_population selects them, the elite taken from the ranking
+void select_parents(const SelectionConfig *config, Individual population[], int count,
+                    const SteadyRanking *ranking, Chromosome *parent1, Chromosome *parent2) {
+    const Individual *first = select_parent(config, population, count, ranking->elite, ranking->elite_count);
+    const Individual *second = select_parent(config, population, count, ranking->elite, ranking->elite_count);
+    if (config->method == SELECTION_ELITE && ranking->elite_count > 1) {
+        while (second == first) {
+            second = select_parent(config, population, count, ranking->elite, ranking->elite_count);
+        }
+    }
+    *parent1 = first->chromosome;
+    *parent2 = second->chromosome;
+}
+
+// and the child crossed over and mutated from the copies
+void breed_child(const SelectionConfig *config, Chromosome *parent1, Chromosome *parent2,
+                 Chromosome *child) {
+    Chromosome second;
+    crossover_chromosomes(parent1, parent2, child, &second);
+    mutate_chromosome(child, config->mutation_rate);
+}
+
+static void heap_sift_down(int *heap, int size, int at, const Individual population[]) {
+    while (true) {
+        int smallest = at;
+        for (int c = 2 * at + 1; c <= 2 * at + 2 && c < size; c++) {
+            if (population[heap[c]].fitness < population[heap[smallest]].fitness) smallest = c;
+        }
+        if (smallest == at) return;
+        swap_indices(heap, at, smallest);
+        at = smallest;
+    }
+}
+
+static void heap_build(int *heap, int size, const Individual population[]) {
+    for (int at = size / 2 - 1; at >= 0; at--) heap_sift_down(heap, size, at, population);
+}
+
+// The elite is only kept apart under SELECTION_ELITE, the other methods
+// select from the whole population
+void ranking_build(SteadyRanking *ranking, const SelectionConfig *config,
+                   const Individual population[], int count) {
+    int elite_count = config->method == SELECTION_ELITE ? config->elite_count : 0;
+    int indices[POP_SIZE];
+    if (count > POP_SIZE) count = POP_SIZE;
+    if (elite_count > count) elite_count = count;
+    if (elite_count > 0) {
+        select_top_k(population, count, elite_count, indices);
+    } else {
+        elite_count = 0;
+        for (int i = 0; i < count; i++) indices[i] = i;
+    }
+    ranking->elite_count = elite_count;
+    ranking->rest_count = count - elite_count;
+    for (int i = 0; i < elite_count; i++) ranking->elite[i] = indices[i];
+    for (int i = elite_count; i < count; i++) ranking->rest[i - elite_count] = indices[i];
+    heap_build(ranking->elite, ranking->elite_count, population);
+    heap_build(ranking->rest, ranking->rest_count, population);
+}
+
+// The individual a steady-state child replaces, the one with the lowest
+// fitness outside the elite (the weakest elite when there is no one else)
+int ranking_worst(const SteadyRanking *ranking) {
+    return ranking->rest_count > 0 ? ranking->rest[0] : ranking->elite[0];
+}
+
+// Called after the individual ranking_worst named was replaced. A child
+// better than the weakest elite takes its place in the elite
+void ranking_replaced(SteadyRanking *ranking, const Individual population[]) {
+    if (ranking->rest_count == 0) {
+        heap_sift_down(ranking->elite, ranking->elite_count, 0, population);
+        return;
+    }
+    if (ranking->elite_count > 0 &&
+        population[ranking->rest[0]].fitness > population[ranking->elite[0]].fitness) {
+        int child = ranking->rest[0];
+        ranking->rest[0] = ranking->elite[0];
+        ranking->elite[0] = child;
+        heap_sift_down(ranking->elite, ranking->elite_count, 0, population);
+    }
+    heap_sift_down(ranking->rest, ranking->rest_count, 0, population);
+}
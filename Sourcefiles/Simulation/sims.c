@@ -3,165 +3,1025 @@
 #include <stdlib.h>
 #include <time.h>
 #include <ctype.h>
-#include "../include/configuration.h"
-#include "../include/robot.h"
-#include "../include/maze.h"
-#include "../include/chromosome.h"
-#include "../include/rotation.h"
-#include "../include/logger.h"
-#include "../include/types.h"
-#include "../include/debugger.h"
-#include "../include/tracking.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../Include/configuration.h"
+#include "../Include/robot.h"
+#include "../Include/maze.h"
+#include "../Include/chromosome.h"
+#include "../Include/rotation.h"
+#include "../Include/logger.h"
+#include "../Include/types.h"
+#include "../Include/debugger.h"
+#include "../Include/tracking.h"
+#include "../Include/heatmap.h"
+#include "../Include/island.h"
+#include "../Include/rng.h"
+#include "../Include/distributed.h"
+#include "../Include/sims.h"
+#include "../Include/selection.h"
+#include "../Include/instrument.h"
+#include "../Include/trace.h"
+#include "../Include/scheduler.h"
+#include "../Include/surrogate.h"
+#include "../Include/coarse.h"
+#include "../Include/novelty.h"
+#include "../Include/pareto.h"
 
 
+#define MAX_PHASES 10
+
+// One population evolving on its own log. The single run and every island
+// thread each own one of these.
+typedef struct {
+    Simulationcontext *context;
+    Individual *elite;
+    int use_elite;
+    int island;                       // -1 when a single population runs
+    char label[32];                   // prefix for the console output
+    char log_filename[LOG_PATH_MAX];
+    uint64_t seed;
+    MigrantMailbox *inbox;            // NULL when there is no migration
+    MigrantMailbox *outbox;
+    DistCoordinator *coordinator;     // evaluate on remote workers when set
+    SelectionConfig selection;        // copied when the run starts
+    int workers;                      // task scheduler workers, 1 runs everything on this thread
+
+    // results
+    int final_generation;
+    float phase_best_fitness[MAX_PHASES];
+    int total_goals_reached;
+    int first_goal_generation;        // -1 until someone reaches the goal
+    double first_goal_seconds;
+    int migrants_received;
+    float coarse_correlation[MAX_PHASES];   // COARSE_SCREENING: summed per phase, see log_results
+    int coarse_generations[MAX_PHASES];
+} PopulationRun;
+
+// The previous generation as it was simulated, so that its offspring can
+// start from their parents' trajectories (PREFIX_SHARING)
+typedef struct {
+    Individual *population;
+    MovementLog (*movement_logs)[MAX_STEPS];
+    int *movement_counts;
+    int maze_id;                      // maze it ran on, -1 when empty
+} ParentGeneration;
+
 //help functions
 
-static void setup_next_maze_phase(Simulationcontext *context, int target_phase,
+static bool run_population(PopulationRun *run);
+static bool run_steady_state(PopulationRun *run, int worker_count);
+
+static void setup_next_maze_phase(Simulationcontext *context, TaskScheduler *scheduler, int target_phase,
                                   LabyrinthType *training_sequence, const char **phase_names, int num_phases,
                                   int *current_phase, int *generations_in_current_maze);
 
+static void reset_individual(Simulationcontext *context, Individual *individual);
+
 static void initialize_generation(Simulationcontext *context, Individual *population,
-                                   Individual *elite, int use_elite,
-                                   int generation, int *id_counter);
+                                   Individual *elite, int use_elite, const char *label,
+                                   int generation, bool first_generation, bool new_maze, int *id_counter);
 
-static void simulate_generation(Simulationcontext *context, Individual *population,
+static void simulate_generation(Simulationcontext *context, TaskScheduler *scheduler,
+                                 Individual *population,
+                                 const ParentGeneration *parents, int selected,
                                  int *total_goals_reached,
                                  MovementLog movement_logs[POP_SIZE][MAX_STEPS],
-                                 int movement_counts[POP_SIZE]) ;
+                                 int movement_counts[POP_SIZE],
+                                 HeatmapAccumulator *heatmaps) ;
 
-static void log_results(Individual *population,
-                        int generation, JsonLogger *logger,
+static void evaluate_remote(DistCoordinator *coordinator, Simulationcontext *context,
+                            Individual *population, int *total_goals_reached,
+                            MovementLog movement_logs[POP_SIZE][MAX_STEPS],
+                            int movement_counts[POP_SIZE],
+                            HeatmapAccumulator *heatmaps);
+
+static float log_results(Individual *population, const char *label,
+                        int generation, JsonLogger *logger, TaskScheduler *scheduler,
+                        HeatmapAccumulator *heatmaps,
                         float *phase_best_fitness, int current_phase,
                         int total_goals_reached,
                         MovementLog movement_logs[POP_SIZE][MAX_STEPS],
                         int movement_counts[POP_SIZE]);
 
-static void evolve_population(Individual *population, Individual *new_population,
-                               int generation, int *id_counter);
+static bool evolve_population(Simulationcontext *context, TaskScheduler *scheduler,
+                               const SelectionConfig *selection, Individual *population,
+                               Individual *new_population, int generation, int *id_counter,
+                               SurrogateModel *surrogate, bool maze_may_change);
+
+static void score_novelty(NoveltyArchive *archive, Simulationcontext *context, TaskScheduler *scheduler,
+                          Individual *population, MovementLog movement_logs[POP_SIZE][MAX_STEPS],
+                          int movement_counts[POP_SIZE]);
+static void archive_most_novel(NoveltyArchive *archive, const Individual *population,
+                               MovementLog movement_logs[POP_SIZE][MAX_STEPS],
+                               int movement_counts[POP_SIZE]);
+
+static void pareto_fitness(Simulationcontext *context, TaskScheduler *scheduler, Individual *population,
+                           bool with_novelty, const char *label);
+
+static void send_migrants(PopulationRun *run, const Individual *population);
+static void receive_migrants(PopulationRun *run, Individual *population);
+
+static double elapsed_seconds(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+static const char* phase_names[] = {"OPEN (Easy)", "MEDIUM", "COMPLEX", "NARROW (Hard)"};
+#define NUM_TRAINING_PHASES (int)(sizeof(phase_names) / sizeof(phase_names[0]))
+
+static LabyrinthType training_sequence[] = {OPEN, MEDIUM, COMPLEX, NARROW};
+
+// Where a run is in its training phases
+typedef struct {
+    int current;                      // training phase, -1 before the first generation
+    int generations;                  // generations run in it
+} TrainingSchedule;
+
+// The training phase of a generation: the phases in order for
+// PHASES_PER_GENERATION generations each, then random ones
+static int next_training_phase(TrainingSchedule *schedule, int generation, const char *label,
+                               const float *phase_best_fitness) {
+    const int GENERATIONS_PER_PHASE = PHASES_PER_GENERATION;
+    int num_phases = NUM_TRAINING_PHASES;
+
+    int target_training_phase;
+    if (generation < num_phases * GENERATIONS_PER_PHASE) {
+        target_training_phase = generation / GENERATIONS_PER_PHASE;
+    } else {
+
+        if (schedule->current == -1 || schedule->generations >= GENERATIONS_PER_PHASE) {
+            target_training_phase = rng_int(num_phases);
+            schedule->generations = 0;
+            printf("%sSwitching to random phase selection: %s\n", label, phase_names[target_training_phase]);
+        } else {
+            target_training_phase = schedule->current;
+        }
+    }
+
+    // when training phase change show the previous phase information
+    if (schedule->current != target_training_phase) {
+        if (schedule->current != -1) {
+            printf("%sTraining phase %d (%s) completed after %d generations. Best fitness: %.2f\n",
+                   label,
+                   schedule->current,
+                   phase_names[schedule->current],
+                   schedule->generations,
+                   phase_best_fitness[schedule->current]);
+        }
+        schedule->current = target_training_phase;
+        schedule->generations = 0;
+        printf("%sStarting training phase %d (%s) at generation %d\n", label,
+               schedule->current, phase_names[schedule->current], generation);
+    }
+    schedule->generations++;
+    return target_training_phase;
+}
+
+// Whether the generation after this one can start a new training phase, and
+// with it a new maze. The random phases can pick the same one again
+static bool phase_may_end(const TrainingSchedule *schedule, int generation) {
+    if (generation + 1 < NUM_TRAINING_PHASES * PHASES_PER_GENERATION) {
+        return (generation + 1) % PHASES_PER_GENERATION == 0;
+    }
+    return schedule->generations >= PHASES_PER_GENERATION;
+}
+
+// show traning information every 25:th generation
+static void print_training_progress(const TrainingSchedule *schedule, int generation, const char *label,
+                                    const float *phase_best_fitness, int total_goals_reached) {
+    if ((generation + 1) % PHASES_PER_GENERATION == 0) {
+        printf("\n%s=== TRAINING PROGRESS SUMMARY ===\n", label);
+        printf("%sCompleted %d generations in phase %d (%s)\n", label,
+               PHASES_PER_GENERATION, schedule->current, phase_names[schedule->current]);
+        printf("%sPhase best fitness: %.2f\n", label, phase_best_fitness[schedule->current]);
+        printf("%sTotal goals reached so far: %d\n", label, total_goals_reached);
+        printf("%s===================================\n\n", label);
+    }
+}
+
+static void print_final_summary(const PopulationRun *run) {
+    printf("\n=== FINAL TRAINING SUMMARY ===\n");
+    printf("Simulation completed! Final generation: %d\n", run->final_generation);
+    for (int i = 0; i < NUM_TRAINING_PHASES; i++) {
+        printf("Phase %d (%s): Best fitness %.2f\n", i, phase_names[i], run->phase_best_fitness[i]);
+    }
+#if COARSE_SCREENING
+    for (int i = 0; i < NUM_TRAINING_PHASES; i++) {
+        if (run->coarse_generations[i] > 0) {
+            printf("Phase %d (%s): Coarse rank correlation %.3f over %d generations\n", i, phase_names[i],
+                   run->coarse_correlation[i] / run->coarse_generations[i], run->coarse_generations[i]);
+        }
+    }
+#endif
+    printf("Total goals reached: %d\n", run->total_goals_reached);
+    if (run->first_goal_generation >= 0) {
+        printf("First goal reached in generation %d after %.2f s\n",
+               run->first_goal_generation, run->first_goal_seconds);
+    }
+    printf("==============================\n");
+}
 
 void simulate_population_batch(Simulationcontext *context, Individual *elite, int use_elite) {
+    PopulationRun run = {
+        .context = context,
+        .elite = elite,
+        .use_elite = use_elite,
+        .island = -1,
+        .seed = (uint64_t)time(NULL),
+    };
+    snprintf(run.log_filename, sizeof(run.log_filename), "robot_log.json");
+    run.workers = SIMULATION_WORKERS > 0 ? SIMULATION_WORKERS : core_count();
+
+    init_maze_id_counter("maze_log.txt");
+    if (!run_population(&run)) return;
+    print_final_summary(&run);
+}
+
+// Same run as simulate_population_batch, with the individuals evaluated by
+// robotworker processes connected to DISTRIBUTED_ADDRESS
+void simulate_distributed(Simulationcontext *context, Individual *elite, int use_elite) {
+    PopulationRun run = {
+        .context = context,
+        .elite = elite,
+        .use_elite = use_elite,
+        .island = -1,
+        .seed = (uint64_t)time(NULL),
+    };
+    snprintf(run.log_filename, sizeof(run.log_filename), "robot_log.json");
+    run.workers = SIMULATION_WORKERS > 0 ? SIMULATION_WORKERS : core_count();
+
+    run.coordinator = coordinator_start(DISTRIBUTED_ADDRESS);
+    if (!run.coordinator) {
+        printf("Warning: Running without workers\n");
+    }
+
+    init_maze_id_counter("maze_log.txt");
+    bool completed = run_population(&run);
+    coordinator_stop(run.coordinator);
+    if (completed) print_final_summary(&run);
+}
+
+// One population bred one individual at a time on STEADY_STATE_WORKERS
+// threads (one per core by default), logged to robot_log.json in
+// pseudo-generations of POP_SIZE individuals
+void simulate_steady_state(Simulationcontext *context, Individual *elite, int use_elite) {
+    PopulationRun run = {
+        .context = context,
+        .elite = elite,
+        .use_elite = use_elite,
+        .island = -1,
+        .seed = (uint64_t)time(NULL),
+    };
+    snprintf(run.log_filename, sizeof(run.log_filename), "robot_log.json");
+
+    int workers = STEADY_STATE_WORKERS > 0 ? STEADY_STATE_WORKERS : core_count();
+    init_maze_id_counter("maze_log.txt");
+    if (!run_steady_state(&run, workers)) return;
+    print_final_summary(&run);
+}
+
+static void *island_main(void *arg) {
+    run_population((PopulationRun *)arg);
+    return NULL;
+}
+
+// Island model: every island evolves its own population on its own thread,
+// RNG stream, mazes and log, and every MIGRATION_INTERVAL generations sends
+// its best individuals to the next island in the ring.
+void simulate_islands(Simulationcontext *context, Individual *elite, int use_elite) {
+    int count = island_count();
+    PopulationRun *runs = calloc(count, sizeof(PopulationRun));
+    Simulationcontext *contexts = calloc(count, sizeof(Simulationcontext));
+    MigrantMailbox *mailboxes = calloc(count, sizeof(MigrantMailbox));
+    pthread_t *threads = calloc(count, sizeof(pthread_t));
+    if (!runs || !contexts || !mailboxes || !threads) {
+        printf("ERROR: Could not allocate %d islands\n", count);
+        free(runs);
+        free(contexts);
+        free(mailboxes);
+        free(threads);
+        return;
+    }
+
+    printf("Running %d islands, migrating %d individuals every %d generations\n",
+           count, MIGRANT_COUNT, MIGRATION_INTERVAL);
+
+    init_maze_id_counter("maze_log.txt");
+    uint64_t seed = (uint64_t)time(NULL);
+    for (int i = 0; i < count; i++) {
+        mailbox_init(&mailboxes[i]);
+        contexts[i] = *context;
+        contexts[i].maze = NULL;
+        contexts[i].solid = NULL;
+        contexts[i].goal_distance = NULL;
+
+        PopulationRun *run = &runs[i];
+        run->context = &contexts[i];
+        run->elite = elite;
+        run->use_elite = use_elite;
+        run->island = i;
+        run->seed = seed + (uint64_t)i;
+        run->workers = 1;             // the islands already fill the cores
+        snprintf(run->label, sizeof(run->label), "[Island %d] ", i);
+        snprintf(run->log_filename, sizeof(run->log_filename), "robot_log.island%02d.json", i);
+        if (count > 1) {
+            run->inbox = &mailboxes[i];
+            run->outbox = &mailboxes[(i + 1) % count];
+        }
+    }
+
+    int started = 0;
+    for (; started < count; started++) {
+        if (pthread_create(&threads[started], NULL, island_main, &runs[started]) != 0) {
+            printf("Warning: Could only start %d of %d islands\n", started, count);
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    printf("\n=== ISLAND SUMMARY ===\n");
+    float best_fitness[MAX_PHASES] = {0};
+    int total_goals = 0, first_island = -1;
+    for (int i = 0; i < started; i++) {
+        PopulationRun *run = &runs[i];
+        float island_best = 0;
+        for (int p = 0; p < NUM_TRAINING_PHASES; p++) {
+            if (run->phase_best_fitness[p] > best_fitness[p]) best_fitness[p] = run->phase_best_fitness[p];
+            if (run->phase_best_fitness[p] > island_best) island_best = run->phase_best_fitness[p];
+        }
+        total_goals += run->total_goals_reached;
+        printf("Island %d: Best %.2f, Goals %d, Migrants received %d", i, island_best,
+               run->total_goals_reached, run->migrants_received);
+        if (run->first_goal_generation >= 0) {
+            printf(", First goal generation %d (%.2f s)", run->first_goal_generation,
+                   run->first_goal_seconds);
+            if (first_island < 0 || run->first_goal_seconds < runs[first_island].first_goal_seconds) {
+                first_island = i;
+            }
+        }
+        printf("\n");
+    }
+    for (int p = 0; p < NUM_TRAINING_PHASES; p++) {
+        printf("Phase %d (%s): Best fitness %.2f\n", p, phase_names[p], best_fitness[p]);
+    }
+    printf("Total goals reached: %d\n", total_goals);
+    if (first_island >= 0) {
+        printf("First goal reached by island %d after %.2f s\n", first_island,
+               runs[first_island].first_goal_seconds);
+    }
+    printf("======================\n");
+
+    free(runs);
+    free(contexts);
+    free(mailboxes);
+    free(threads);
+}
+
+// Steady-state run: worker threads keep breeding, evaluating and inserting
+// one individual at a time, so a robot that walks all MAX_STEPS holds up no
+// one but its own worker. Every POP_SIZE individuals that finish are logged
+// as one pseudo-generation, in the same layout as a generation. A maze change
+// waits for the individuals in flight and evaluates the whole population on
+// the new maze, which is then logged as the pseudo-generation
+typedef struct {
+    Individual *individuals;
+    MovementLog (*movement_logs)[MAX_STEPS];
+    int *movement_counts;
+    int reserved;                     // slots handed out, 0 once the batch is logged
+    int filled;                       // slots written
+} SteadyBatch;
+
+typedef struct {
+    Simulationcontext *context;
+    const SelectionConfig *selection;
+    uint64_t seed;
+    Individual *population;           // fitness on the current maze
+    int *id_counter;
+    SteadyRanking ranking;            // of population, rebuilt on a new maze
+
+    pthread_mutex_t lock;             // guards everything above and below
+    pthread_cond_t changed;           // broadcast whenever the fields below change
+    bool breeding;                    // workers may breed new children
+    bool stopping;
+    int workers_ready;                // workers past their setup
+    int workers_running;              // of those, the ones that got their buffer
+    int in_flight;                    // children bred and not yet inserted
+    int reevaluate_next;              // next population index to evaluate, POP_SIZE when none
+    int reevaluated;
+    SteadyBatch batches[2];           // pseudo-generation g collects in batches[g % 2]
+    int filling;                      // pseudo-generation finished children go to
+} SteadyState;
+
+typedef struct {
+    SteadyState *state;
+    int index;
+} SteadyWorker;
+
+// Puts a finished child in place of the worst individual and in the
+// pseudo-generation being collected, waiting when both batches are full.
+// Called with the lock held. While breeding is stopped for a maze change the
+// child is not logged, the population is logged again on the new maze
+static void steady_insert(SteadyState *state, Individual *child,
+                          const MovementLog *movement_log, int movement_count) {
+    state->population[ranking_worst(&state->ranking)] = *child;
+    ranking_replaced(&state->ranking, state->population);
+
+    while (state->breeding && !state->stopping) {
+        SteadyBatch *batch = &state->batches[state->filling % 2];
+        if (batch->reserved < POP_SIZE) {
+            int slot = batch->reserved++;
+            child->generation = state->filling;
+            pthread_mutex_unlock(&state->lock);
+
+            batch->individuals[slot] = *child;
+            memcpy(batch->movement_logs[slot], movement_log, movement_count * sizeof(MovementLog));
+            batch->movement_counts[slot] = movement_count;
+
+            pthread_mutex_lock(&state->lock);
+            batch->filled++;
+            return;
+        }
+        if (state->batches[(state->filling + 1) % 2].reserved == 0) {
+            state->filling++;
+        } else {
+            pthread_cond_wait(&state->changed, &state->lock);
+        }
+    }
+}
+
+static void *steady_worker_main(void *arg) {
+    SteadyWorker *worker = arg;
+    SteadyState *state = worker->state;
+    rng_seed(state->seed + 1 + (uint64_t)worker->index);
+    instrument_reset();
+    TRACE_THREAD_NAME("steady worker %d", worker->index);
+
+    MovementLog *movement_log = malloc(MAX_STEPS * sizeof(MovementLog));
+    if (!movement_log) {
+        printf("Warning: Steady-state worker %d could not allocate its movement log\n", worker->index);
+    }
+
+    pthread_mutex_lock(&state->lock);
+    state->workers_ready++;
+    if (movement_log) state->workers_running++;
+    pthread_cond_broadcast(&state->changed);
+    while (movement_log && !state->stopping) {
+        if (state->reevaluate_next < POP_SIZE) {
+            // the slots of the re-evaluated pseudo-generation follow the population
+            int i = state->reevaluate_next++;
+            SteadyBatch *batch = &state->batches[state->filling % 2];
+            Individual individual = state->population[i];
+            pthread_mutex_unlock(&state->lock);
+
+            evaluate_individual(state->context, &individual, MAX_STEPS, batch->movement_logs[i],
+                                &batch->movement_counts[i]);
+            batch->individuals[i] = individual;
+
+            pthread_mutex_lock(&state->lock);
+            state->population[i] = individual;
+            state->reevaluated++;
+            pthread_cond_broadcast(&state->changed);
+        } else if (state->breeding) {
+            Individual child = {0};
+            Chromosome parent1, parent2;
+            select_parents(state->selection, state->population, POP_SIZE, &state->ranking,
+                           &parent1, &parent2);
+            child.id = (*state->id_counter)++;
+            child.generation = state->filling;
+            child.parents[0] = child.parents[1] = -1;
+            child.predicted_fitness = NAN;
+            child.coarse_fitness = NAN;
+            state->in_flight++;
+            pthread_mutex_unlock(&state->lock);
+
+            int movement_count = 0;
+            breed_child(state->selection, &parent1, &parent2, &child.chromosome);
+            reset_individual(state->context, &child);
+            evaluate_individual(state->context, &child, MAX_STEPS, movement_log, &movement_count);
+
+            pthread_mutex_lock(&state->lock);
+            steady_insert(state, &child, movement_log, movement_count);
+            state->in_flight--;
+            pthread_cond_broadcast(&state->changed);
+        } else {
+            pthread_cond_wait(&state->changed, &state->lock);
+        }
+    }
+    pthread_mutex_unlock(&state->lock);
+    free(movement_log);
+    return NULL;
+}
+
+// Stops breeding and waits for the children in flight. What the batches
+// collected so far ran on the old maze and is dropped
+static void steady_pause(SteadyState *state) {
+    pthread_mutex_lock(&state->lock);
+    state->breeding = false;
+    pthread_cond_broadcast(&state->changed);
+    while (state->in_flight > 0) {
+        pthread_cond_wait(&state->changed, &state->lock);
+    }
+    for (int b = 0; b < 2; b++) {
+        state->batches[b].reserved = 0;
+        state->batches[b].filled = 0;
+    }
+    pthread_mutex_unlock(&state->lock);
+}
+
+// Has the workers evaluate the whole population as pseudo-generation
+// generation, then lets them breed again
+static void steady_reevaluate(SteadyState *state, int generation) {
+    SteadyBatch *batch = &state->batches[generation % 2];
+    pthread_mutex_lock(&state->lock);
+    state->filling = generation;
+    state->reevaluate_next = 0;
+    state->reevaluated = 0;
+    pthread_cond_broadcast(&state->changed);
+    while (state->reevaluated < POP_SIZE) {
+        pthread_cond_wait(&state->changed, &state->lock);
+    }
+    batch->reserved = batch->filled = POP_SIZE;
+    ranking_build(&state->ranking, state->selection, state->population, POP_SIZE);
+    state->filling = generation + 1;
+    state->breeding = true;
+    pthread_cond_broadcast(&state->changed);
+    pthread_mutex_unlock(&state->lock);
+}
+
+static SteadyBatch *steady_wait_batch(SteadyState *state, int generation) {
+    SteadyBatch *batch = &state->batches[generation % 2];
+    pthread_mutex_lock(&state->lock);
+    while (batch->filled < POP_SIZE) {
+        pthread_cond_wait(&state->changed, &state->lock);
+    }
+    pthread_mutex_unlock(&state->lock);
+    return batch;
+}
+
+static void steady_release_batch(SteadyState *state, SteadyBatch *batch) {
+    pthread_mutex_lock(&state->lock);
+    batch->reserved = batch->filled = 0;
+    pthread_cond_broadcast(&state->changed);
+    pthread_mutex_unlock(&state->lock);
+}
+
+static bool run_steady_state(PopulationRun *run, int worker_count) {
+    Simulationcontext *context = run->context;
+    const char *label = run->label;
+    int id_counter = 0;
+    int start_generation = 0;
+    int generations = NUM_GENERATIONS;
+
+    run->first_goal_generation = -1;
+    run->selection = selection_config;
+    rng_seed(run->seed);
+    instrument_reset();
+    TRACE_THREAD_NAME("main");
+
+    SteadyState state = {
+        .context = context,
+        .selection = &run->selection,
+        .seed = run->seed,
+        .id_counter = &id_counter,
+        .reevaluate_next = POP_SIZE,
+    };
+    // The population and then the two batches
+    Individual *individual_buffer = malloc(3 * POP_SIZE * sizeof(Individual));
+    MovementLog (*movement_buffer)[MAX_STEPS] = malloc(2 * POP_SIZE * sizeof(*movement_buffer));
+    int *count_buffer = malloc(2 * POP_SIZE * sizeof(int));
+    SteadyWorker *workers = malloc(worker_count * sizeof(SteadyWorker));
+    pthread_t *threads = malloc(worker_count * sizeof(pthread_t));
+    if (!individual_buffer || !movement_buffer || !count_buffer || !workers || !threads) {
+        printf("%sERROR: Could not allocate the population\n", label);
+        free(individual_buffer);
+        free(movement_buffer);
+        free(count_buffer);
+        free(workers);
+        free(threads);
+        return false;
+    }
+    state.population = individual_buffer;
+    for (int b = 0; b < 2; b++) {
+        state.batches[b].individuals = individual_buffer + (b + 1) * POP_SIZE;
+        state.batches[b].movement_logs = movement_buffer + b * POP_SIZE;
+        state.batches[b].movement_counts = count_buffer + b * POP_SIZE;
+    }
+
+    JsonLogger *json_logger = init_json_logger(run->log_filename);
+    if (!json_logger) {
+        printf("%sWarning: Could not initialize JSON logger\n", label);
+    }
+    HeatmapAccumulator *heatmaps = heatmap_create(run->log_filename, 1);
+    if (!heatmaps) {
+        printf("%sWarning: Could not initialize heatmap accumulation\n", label);
+    }
+
+    initialize_counters_from_file(run->log_filename, &start_generation, &id_counter);
+    heatmap_resume(heatmaps, start_generation);
+    int remaining_generations = generations - start_generation;
+    if (remaining_generations <= 0) {
+        printf("%sAll generations already completed! (Target: %d, Last: %d)\n", label,
+               generations, start_generation - 1);
+        if (json_logger) {
+            close_json_logger(json_logger);
+        }
+        heatmap_destroy(heatmaps);
+        free(individual_buffer);
+        free(movement_buffer);
+        free(count_buffer);
+        free(workers);
+        free(threads);
+        return false;
+    }
+
+    printf("%sWill run %d more pseudo-generations (from %d to %d) on %d workers\n", label,
+           remaining_generations, start_generation, start_generation + remaining_generations - 1,
+           worker_count);
+    printf("%sSelection: %s, replacing the worst, mutation rate %.2f\n", label,
+           selection_method_name(run->selection.method), run->selection.mutation_rate);
+
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.changed, NULL);
+    int started = 0;
+    for (; started < worker_count; started++) {
+        workers[started] = (SteadyWorker){.state = &state, .index = started};
+        if (pthread_create(&threads[started], NULL, steady_worker_main, &workers[started]) != 0) {
+            printf("%sWarning: Could only start %d of %d workers\n", label, started, worker_count);
+            break;
+        }
+    }
+
+    // with no worker past its setup every wait below would hang
+    pthread_mutex_lock(&state.lock);
+    while (state.workers_ready < started) {
+        pthread_cond_wait(&state.changed, &state.lock);
+    }
+    int running = state.workers_running;
+    pthread_mutex_unlock(&state.lock);
+    if (running == 0) {
+        printf("%sERROR: No steady-state worker could start, stopping the run\n", label);
+    }
+
+    int current_phase = -1;
+    int generations_in_current_maze = 0;
+    float *phase_best_fitness = run->phase_best_fitness;
+    int total_goals_reached = 0;
+    TrainingSchedule schedule = {.current = -1, .generations = 0};
+    bool completed = running > 0;
+
+    struct timespec started_at;
+    clock_gettime(CLOCK_MONOTONIC, &started_at);
+
+    for (int generation = start_generation;
+         completed && generation < start_generation + remaining_generations; generation++) {
+        int target_phase = next_training_phase(&schedule, generation, label, phase_best_fitness);
+
+        if (generation == start_generation || target_phase != current_phase) {
+            TRACE_BEGIN_ARG("maze change", generation);
+            steady_pause(&state);
+            setup_next_maze_phase(context, NULL, target_phase, training_sequence, phase_names,
+                                  NUM_TRAINING_PHASES, &current_phase, &generations_in_current_maze);
+            if (!context->maze) {
+                completed = false;
+                TRACE_END("maze change");
+                break;
+            }
+            initialize_generation(context, state.population, run->elite, run->use_elite, label,
+                                  generation, generation == start_generation, true, &id_counter);
+            steady_reevaluate(&state, generation);
+            TRACE_END("maze change");
+        }
+        generations_in_current_maze++;
+
+        INSTR_TIME_BEGIN(simulate_mark);
+        TRACE_BEGIN_ARG("wait", generation);
+        SteadyBatch *batch = steady_wait_batch(&state, generation);
+        TRACE_END("wait");
+        INSTR_TIME_END(INSTR_SIMULATE, simulate_mark);
+
+        TRACE_BEGIN_ARG("log", generation);
+        if (json_logger) {
+            log_generation_start(json_logger, generation, phase_names[current_phase], context);
+        }
+        heatmap_begin_generation(heatmaps, context, generation, current_phase);
+        for (int i = 0; i < POP_SIZE; i++) {
+            if (batch->individuals[i].reached_goal) total_goals_reached++;
+            if (!heatmaps) continue;
+            for (int m = 0; m < batch->movement_counts[i]; m++) {
+                heatmap_visit(heatmaps, 0, batch->movement_logs[i][m].x, batch->movement_logs[i][m].y);
+            }
+        }
+        if (run->first_goal_generation < 0 && total_goals_reached > 0) {
+            run->first_goal_generation = generation;
+            run->first_goal_seconds = elapsed_seconds(&started_at);
+        }
+        log_results(batch->individuals, label, generation, json_logger, NULL, heatmaps,
+                    phase_best_fitness, current_phase, total_goals_reached,
+                    batch->movement_logs, batch->movement_counts);
+        steady_release_batch(&state, batch);
+        TRACE_END("log");
+
+        print_training_progress(&schedule, generation, label, phase_best_fitness, total_goals_reached);
+    }
+
+    pthread_mutex_lock(&state.lock);
+    state.stopping = true;
+    state.breeding = false;
+    pthread_cond_broadcast(&state.changed);
+    pthread_mutex_unlock(&state.lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_cond_destroy(&state.changed);
+    pthread_mutex_destroy(&state.lock);
+
+    if (json_logger) {
+        close_json_logger(json_logger);
+    }
+    heatmap_destroy(heatmaps);
+    maze_release(context);
+
+    free(individual_buffer);
+    free(movement_buffer);
+    free(count_buffer);
+    free(workers);
+    free(threads);
+
+    run->final_generation = start_generation + remaining_generations - 1;
+    run->total_goals_reached = total_goals_reached;
+    return completed;
+}
+
+static bool run_population(PopulationRun *run) {
+    Simulationcontext *context = run->context;
+    const char *label = run->label;
     int id_counter = 0;
     int start_generation = 0;
     int generations = NUM_GENERATIONS;
-    Individual new_population[POP_SIZE];
-    Individual population[POP_SIZE];
-    MovementLog movement_logs[POP_SIZE][MAX_STEPS];
-    int movement_counts[POP_SIZE];
 
-    srand(time(NULL));
+    run->first_goal_generation = -1;
+    run->selection = selection_config;
+    rng_seed(run->seed);
+    instrument_reset();
+    if (run->island >= 0) {
+        TRACE_THREAD_NAME("island %d", run->island);
+    } else {
+        TRACE_THREAD_NAME(run->coordinator ? "coordinator" : "main");
+    }
+
+    // With PREFIX_SHARING the previous generation and its trajectories are
+    // kept too, in the second half of the movement buffers
+    int log_sets = PREFIX_SHARING ? 2 : 1;
+    Individual *new_population = malloc(POP_SIZE * sizeof(Individual));
+    Individual *population = malloc(POP_SIZE * sizeof(Individual));
+    Individual *previous_population = PREFIX_SHARING ? malloc(POP_SIZE * sizeof(Individual)) : NULL;
+    MovementLog (*movement_buffer)[MAX_STEPS] = malloc(log_sets * POP_SIZE * sizeof(*movement_buffer));
+    int *count_buffer = malloc(log_sets * POP_SIZE * sizeof(int));
+    if (!new_population || !population || (PREFIX_SHARING && !previous_population) ||
+        !movement_buffer || !count_buffer) {
+        printf("%sERROR: Could not allocate the population\n", label);
+        free(new_population);
+        free(population);
+        free(previous_population);
+        free(movement_buffer);
+        free(count_buffer);
+        return false;
+    }
+    MovementLog (*movement_logs)[MAX_STEPS] = movement_buffer;
+    int *movement_counts = count_buffer;
+    ParentGeneration parents = {
+        .population = previous_population,
+        .movement_logs = movement_buffer + (log_sets - 1) * POP_SIZE,
+        .movement_counts = count_buffer + (log_sets - 1) * POP_SIZE,
+        .maze_id = -1,
+    };
+
+    // Open the log first so a log left by an unclean shutdown is repaired
+    // before the counters are read from it
+    JsonLogger *json_logger = init_json_logger(run->log_filename);
+    if (!json_logger) {
+        printf("%sWarning: Could not initialize JSON logger\n", label);
+    }
+
+    // With SURROGATE the offspring are screened by a model of the fitnesses
+    // simulated so far
+    SurrogateModel surrogate_model = {.samples = NULL};
+    SurrogateModel *surrogate = NULL;
+    if (SURROGATE) {
+        if (surrogate_init(&surrogate_model)) {
+            surrogate = &surrogate_model;
+        } else {
+            printf("%sWarning: Could not allocate the surrogate model, every offspring is simulated\n", label);
+        }
+    }
+
+    // With NOVELTY_SEARCH selection also rewards ending up where the archive
+    // of earlier individuals on the maze has not been
+    NoveltyArchive novelty_archive = {.entries = NULL};
+    NoveltyArchive *novelty = NULL;
+    if (NOVELTY_SEARCH) {
+        if (novelty_init(&novelty_archive)) {
+            novelty = &novelty_archive;
+        } else {
+            printf("%sWarning: Could not allocate the novelty archive, selection uses fitness only\n", label);
+        }
+    }
+
+    // Individuals, the maze preparation and the log records run as tasks on
+    // the workers, NULL runs them all here
+    TaskScheduler *scheduler = run->workers > 1 ? scheduler_create(run->workers) : NULL;
+
+    // Visit counts per worker, merged into heatmaps after each generation
+    HeatmapAccumulator *heatmaps = heatmap_create(run->log_filename, scheduler_worker_count(scheduler));
+    if (!heatmaps) {
+        printf("%sWarning: Could not initialize heatmap accumulation\n", label);
+    }
+
     // Init counters from previous session
-    initialize_counters_from_file("robot_log.json", &start_generation, &id_counter);
+    initialize_counters_from_file(run->log_filename, &start_generation, &id_counter);
+    heatmap_resume(heatmaps, start_generation);
     
     // Adjust the number of generations based on where we start
     int remaining_generations = generations - start_generation;
     if (remaining_generations <= 0) {
-        printf("All generations already completed! (Target: %d, Last: %d)\n", 
+        printf("%sAll generations already completed! (Target: %d, Last: %d)\n", label,
                generations, start_generation - 1);
-        return;
+        if (json_logger) {
+            close_json_logger(json_logger);
+        }
+        heatmap_destroy(heatmaps);
+        scheduler_destroy(scheduler);
+        surrogate_free(&surrogate_model);
+        novelty_free(&novelty_archive);
+        free(new_population);
+        free(population);
+        free(previous_population);
+        free(movement_buffer);
+        free(count_buffer);
+        return false;
     }
     
-    printf("Will run %d more generations (from %d to %d)\n", 
+    printf("%sWill run %d more generations (from %d to %d)\n", label,
            remaining_generations, start_generation, start_generation + remaining_generations - 1);
-
-    JsonLogger *json_logger = init_json_logger("robot_log.json");
-    if (!json_logger) {
-        printf("Warning: Could not initialize JSON logger\n");
+    printf("%sSelection: %s, %d elites, mutation rate %.2f\n", label,
+           selection_method_name(run->selection.method), run->selection.elite_count,
+           run->selection.mutation_rate);
+    if (scheduler) {
+        printf("%sSimulating on %d workers\n", label, scheduler_worker_count(scheduler));
     }
 
-    LabyrinthType training_sequence[] = {OPEN, MEDIUM, COMPLEX, NARROW};
-    int num_phases = sizeof(training_sequence) / sizeof(LabyrinthType);
-    const char* phase_names[] = {"OPEN (Easy)", "MEDIUM", "COMPLEX", "NARROW (Hard)"};
+    // With BOUND_ABORT an individual stops once it cannot end among the ones
+    // the next generation is bred from. Only elite selection has such a fixed
+    // set, the migrants sent on are the best ones too. With novelty the elites
+    // are picked on fitness plus novelty, which the fitness bound does not cover
+    int selected = 0;
+    if (BOUND_ABORT && run->selection.method == SELECTION_ELITE && !novelty) {
+        selected = run->selection.elite_count;
+        if (run->outbox && MIGRANT_COUNT > selected) selected = MIGRANT_COUNT;
+    } else if (BOUND_ABORT && novelty) {
+        printf("%sBound abort does not apply with novelty search, every individual runs to the end\n", label);
+    } else if (BOUND_ABORT) {
+        printf("%sBound abort needs elite selection, every individual runs to the end\n", label);
+    }
 
     int current_phase = -1;
     int generations_in_current_maze = 0;
-    float phase_best_fitness[10] = {0};
+    float *phase_best_fitness = run->phase_best_fitness;
     int total_goals_reached = 0;
-    
+    TrainingSchedule schedule = {.current = -1, .generations = 0};
 
-    int current_training_phase = -1;
-    int generations_in_training_phase = 0;
-    const int GENERATIONS_PER_PHASE = PHASES_PER_GENERATION;
+    struct timespec started;
+    clock_gettime(CLOCK_MONOTONIC, &started);
 
     for (int generation = start_generation; generation < start_generation + remaining_generations; generation++) {
-        
-        int target_training_phase;
-        if (generation < num_phases * GENERATIONS_PER_PHASE) {
-            target_training_phase = generation / GENERATIONS_PER_PHASE;
-        } else {
+        int target_phase = next_training_phase(&schedule, generation, label, phase_best_fitness);
 
-            if (current_training_phase == -1 || generations_in_training_phase >= GENERATIONS_PER_PHASE) {
-                target_training_phase = rand() % num_phases;
-                generations_in_training_phase = 0;
-                printf("Switching to random phase selection: %s\n", phase_names[target_training_phase]);
-            } else {
-                target_training_phase = current_training_phase;
-            }
-        }
-        
-        // when training phase change show the previous phase information
-        if (current_training_phase != target_training_phase) {
-            if (current_training_phase != -1) {
-                printf("Training phase %d (%s) completed after %d generations. Best fitness: %.2f\n",
-                       current_training_phase, 
-                       phase_names[current_training_phase], 
-                       generations_in_training_phase,
-                       phase_best_fitness[current_training_phase]);
-            }
-            current_training_phase = target_training_phase;
-            generations_in_training_phase = 0;
-            printf("Starting training phase %d (%s) at generation %d\n", 
-                   current_training_phase, phase_names[current_training_phase], generation);
-        }
-        generations_in_training_phase++;
-        
-        int target_phase = target_training_phase;
-        
-        init_maze_id_counter("maze_log.txt");
-        setup_next_maze_phase(context, target_phase, training_sequence, phase_names, num_phases, &current_phase,
-                              &generations_in_current_maze);
+        setup_next_maze_phase(context, scheduler, target_phase, training_sequence, phase_names, NUM_TRAINING_PHASES,
+                              &current_phase, &generations_in_current_maze);
         if (json_logger) {
         const char* maze_type_name = phase_names[current_phase];
         log_generation_start(json_logger, generation, maze_type_name, context);
         }   
         generations_in_current_maze++;
-        initialize_generation(context, population, elite, use_elite, generation, &id_counter);
+        initialize_generation(context, population, run->elite, run->use_elite, label,
+                              generation, generation == start_generation, generations_in_current_maze == 1,
+                              &id_counter);
+        heatmap_begin_generation(heatmaps, context, generation, current_phase);
 
-        simulate_generation(context, population, &total_goals_reached, movement_logs, movement_counts);
+        INSTR_TIME_BEGIN(simulate_mark);
+        TRACE_BEGIN_ARG("simulate", generation);
+        if (run->coordinator) {
+            evaluate_remote(run->coordinator, context, population, &total_goals_reached,
+                            movement_logs, movement_counts, heatmaps);
+        } else {
+            simulate_generation(context, scheduler, population, PREFIX_SHARING ? &parents : NULL, selected,
+                                &total_goals_reached, movement_logs, movement_counts, heatmaps);
+        }
+        TRACE_END("simulate");
+        INSTR_TIME_END(INSTR_SIMULATE, simulate_mark);
+        if (run->first_goal_generation < 0 && total_goals_reached > 0) {
+            run->first_goal_generation = generation;
+            run->first_goal_seconds = elapsed_seconds(&started);
+        }
 
-        log_results(population, generation, json_logger,
-                    phase_best_fitness, current_phase, total_goals_reached,
-                    movement_logs, movement_counts);
+        if (novelty) {
+            score_novelty(novelty, context, scheduler, population, movement_logs, movement_counts);
+        }
+
+        TRACE_BEGIN_ARG("log", generation);
+        float correlation = log_results(population, label, generation, json_logger, scheduler, heatmaps,
+                                        phase_best_fitness, current_phase, total_goals_reached,
+                                        movement_logs, movement_counts);
+        if (!isnan(correlation)) {
+            run->coarse_correlation[current_phase] += correlation;
+            run->coarse_generations[current_phase]++;
+        }
+        TRACE_END("log");
+
+        // An aborted individual's fitness is only its bound, so it is left out
+        if (surrogate) {
+            for (int i = 0; i < POP_SIZE; i++) {
+                if (population[i].aborted) continue;
+                surrogate_add(surrogate, context->maze_id, &population[i].chromosome,
+                              population[i].fitness);
+            }
+        }
+
+        if (novelty) {
+            archive_most_novel(novelty, population, movement_logs, movement_counts);
+        }
+
+        // Keep this generation for its offspring and record the next one in
+        // the other half. Remote workers do not share prefixes
+        if (PREFIX_SHARING && !run->coordinator) {
+            for (int i = 0; i < POP_SIZE; i++) {
+                parents.population[i] = population[i];
+            }
+            MovementLog (*swap_logs)[MAX_STEPS] = parents.movement_logs;
+            int *swap_counts = parents.movement_counts;
+            parents.movement_logs = movement_logs;
+            parents.movement_counts = movement_counts;
+            parents.maze_id = context->maze_id;
+            movement_logs = swap_logs;
+            movement_counts = swap_counts;
+        }
+
+        if (run->outbox && (generation + 1) % MIGRATION_INTERVAL == 0) {
+            TRACE_BEGIN("send migrants");
+            send_migrants(run, population);
+            TRACE_END("send migrants");
+        }
         
         if (generation < start_generation + remaining_generations - 1) {
-            evolve_population(population, new_population, generation, &id_counter);
+            INSTR_TIME_BEGIN(evolve_mark);
+            TRACE_BEGIN_ARG("evolve", generation);
+            // after the log, the prefix sharing copy and the migrants, which keep the plain fitness
+            if (run->selection.method == SELECTION_PARETO) {
+                pareto_fitness(context, scheduler, population, novelty != NULL, label);
+            } else if (novelty) {
+                for (int i = 0; i < POP_SIZE; i++) {
+                    population[i].fitness += NOVELTY_WEIGHT * population[i].novelty;
+                }
+            }
+            if (!evolve_population(context, scheduler, &run->selection, population, new_population,
+                                   generation, &id_counter, surrogate, phase_may_end(&schedule, generation))) {
+                printf("%sWarning: Could not breed the next generation, the population is kept\n", label);
+            }
+            if (run->inbox) {
+                receive_migrants(run, population);
+            }
+            TRACE_END("evolve");
+            INSTR_TIME_END(INSTR_EVOLVE, evolve_mark);
         }
         
-        // show traning information every 25:th generation
-        if ((generation + 1) % GENERATIONS_PER_PHASE == 0) {
-            printf("\n=== TRAINING PROGRESS SUMMARY ===\n");
-            printf("Completed %d generations in phase %d (%s)\n", 
-                   GENERATIONS_PER_PHASE, current_training_phase, phase_names[current_training_phase]);
-            printf("Phase best fitness: %.2f\n", phase_best_fitness[current_training_phase]);
-            printf("Total goals reached so far: %d\n", total_goals_reached);
-            printf("===================================\n\n");
-        }
+        print_training_progress(&schedule, generation, label, phase_best_fitness, total_goals_reached);
     }
 
     if (json_logger) {
         close_json_logger(json_logger);
     }
+    heatmap_destroy(heatmaps);
+    scheduler_destroy(scheduler);
+    surrogate_free(&surrogate_model);
+    novelty_free(&novelty_archive);
 
-    if (context->maze) {
-        free_matrix(context->maze, context->maze_height);
-    }
-    
-    printf("\n=== FINAL TRAINING SUMMARY ===\n");
-    printf("Simulation completed! Final generation: %d\n", start_generation + remaining_generations - 1);
-    for (int i = 0; i < num_phases; i++) {
-        printf("Phase %d (%s): Best fitness %.2f\n", i, phase_names[i], phase_best_fitness[i]);
-    }
-    printf("Total goals reached: %d\n", total_goals_reached);
-    printf("==============================\n");
+    maze_release(context);
+
+    free(new_population);
+    free(population);
+    free(previous_population);
+    free(movement_buffer);
+    free(count_buffer);
+
+    run->final_generation = start_generation + remaining_generations - 1;
+    run->total_goals_reached = total_goals_reached;
+    return true;
 }
 
 //Help functions 
@@ -184,14 +1044,43 @@ static void log_step(MovementLog *log, const Individual *ind, Action action,
     }
 }
 
-static void update_individual(Simulationcontext *ctx, Individual *ind, int step,
-                               MovementLog *movement_log, int *movement_count,
-                               int *total_goals_reached) {
+// The robot and what it did at one step. The decision depends only on the
+// position and orientation, so two steps from the same pose do the same thing
+typedef struct {
+    float x, y;
+    int orientation;
+    Action action;
     float readings[5];
-    read_sensors(ind, ctx, readings);
+} StepRecord;
+
+// What run_individual keeps about an individual between steps
+typedef struct {
+    signed char dominant[4];                // see front_dominates, -1 until needed
+    StepRecord recent[REPEAT_WINDOW];       // the last steps, at step % REPEAT_WINDOW
+    int recorded;                           // steps recorded so far
+} StepState;
 
-    Action action = decide_action(ind, ctx);
-    log_step(&movement_log[(*movement_count)++], ind, action, readings, step);
+// Everything after the decision: log the step, move, and end the individual
+// on a collision, the goal or the last step
+static void finish_step(Simulationcontext *ctx, Individual *ind, int step, int max_steps,
+                        Action action, const float readings[5], StepState *state,
+                        MovementLog *movement_log, int *movement_count,
+                        int *total_goals_reached, HeatmapAccumulator *heatmaps, int lane) {
+    if (movement_log) {
+        log_step(&movement_log[(*movement_count)++], ind, action, readings, step);
+    }
+    if (heatmaps) {
+        heatmap_visit(heatmaps, lane, ind->robot.x, ind->robot.y);
+    }
+    if (state) {
+        StepRecord *record = &state->recent[step % REPEAT_WINDOW];
+        record->x = ind->robot.x;
+        record->y = ind->robot.y;
+        record->orientation = ind->robot.orientation;
+        record->action = action;
+        for (int s = 0; s < 5; s++) record->readings[s] = readings[s];
+        state->recorded++;
+    }
 
     bool success = execute_action(ind, action, ctx);
     if (reached_goal(&ind->robot, ctx)) {
@@ -200,94 +1089,470 @@ static void update_individual(Simulationcontext *ctx, Individual *ind, int step,
     }
 
     ind->steps_taken++;
+    INSTR_COUNT(INSTR_STEPS, 1);
 
-    if (!success || ind->reached_goal || step >= MAX_STEPS - 1) {
+    if (!success || ind->reached_goal || step >= max_steps - 1) {
+        INSTR_TIME_BEGIN(fitness_mark);
         ind->fitness = calculate_fitness(ind, ind->steps_taken, ctx);
+        INSTR_TIME_END(INSTR_FITNESS, fitness_mark);
         if (ind->fitness <= 0) ind->fitness = 1.0f;
         ind->active = 0;
+        if (ind->reached_goal) {
+            INSTR_COUNT(INSTR_GOALS_REACHED, 1);
+        } else if (step < max_steps - 1) {
+            INSTR_COUNT(INSTR_EARLY_TERMINATIONS, 1);
+        }
+    }
+}
+
+// One step with all five sensors and the decision. Returns the front reading
+static float update_individual(Simulationcontext *ctx, Individual *ind, int step, int max_steps,
+                               StepState *state, MovementLog *movement_log, int *movement_count,
+                               int *total_goals_reached,
+                               HeatmapAccumulator *heatmaps, int lane) {
+    float readings[5];
+    INSTR_STEP_BEGIN(step_mark);
+    read_sensors(ind, ctx, readings);
+    INSTR_STEP_LAP(INSTR_SENSORS, step_mark);
+
+    Action action = decide_action(&ind->chromosome, readings);
+    INSTR_STEP_LAP(INSTR_DECISION, step_mark);
+
+    finish_step(ctx, ind, step, max_steps, action, readings, state, movement_log, movement_count,
+                total_goals_reached, heatmaps, lane);
+    INSTR_STEP_LAP(INSTR_MOVEMENT, step_mark);
+    return readings[0];
+}
+
+#if EVENT_DRIVEN_STEPPING
+// Whether FORWARD dominates (see forward_dominates) for the state of a front
+// reading against the near and middle thresholds, worked out once per state
+static bool front_dominates(StepState *state, const Chromosome *chr, float front) {
+    int index = (front > chr->distance_thresholds[1]) | (front < chr->distance_thresholds[0]) << 1;
+    if (state->dominant[index] < 0) {
+        state->dominant[index] = forward_dominates(chr, front);
+    }
+    return state->dominant[index];
+}
+
+// Takes the steps of a straight FORWARD run without deciding them: while the
+// front reading stays in a state where FORWARD wins whatever the other sensors
+// read, the action is known, and the front readings come from one scan ahead
+// (front_readings_ahead). Each step still moves and checks collision and goal
+// on its own, so the run ends exactly where single steps would. The other four
+// sensors are only read when the trajectory is recorded. Returns the steps taken
+static int advance_straight_run(Simulationcontext *ctx, Individual *ind, int step, int max_steps,
+                                StepState *state, MovementLog *movement_log, int *movement_count,
+                                int *total_goals_reached,
+                                HeatmapAccumulator *heatmaps, int lane) {
+    float front[STRAIGHT_RUN_MAX_STEPS];
+    int planned = max_steps - step < STRAIGHT_RUN_MAX_STEPS ? max_steps - step : STRAIGHT_RUN_MAX_STEPS;
+    planned = front_readings_ahead(ind, ctx, planned, front);
+
+    int taken = 0;
+    while (taken < planned && ind->active &&
+           front_dominates(state, &ind->chromosome, front[taken])) {
+        float readings[5] = {front[taken], 0, 0, 0, 0};
+        if (movement_log) {
+            for (int s = 1; s < 5; s++) readings[s] = simulate_ultrasonic(ind, s, ctx);
+        }
+        finish_step(ctx, ind, step + taken, max_steps, FORWARD, readings, state, movement_log,
+                    movement_count, total_goals_reached, heatmaps, lane);
+        taken++;
+    }
+    INSTR_COUNT(INSTR_STRAIGHT_RUN_STEPS, taken);
+    return taken;
+}
+
+// Steps back to an earlier step with the robot in the same pose, 0 if none
+// of the last REPEAT_WINDOW steps matches
+static int repeat_period(const StepState *state, const Robot *robot, int step) {
+    int window = state->recorded < REPEAT_WINDOW ? state->recorded : REPEAT_WINDOW;
+    for (int period = 1; period <= window; period++) {
+        const StepRecord *record = &state->recent[(step - period) % REPEAT_WINDOW];
+        if (record->x == robot->x && record->y == robot->y &&
+            record->orientation == robot->orientation) {
+            return period;
+        }
+    }
+    return 0;
+}
+
+// Once the pose repeats, the robot is in a loop that it cannot leave, most
+// often turning on the spot. The remaining steps replay the loop's actions and
+// readings without sensing or deciding, still moving the robot step by step
+static void replay_loop(Simulationcontext *ctx, Individual *ind, int step, int max_steps,
+                        int period, StepState *state,
+                        MovementLog *movement_log, int *movement_count,
+                        int *total_goals_reached, HeatmapAccumulator *heatmaps, int lane) {
+    INSTR_COUNT(INSTR_REPLAYED_STEPS, max_steps - step);
+    for (; step < max_steps && ind->active; step++) {
+        StepRecord record = state->recent[(step - period) % REPEAT_WINDOW];
+        finish_step(ctx, ind, step, max_steps, record.action, record.readings, state,
+                    movement_log, movement_count, total_goals_reached, heatmaps, lane);
+    }
+}
+#endif
+
+// Runs one individual from step to the end. With EVENT_DRIVEN_STEPPING a
+// straight run is tried after every step whose front reading let FORWARD
+// dominate, since the next step likely does too, and a repeated pose ends the
+// simulation early. The individual is aborted as soon as its fitness cannot
+// reach cutoff any more, -INFINITY runs it to the end
+static void run_individual(Simulationcontext *ctx, Individual *ind, int step, int max_steps,
+                           float cutoff, MovementLog *movement_log, int *movement_count,
+                           int *total_goals_reached,
+                           HeatmapAccumulator *heatmaps, int lane) {
+    StepState state = {.dominant = {-1, -1, -1, -1}};
+    StepState *tracked = EVENT_DRIVEN_STEPPING ? &state : NULL;
+#if EVENT_DRIVEN_STEPPING
+    bool try_run = false;
+#endif
+    while (step < max_steps && ind->active) {
+        if (cutoff > -INFINITY) {
+            float bound = fitness_upper_bound(ind, max_steps, ctx);
+            if (bound < cutoff) {
+                ind->fitness = bound;
+                ind->aborted = true;
+                ind->active = 0;
+                break;
+            }
+        }
+#if EVENT_DRIVEN_STEPPING
+        int period = repeat_period(&state, &ind->robot, step);
+        if (period > 0) {
+            replay_loop(ctx, ind, step, max_steps, period, &state, movement_log, movement_count,
+                        total_goals_reached, heatmaps, lane);
+            break;
+        }
+        if (try_run) {
+            int taken = advance_straight_run(ctx, ind, step, max_steps, &state, movement_log,
+                                             movement_count, total_goals_reached, heatmaps, lane);
+            step += taken;
+            try_run = taken > 0;
+            if (taken > 0) continue;
+        }
+        float front = update_individual(ctx, ind, step, max_steps, tracked, movement_log,
+                                        movement_count, total_goals_reached, heatmaps, lane);
+        try_run = front_dominates(&state, &ind->chromosome, front);
+#else
+        update_individual(ctx, ind, step, max_steps, tracked, movement_log, movement_count,
+                          total_goals_reached, heatmaps, lane);
+#endif
+        step++;
+    }
+}
+
+#if PREFIX_SHARING
+// Steps at the start of a logged trajectory that chr would take too. The
+// decision depends only on the readings, and the readings only on the pose,
+// so a child walks its parent's path for as long as it decides the parent's
+// readings the same way
+static int shared_prefix(const Chromosome *chr, const MovementLog *log, int count) {
+    int shared = 0;
+    while (shared < count && decide_action(chr, log[shared].sensor_readings) == (Action)log[shared].action) {
+        shared++;
+    }
+    return shared;
+}
+
+// Starts an offspring on the longer of the prefixes it shares with its
+// parents: the parent's steps are copied to the log and the robot is put
+// where the parent stood at the first decision they differ on. A child that
+// agrees with every step ends where the parent ended and takes its result.
+// Returns the step to continue from
+static int share_parent_prefix(Simulationcontext *ctx, Individual *ind,
+                               const ParentGeneration *parents,
+                               MovementLog *movement_log, int *movement_count,
+                               int *total_goals_reached, HeatmapAccumulator *heatmaps, int lane) {
+    if (!parents || parents->maze_id != ctx->maze_id) return 0;
+
+    int parent = -1, shared = 0;
+    for (int p = 0; p < 2; p++) {
+        int index = ind->parents[p];
+        // an aborted parent's log stops before its end
+        if (index < 0 || parents->population[index].aborted) continue;
+        int length = shared_prefix(&ind->chromosome, parents->movement_logs[index],
+                                   parents->movement_counts[index]);
+        if (length > shared) {
+            shared = length;
+            parent = index;
+        }
+    }
+    if (shared == 0) return 0;
+
+    const MovementLog *log = parents->movement_logs[parent];
+    for (int m = 0; m < shared; m++) {
+        if (movement_log) movement_log[(*movement_count)++] = log[m];
+        if (heatmaps) heatmap_visit(heatmaps, lane, log[m].x, log[m].y);
+    }
+    INSTR_COUNT(INSTR_SHARED_STEPS, shared);
+
+    const Individual *source = &parents->population[parent];
+    if (shared == parents->movement_counts[parent]) {
+        ind->robot = source->robot;
+        ind->steps_taken = source->steps_taken;
+        ind->collision_count = source->collision_count;
+        ind->reached_goal = source->reached_goal;
+        ind->fitness = source->fitness;
+        ind->active = 0;
+        if (ind->reached_goal) {
+            (*total_goals_reached)++;
+            INSTR_COUNT(INSTR_GOALS_REACHED, 1);
+        }
+    } else {
+        restore_robot_pose(&ind->robot, log[shared].x, log[shared].y, log[shared].angle);
+        ind->steps_taken = shared;
     }
+    return shared;
 }
+#endif
 
-static void setup_next_maze_phase(Simulationcontext *context, int target_phase,
+static void setup_next_maze_phase(Simulationcontext *context, TaskScheduler *scheduler, int target_phase,
                                   LabyrinthType *training_sequence, const char **phase_names, int num_phases,
                                   int *current_phase, int *generations_in_current_maze) {
     
     // logic for generating new mazes when a new training phase starts
     if (*current_phase != target_phase || context->maze == NULL) {
-        if (context->maze) {
-            free_matrix(context->maze, context->maze_height);
-        }
+        maze_release(context);
         
         *current_phase = target_phase;
         LabyrinthType maze_type = training_sequence[*current_phase % num_phases];
         *generations_in_current_maze = 0;
 
+        INSTR_TIME_BEGIN(maze_mark);
+        TRACE_BEGIN("maze generation");
         context->maze = generate_labyrinthe(maze_type, &context->maze_width, 
                                             &context->maze_height, context);
+        TRACE_END("maze generation");
+        INSTR_TIME_END(INSTR_MAZE, maze_mark);
         if (!context->maze) {
             printf("ERROR: Failed to generate maze for phase %d (%s)\n", 
                    *current_phase, phase_names[*current_phase]);
             return;
         }
+        if (!maze_prepare(context, scheduler)) {
+            printf("Warning: Could not allocate the maze tiles or distance field, falling back to the grid\n");
+        }
     }
 }
 
+// Puts the robot back at the start and clears the results of the last run
+static void reset_individual(Simulationcontext *context, Individual *individual) {
+    initialize_robot(&individual->robot, (float)context->start_x, (float)context->start_y);
+    individual->reached_goal = false;
+    individual->collision_count = 0;
+    individual->active = 1;
+    individual->fitness = 0;
+    individual->steps_taken = 0;
+    individual->is_best = 0;
+    individual->aborted = false;
+    individual->novelty = 0;
+}
+
+// The first generation of a session starts from random chromosomes (and the
+// elite), later ones keep the evolved population and only reset the robots.
+// Randomizing every generation would throw away what evolve_population bred.
+// Coarse fitnesses from the last maze are dropped on a new one
 static void initialize_generation(Simulationcontext *context, Individual *population,
-                                   Individual *elite, int use_elite,
-                                   int generation, int *id_counter) {
+                                   Individual *elite, int use_elite, const char *label,
+                                   int generation, bool first_generation, bool new_maze, int *id_counter) {
     for (int i = 0; i < POP_SIZE; i++) {
-        if (generation == 0 && i == 0 && use_elite && elite != NULL) {
-            population[i] = *elite;
-            initialize_robot(&population[i].robot, (float)context->start_x, (float)context->start_y);
-            printf("Using elite individual as starter\n");
-        } else {
-            initialize_robot(&population[i].robot, (float)context->start_x, (float)context->start_y);
-            initialize_chromosome(&population[i].chromosome);
+        if (first_generation) {
+            if (i == 0 && use_elite && elite != NULL) {
+                population[i] = *elite;
+                printf("%sUsing elite individual as starter\n", label);
+            } else {
+                initialize_chromosome(&population[i].chromosome);
+            }
+        }
+        reset_individual(context, &population[i]);
+
+        // offspring got their id when bred, survivors and migrants get a new one
+        if (first_generation || population[i].generation != generation) {
+            population[i].id = (*id_counter)++;
         }
-        population[i].id = (*id_counter)++;
         population[i].generation = generation;
-        population[i].reached_goal = false;
-        population[i].collision_count = 0;
-        population[i].active = 1;
-        population[i].fitness = 0;
-        population[i].steps_taken = 0;
-        population[i].is_best = 0;
+        if (first_generation) {
+            population[i].parents[0] = population[i].parents[1] = -1;
+            population[i].predicted_fitness = NAN;
+        }
+        if (first_generation || new_maze) {
+            population[i].coarse_fitness = NAN;
+        }
     }
 }
 
-static void simulate_generation(Simulationcontext *context, Individual *population,
+// The best fitnesses of the generation so far, kept for BOUND_ABORT. Once
+// needed individuals have finished, the lowest of them is the fitness an
+// individual has to beat to be selected
+typedef struct {
+    float best[POP_SIZE];
+    int count, needed;
+    int lowest;                       // index in best, valid once count == needed
+} FitnessCutoff;
+
+static float cutoff_value(const FitnessCutoff *cutoff) {
+    return cutoff->needed > 0 && cutoff->count == cutoff->needed ? cutoff->best[cutoff->lowest] : -INFINITY;
+}
+
+static void cutoff_add(FitnessCutoff *cutoff, float fitness) {
+    if (cutoff->needed <= 0) return;
+    if (cutoff->count < cutoff->needed) {
+        cutoff->best[cutoff->count++] = fitness;
+    } else if (fitness > cutoff->best[cutoff->lowest]) {
+        cutoff->best[cutoff->lowest] = fitness;
+    } else {
+        return;
+    }
+    if (cutoff->count == cutoff->needed) {
+        cutoff->lowest = 0;
+        for (int i = 1; i < cutoff->count; i++) {
+            if (cutoff->best[i] < cutoff->best[cutoff->lowest]) cutoff->lowest = i;
+        }
+    }
+}
+
+// One generation on the task scheduler, shared by its tasks
+typedef struct {
+    Simulationcontext *context;
+    Individual *population;
+    const ParentGeneration *parents;
+    MovementLog (*movement_logs)[MAX_STEPS];
+    int *movement_counts;
+    HeatmapAccumulator *heatmaps;     // one lane per worker
+    atomic_int goals_reached;
+    FitnessCutoff cutoff;
+    pthread_mutex_t cutoff_lock;
+    InstrumentStats *worker_stats;    // one per worker, see instrument_drain
+} GenerationTasks;
+
+static void simulate_task(void *arg, int i, int worker) {
+    GenerationTasks *tasks = arg;
+    Simulationcontext *context = tasks->context;
+    Individual *individual = &tasks->population[i];
+    int goals_reached = 0, step = 0;
+    tasks->movement_counts[i] = 0;
+    TRACE_BEGIN_ARG("individual", individual->id);
+#if PREFIX_SHARING
+    step = share_parent_prefix(context, individual, tasks->parents, tasks->movement_logs[i],
+                               &tasks->movement_counts[i], &goals_reached, tasks->heatmaps, worker);
+#endif
+    float cutoff = -INFINITY;
+    if (tasks->cutoff.needed > 0) {
+        pthread_mutex_lock(&tasks->cutoff_lock);
+        cutoff = cutoff_value(&tasks->cutoff);
+        pthread_mutex_unlock(&tasks->cutoff_lock);
+    }
+    run_individual(context, individual, step, MAX_STEPS, cutoff, tasks->movement_logs[i],
+                   &tasks->movement_counts[i], &goals_reached, tasks->heatmaps, worker);
+    if (tasks->cutoff.needed > 0 && !individual->aborted) {
+        pthread_mutex_lock(&tasks->cutoff_lock);
+        cutoff_add(&tasks->cutoff, individual->fitness);
+        pthread_mutex_unlock(&tasks->cutoff_lock);
+    }
+    if (goals_reached > 0) atomic_fetch_add(&tasks->goals_reached, goals_reached);
+    if (COARSE_SCREENING && isnan(individual->coarse_fitness)) {
+        individual->coarse_fitness = coarse_evaluate(&individual->chromosome, context, MAX_STEPS);
+    }
+    TRACE_END("individual");
+#if INSTRUMENTATION
+    instrument_drain(&tasks->worker_stats[worker]);
+#endif
+}
+
+// parents is the previous generation, or NULL to simulate every step.
+// selected is how many of the best the next generation is bred from, 0 when
+// any individual can be chosen and none may be aborted
+static void simulate_generation(Simulationcontext *context, TaskScheduler *scheduler,
+                                 Individual *population,
+                                 const ParentGeneration *parents, int selected,
                                  int *total_goals_reached,
                                  MovementLog movement_logs[POP_SIZE][MAX_STEPS],
-                                 int movement_counts[POP_SIZE]) 
+                                 int movement_counts[POP_SIZE],
+                                 HeatmapAccumulator *heatmaps) 
 {
-    // Init movment log
-    for (int i = 0; i < POP_SIZE; i++) {
-        movement_counts[i] = 0;
-    }
+    // The individuals of a generation do not interact, so each is a task of
+    // its own. Their cost ranges from a collision in the first steps to
+    // MAX_STEPS, which the scheduler evens out by stealing. With BOUND_ABORT
+    // the cutoff is whatever the individuals finished so far have set, so
+    // which ones are aborted depends on the order the workers take them in
+    int workers = scheduler_worker_count(scheduler);
+    GenerationTasks tasks = {
+        .context = context,
+        .population = population,
+        .parents = parents,
+        .movement_logs = movement_logs,
+        .movement_counts = movement_counts,
+        .heatmaps = heatmaps,
+        .cutoff = {.count = 0, .needed = selected, .lowest = 0},
+    };
+    atomic_init(&tasks.goals_reached, 0);
+    pthread_mutex_init(&tasks.cutoff_lock, NULL);
+#if INSTRUMENTATION
+    InstrumentStats worker_stats[workers];
+    memset(worker_stats, 0, sizeof(worker_stats));
+    tasks.worker_stats = worker_stats;
+#endif
 
-    int active_count = POP_SIZE;
-    for (int step = 0; step < MAX_STEPS && active_count > 0; step++) {
-        for (int i = 0; i < POP_SIZE; i++) {
-            if (!population[i].active) continue;
+    scheduler_parallel_for(scheduler, POP_SIZE, 1, simulate_task, &tasks);
 
-            update_individual(context, &population[i], step,
-                              movement_logs[i], &movement_counts[i],
-                              total_goals_reached);
+    *total_goals_reached += atomic_load(&tasks.goals_reached);
+    pthread_mutex_destroy(&tasks.cutoff_lock);
+#if INSTRUMENTATION
+    for (int w = 0; w < workers; w++) instrument_absorb(&worker_stats[w]);
+#else
+    (void)workers;
+#endif
+}
+
+// Runs one individual to the end on its own, as simulate_generation does.
+// movement_log must hold max_steps entries, or be NULL when the trajectory is
+// not needed
+void evaluate_individual(Simulationcontext *context, Individual *individual, int max_steps,
+                         MovementLog *movement_log, int *movement_count) {
+    int goals_reached = 0;
+    *movement_count = 0;
+    TRACE_BEGIN_ARG("individual", individual->id);
+    run_individual(context, individual, 0, max_steps, -INFINITY, movement_log, movement_count,
+                   &goals_reached, NULL, 0);
+    TRACE_END("individual");
+}
+
+static void evaluate_remote(DistCoordinator *coordinator, Simulationcontext *context,
+                            Individual *population, int *total_goals_reached,
+                            MovementLog movement_logs[POP_SIZE][MAX_STEPS],
+                            int movement_counts[POP_SIZE],
+                            HeatmapAccumulator *heatmaps)
+{
+    *total_goals_reached += coordinator_evaluate(coordinator, context, population, POP_SIZE,
+                                                 movement_logs, movement_counts);
+    if (COARSE_SCREENING) {
+        for (int i = 0; i < POP_SIZE; i++) {
+            if (!isnan(population[i].coarse_fitness)) continue;
+            population[i].coarse_fitness = coarse_evaluate(&population[i].chromosome, context, MAX_STEPS);
+        }
+    }
 
-            if (!population[i].active) {
-                active_count--;
+    // the workers send the movements back, so the visits come from those
+    if (heatmaps) {
+        for (int i = 0; i < POP_SIZE; i++) {
+            for (int m = 0; m < movement_counts[i]; m++) {
+                heatmap_visit(heatmaps, 0, movement_logs[i][m].x, movement_logs[i][m].y);
             }
         }
     }
 }
 
-static void log_results(Individual *population,
-                        int generation, JsonLogger *logger,
+static float log_results(Individual *population, const char *label,
+                        int generation, JsonLogger *logger, TaskScheduler *scheduler,
+                        HeatmapAccumulator *heatmaps,
                         float *phase_best_fitness, int current_phase,
                         int total_goals_reached,
                         MovementLog movement_logs[POP_SIZE][MAX_STEPS],
                         int movement_counts[POP_SIZE]) 
 {
+    INSTR_TIME_BEGIN(log_mark);
     int best_index = find_best_index(population);
     float best_fitness = population[best_index].fitness;
     population[best_index].is_best = 1;
@@ -296,35 +1561,238 @@ static void log_results(Individual *population,
         phase_best_fitness[current_phase] = best_fitness;
     }
 
-    if (logger) {
-        for (int i = 0; i < POP_SIZE; i++) {
-            log_individual_complete(logger, &population[i],
-                                    movement_logs[i], movement_counts[i]);
-        }
-    }
+    log_individuals(logger, population, movement_logs, movement_counts, POP_SIZE, scheduler);
 
     int reached = 0;
     float avg_fitness = 0;
+    int aborted = 0, steps_saved = 0;
+    int predicted = 0;
+    float surrogate_error = 0;
+    float avg_novelty = 0;
     for (int i = 0; i < POP_SIZE; i++) {
         if (population[i].reached_goal) reached++;
         avg_fitness += population[i].fitness;
+        avg_novelty += population[i].novelty;
+        if (population[i].aborted) {
+            aborted++;
+            steps_saved += MAX_STEPS - population[i].steps_taken;
+        } else if (!isnan(population[i].predicted_fitness)) {
+            predicted++;
+            surrogate_error += fabsf(population[i].predicted_fitness - population[i].fitness);
+        }
     }
     avg_fitness /= POP_SIZE;
+    avg_novelty /= POP_SIZE;
+    if (predicted > 0) surrogate_error /= predicted;
 
+    // How well the coarse fitness ranks the generation like the full one.
+    // Aborted individuals only have a bound, so they are left out
+    float correlation = NAN;
+    if (COARSE_SCREENING) {
+        float coarse[POP_SIZE], full[POP_SIZE];
+        int compared = 0;
+        for (int i = 0; i < POP_SIZE; i++) {
+            if (population[i].aborted || isnan(population[i].coarse_fitness)) continue;
+            coarse[compared] = population[i].coarse_fitness;
+            full[compared] = population[i].fitness;
+            compared++;
+        }
+        correlation = rank_correlation(coarse, full, compared);
+    }
+
+    INSTR_TIME_END(INSTR_LOGGING, log_mark);
+    INSTR_TIME_BEGIN(end_mark);
     if (logger) {
-        log_generation_end(logger, reached, avg_fitness,
-                           best_fitness, population[best_index].id);
+        GenerationStats stats = {
+            .goals_reached = reached,
+            .avg_fitness = avg_fitness,
+            .best_fitness = best_fitness,
+            .best_individual_id = population[best_index].id,
+            .aborted = aborted,
+            .steps_saved = steps_saved,
+            .predicted = predicted,
+            .surrogate_error = surrogate_error,
+            .coarse_correlation = correlation,
+            .avg_novelty = avg_novelty,
+        };
+        log_generation_end(logger, &stats);
     }
+    heatmap_end_generation(heatmaps, movement_logs[best_index], movement_counts[best_index]);
 
-    printf("Generation %d results: Reached %d/%d (Total: %d), Best: %.2f, Avg: %.2f\n",
-           generation, reached, POP_SIZE, total_goals_reached,
+    printf("%sGeneration %d results: Reached %d/%d (Total: %d), Best: %.2f, Avg: %.2f\n",
+           label, generation, reached, POP_SIZE, total_goals_reached,
            best_fitness, avg_fitness);
+#if BOUND_ABORT
+    printf("%sAborted %d/%d, saving up to %d steps\n", label, aborted, POP_SIZE, steps_saved);
+#endif
+#if SURROGATE
+    if (predicted > 0) {
+        printf("%sSurrogate: %d offspring predicted, mean error %.2f\n", label,
+               predicted, surrogate_error);
+    }
+#endif
+#if NOVELTY_SEARCH
+    printf("%sNovelty: avg %.2f\n", label, avg_novelty);
+#endif
+#if COARSE_SCREENING
+    if (!isnan(correlation)) {
+        printf("%sCoarse: rank correlation %.3f, %d offspring screened\n", label, correlation, predicted);
+    }
+#endif
+    INSTR_TIME_END(INSTR_LOGGING, end_mark);
+
+#if INSTRUMENTATION
+    // The profile covers everything since the previous one: evolve, maze, simulate and log
+    InstrumentReport report;
+    char profile[512];
+    instrument_report(&report);
+    instrument_format(&report, profile, sizeof(profile));
+    printf("%sProfile: %s\n", label, profile);
+    instrument_reset();
+#endif
+    return correlation;
 }
 
-static void evolve_population(Individual *population, Individual *new_population,
-                               int generation, int *id_counter) {
-    elite_selection(population, new_population, generation, id_counter);
+// The coarse screening scores on the current maze, so it is left out when
+// the next generation may run on another one. The children's coarse score is
+// then their coarse fitness, simulate_task does not run them again
+static bool evolve_population(Simulationcontext *context, TaskScheduler *scheduler,
+                               const SelectionConfig *selection, Individual *population,
+                               Individual *new_population, int generation, int *id_counter,
+                               SurrogateModel *surrogate, bool maze_may_change) {
+    bool bred;
+    if (surrogate && surrogate_ready(surrogate)) {
+        bred = breed_population_screened(selection, population, new_population, POP_SIZE, generation,
+                                         id_counter, SURROGATE_CANDIDATES, surrogate_score, surrogate,
+                                         scheduler);
+    } else if (COARSE_SCREENING && !maze_may_change) {
+        bred = breed_population_screened(selection, population, new_population, POP_SIZE, generation,
+                                         id_counter, COARSE_CANDIDATES, coarse_score, context, scheduler);
+        for (int i = 0; bred && i < POP_SIZE; i++) {
+            if (isnan(new_population[i].coarse_fitness)) {
+                new_population[i].coarse_fitness = new_population[i].predicted_fitness;
+            }
+        }
+    } else {
+        bred = breed_population(selection, population, new_population, POP_SIZE, generation, id_counter);
+    }
+    if (!bred) return false;
     for (int i = 0; i < POP_SIZE; i++) {
         population[i] = new_population[i];
     }
-}
\ No newline at end of file
+    return true;
+}
+
+typedef struct {
+    const NoveltyArchive *archive;
+    Individual *population;
+    MovementLog (*movement_logs)[MAX_STEPS];
+    int *movement_counts;
+} NoveltyTasks;
+
+static void novelty_task(void *arg, int i, int worker) {
+    (void)worker;
+    NoveltyTasks *tasks = arg;
+    tasks->population[i].novelty = novelty_score(tasks->archive, &tasks->population[i],
+                                                 tasks->movement_logs[i], tasks->movement_counts[i]);
+}
+
+// Scores the generation against the archive as it was before it, in parallel
+// since the archive is only read
+static void score_novelty(NoveltyArchive *archive, Simulationcontext *context, TaskScheduler *scheduler,
+                          Individual *population, MovementLog movement_logs[POP_SIZE][MAX_STEPS],
+                          int movement_counts[POP_SIZE]) {
+    if (!novelty_begin_maze(archive, context)) return;
+    NoveltyTasks tasks = {
+        .archive = archive,
+        .population = population,
+        .movement_logs = movement_logs,
+        .movement_counts = movement_counts,
+    };
+    scheduler_parallel_for(scheduler, POP_SIZE, 64, novelty_task, &tasks);
+}
+
+// The NOVELTY_ADD most novel individuals join the archive. Aborted ones
+// stopped short of where they would have ended, so they are left out
+static void archive_most_novel(NoveltyArchive *archive, const Individual *population,
+                               MovementLog movement_logs[POP_SIZE][MAX_STEPS],
+                               int movement_counts[POP_SIZE]) {
+    bool added[POP_SIZE];
+    memset(added, 0, sizeof(added));
+    for (int n = 0; n < NOVELTY_ADD; n++) {
+        int best = -1;
+        for (int i = 0; i < POP_SIZE; i++) {
+            if (added[i] || population[i].aborted) continue;
+            if (best < 0 || population[i].novelty > population[best].novelty) best = i;
+        }
+        if (best < 0) break;
+        added[best] = true;
+        novelty_add(archive, &population[best], movement_logs[best], movement_counts[best]);
+    }
+}
+
+// NSGA-II selection. The penalties and the goal bonus calculate_fitness
+// weighs together are kept apart, with novelty as one more objective under
+// NOVELTY_SEARCH, and the fitness selection sees becomes the crowded
+// comparison: a better front first, then a larger crowding distance
+static void pareto_fitness(Simulationcontext *context, TaskScheduler *scheduler, Individual *population,
+                           bool with_novelty, const char *label) {
+    int objective_count = with_novelty ? 5 : 4;
+    float *objectives = malloc((size_t)POP_SIZE * objective_count * sizeof(float));
+    int *fronts = malloc(POP_SIZE * sizeof(int));
+    float *crowding = malloc(POP_SIZE * sizeof(float));
+    int front_count = -1;
+    if (objectives && fronts && crowding) {
+        for (int i = 0; i < POP_SIZE; i++) {
+            FitnessTerms terms;
+            fitness_terms(&population[i], population[i].steps_taken, context, &terms);
+            float *o = objectives + (size_t)i * objective_count;
+            // energy_penalty is left out, it is a fixed multiple of time_penalty
+            o[0] = terms.time_penalty;
+            o[1] = terms.distance_penalty;
+            o[2] = terms.collision_penalty;
+            o[3] = -terms.goal_bonus;
+            if (with_novelty) o[4] = -population[i].novelty;
+        }
+        front_count = pareto_sort(objectives, POP_SIZE, objective_count, fronts, crowding, scheduler);
+    }
+
+    if (front_count < 0) {
+        printf("%sWarning: Could not sort the Pareto fronts, selecting on fitness\n", label);
+    } else {
+        int first_front = 0;
+        for (int i = 0; i < POP_SIZE; i++) {
+            // the crowding part stays below the gap of 1 between fronts
+            float spread = isinf(crowding[i]) ? 0.5f : 0.5f * crowding[i] / (1.0f + crowding[i]);
+            population[i].fitness = (float)(front_count - fronts[i]) + spread;
+            if (fronts[i] == 0) first_front++;
+        }
+        printf("%sPareto: %d fronts, %d individuals in the first\n", label, front_count, first_front);
+    }
+    free(objectives);
+    free(fronts);
+    free(crowding);
+}
+
+static void send_migrants(PopulationRun *run, const Individual *population) {
+    int indices[POP_SIZE];
+    int count = select_top_k(population, POP_SIZE, MIGRANT_COUNT, indices);
+    for (int m = 0; m < count; m++) {
+        mailbox_push(run->outbox, &population[indices[m]]);
+    }
+}
+
+// Migrants replace offspring from the back, the elites at the front stay
+static void receive_migrants(PopulationRun *run, Individual *population) {
+    Individual migrant;
+    int received = 0;
+    while (received < POP_SIZE - run->selection.elite_count && mailbox_pop(run->inbox, &migrant)) {
+        migrant.generation = -1;  // gets a local id in initialize_generation
+        migrant.parents[0] = migrant.parents[1] = -1;
+        migrant.predicted_fitness = NAN;
+        migrant.coarse_fitness = NAN;
+        population[POP_SIZE - 1 - received] = migrant;
+        received++;
+    }
+    run->migrants_received += received;
+}
@@ -0,0 +1,101 @@
+#include <stdlib.h>
+#include <math.h>
+#include "../Include/surrogate.h"
+
+// Typical span of each gene, from the ranges initialize_chromosome draws
+// them in, so that no gene dominates the distance
+static const float gene_span[SURROGATE_GENES] = {
+    1.0f, 1.0f, 1.0f, 1.0f, 1.0f,     // sensor_weights
+    10.0f, 15.0f, 20.0f,              // distance_thresholds
+    1.0f, 1.0f, 1.0f, 1.0f,           // action_priorities
+    1.9f,                             // turn_aggressiveness
+    1.5f,                             // collision_avoidance
+};
+
+static void scale_genes(const Chromosome *chr, float genes[SURROGATE_GENES]) {
+    int g = 0;
+    for (int i = 0; i < 5; i++) genes[g++] = chr->sensor_weights[i];
+    for (int i = 0; i < 3; i++) genes[g++] = chr->distance_thresholds[i];
+    for (int i = 0; i < 4; i++) genes[g++] = chr->action_priorities[i];
+    genes[g++] = chr->turn_aggressiveness;
+    genes[g++] = chr->collision_avoidance;
+    for (g = 0; g < SURROGATE_GENES; g++) genes[g] /= gene_span[g];
+}
+
+bool surrogate_init(SurrogateModel *model) {
+    model->samples = malloc(SURROGATE_ARCHIVE * sizeof(SurrogateSample));
+    model->count = 0;
+    model->next = 0;
+    model->maze_id = -1;
+    return model->samples != NULL;
+}
+
+void surrogate_free(SurrogateModel *model) {
+    free(model->samples);
+    model->samples = NULL;
+    model->count = 0;
+}
+
+// Fitness is only comparable on one maze, so a new maze starts the model over
+void surrogate_add(SurrogateModel *model, int maze_id, const Chromosome *chromosome, float fitness) {
+    if (!model->samples) return;
+    if (maze_id != model->maze_id) {
+        model->count = 0;
+        model->next = 0;
+        model->maze_id = maze_id;
+    }
+    SurrogateSample *sample = &model->samples[model->next];
+    scale_genes(chromosome, sample->genes);
+    sample->fitness = fitness;
+    model->next = (model->next + 1) % SURROGATE_ARCHIVE;
+    if (model->count < SURROGATE_ARCHIVE) model->count++;
+}
+
+bool surrogate_ready(const SurrogateModel *model) {
+    return model->samples && model->count >= SURROGATE_MIN_SAMPLES;
+}
+
+// Inverse-distance weighted mean of the nearest samples. The squared
+// distance to a sample is given up as soon as it passes the farthest of the
+// neighbours found so far, which skips most of the genes of most samples
+float surrogate_predict(const SurrogateModel *model, const Chromosome *chromosome) {
+    if (model->count == 0) return 0.0f;
+    float genes[SURROGATE_GENES];
+    scale_genes(chromosome, genes);
+
+    int k = SURROGATE_NEIGHBOURS < model->count ? SURROGATE_NEIGHBOURS : model->count;
+    float nearest[SURROGATE_NEIGHBOURS];      // squared distances, ascending
+    float fitness[SURROGATE_NEIGHBOURS];
+    int found = 0;
+    for (int s = 0; s < model->count; s++) {
+        const SurrogateSample *sample = &model->samples[s];
+        float limit = found == k ? nearest[k - 1] : INFINITY;
+        float d = 0;
+        for (int g = 0; g < SURROGATE_GENES && d < limit; g++) {
+            float diff = sample->genes[g] - genes[g];
+            d += diff * diff;
+        }
+        if (d >= limit) continue;
+
+        int i = found < k ? found++ : k - 1;
+        while (i > 0 && nearest[i - 1] > d) {
+            nearest[i] = nearest[i - 1];
+            fitness[i] = fitness[i - 1];
+            i--;
+        }
+        nearest[i] = d;
+        fitness[i] = sample->fitness;
+    }
+
+    float weighted = 0, total = 0;
+    for (int i = 0; i < found; i++) {
+        float w = 1.0f / (sqrtf(nearest[i]) + 1e-6f);
+        weighted += w * fitness[i];
+        total += w;
+    }
+    return weighted / total;
+}
+
+float surrogate_score(const Chromosome *chromosome, void *arg) {
+    return surrogate_predict((const SurrogateModel *)arg, chromosome);
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <time.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "../Include/trace.h"
+
+// One ring per thread. Only the owning thread writes events and head, the
+// flush reads head with acquire and then the events below it. When the ring
+// wraps the oldest events are overwritten.
+typedef struct TraceBuffer {
+    struct TraceBuffer *next;
+    int tid;
+    char name[48];
+    atomic_uint_fast64_t head;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+static _Atomic(TraceBuffer *) trace_buffers;
+static atomic_int trace_thread_ids;
+static atomic_flag exit_hook_installed = ATOMIC_FLAG_INIT;
+static char trace_path[256] = TRACE_FILE;
+static _Thread_local TraceBuffer *local_buffer;
+
+static uint64_t trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void trace_at_exit(void) {
+    trace_flush();
+}
+
+// Buffers are never freed: the flush at exit still needs the rings of
+// threads that have finished
+static TraceBuffer *trace_register_thread(void) {
+    TraceBuffer *buffer = calloc(1, sizeof(TraceBuffer));
+    if (!buffer) return NULL;
+    buffer->tid = atomic_fetch_add(&trace_thread_ids, 1) + 1;
+    snprintf(buffer->name, sizeof(buffer->name), "thread %d", buffer->tid);
+    atomic_init(&buffer->head, 0);
+
+    TraceBuffer *first = atomic_load(&trace_buffers);
+    do {
+        buffer->next = first;
+    } while (!atomic_compare_exchange_weak(&trace_buffers, &first, buffer));
+
+    if (!atomic_flag_test_and_set(&exit_hook_installed)) {
+        atexit(trace_at_exit);
+    }
+    local_buffer = buffer;
+    return buffer;
+}
+
+void trace_event(const char *name, char phase, int arg) {
+    TraceBuffer *buffer = local_buffer ? local_buffer : trace_register_thread();
+    if (!buffer) return;
+
+    uint_fast64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    TraceEvent *event = &buffer->events[head % TRACE_BUFFER_EVENTS];
+    event->timestamp_ns = trace_now_ns();
+    event->name = name;
+    event->arg = arg;
+    event->phase = phase;
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+void trace_thread_name(const char *format, ...) {
+    TraceBuffer *buffer = local_buffer ? local_buffer : trace_register_thread();
+    if (!buffer) return;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer->name, sizeof(buffer->name), format, args);
+    va_end(args);
+}
+
+void trace_output(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(trace_path, sizeof(trace_path), format, args);
+    va_end(args);
+}
+
+bool trace_flush(void) {
+    TraceBuffer *buffers = atomic_load(&trace_buffers);
+    if (!buffers) return true;
+
+    FILE *file = fopen(trace_path, "w");
+    if (!file) {
+        printf("Warning: Could not write trace to %s\n", trace_path);
+        return false;
+    }
+
+    int pid = (int)getpid();
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 0, "
+                  "\"args\": {\"name\": \"SelfDrivingRobot %d\"}}", pid, pid);
+
+    for (TraceBuffer *buffer = buffers; buffer; buffer = buffer->next) {
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, "
+                      "\"args\": {\"name\": \"%s\"}}", pid, buffer->tid, buffer->name);
+
+        uint_fast64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        uint_fast64_t first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        int depth = 0;
+        for (uint_fast64_t i = first; i < head; i++) {
+            const TraceEvent *event = &buffer->events[i % TRACE_BUFFER_EVENTS];
+            // after a wrap the first ends can belong to begins that were overwritten
+            if (event->phase == 'E') {
+                if (depth == 0) continue;
+                depth--;
+            } else {
+                depth++;
+            }
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d",
+                    event->name, event->phase, event->timestamp_ns / 1000.0, pid, buffer->tid);
+            if (event->arg >= 0) {
+                fprintf(file, ", \"args\": {\"arg\": %d}", event->arg);
+            }
+            fprintf(file, "}");
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = fclose(file) == 0;
+    if (!ok) printf("Warning: Could not write trace to %s\n", trace_path);
+    return ok;
+}
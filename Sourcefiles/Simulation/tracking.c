@@ -1,10 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "../include/tracking.h"
-#include "../include/types.h"
-#include "../include/configuration.h"
-#include "../include/robot.h"
+#include "../Include/tracking.h"
+#include "../Include/types.h"
+#include "../Include/configuration.h"
+#include "../Include/robot.h"
 
 typedef struct {
     int id;
@@ -0,0 +1,490 @@
+// bench: micro-benchmarks for the simulation hot paths.
+//
+// Every benchmark runs on mazes built from a fixed seed, so two builds can be
+// compared run for run. A benchmark is calibrated until one batch takes at
+// least --min-time, then timed --reps times; the reported ns/op is the mean
+// over the repetitions, with its variance and the fastest repetition.
+//
+//   bench [--format table|csv|json] [--filter NAME] [--reps N] [--min-time MS]
+//
+// Build with -DCMAKE_BUILD_TYPE=Release, numbers from an unoptimized build
+// say little. The maze and run logs are written to a temporary directory.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "../Include/configuration.h"
+#include "../Include/types.h"
+#include "../Include/robot.h"
+#include "../Include/maze.h"
+#include "../Include/chromosome.h"
+#include "../Include/logger.h"
+#include "../Include/rng.h"
+#include "../Include/sims.h"
+#include "../Include/coarse.h"
+#include "../Include/pareto.h"
+
+#define BENCH_SEED      12345
+#define BENCH_POSES     1024
+#define BENCH_MOVEMENTS 200     // movements per logged individual
+#define BENCH_OBJECTIVES 4      // NSGA-II objectives without novelty
+
+typedef enum { FORMAT_TABLE, FORMAT_CSV, FORMAT_JSON } OutputFormat;
+
+typedef struct {
+    OutputFormat format;
+    const char *filter;
+    int reps;
+    double min_time_ns;
+    int printed;
+} BenchOptions;
+
+// Fixture shared by the benchmarks of one maze
+typedef struct {
+    Simulationcontext context;
+    Individual individuals[BENCH_POSES];
+    Action actions[BENCH_POSES];
+    MovementLog movements[BENCH_MOVEMENTS];
+    LabyrinthType type;
+    JsonLogger *logger;
+    long cursor;
+    float *objectives;                // pareto_sort input, BENCH_OBJECTIVES per point
+    int *fronts;
+    float *crowding;
+    int point_count;
+} BenchFixture;
+
+typedef void (*BenchOp)(BenchFixture *fixture, long iterations);
+
+static volatile float sink;
+static FILE *out;   // results, the library's own messages go to stderr
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Operations
+
+static void op_simulate_ultrasonic(BenchFixture *f, long iterations) {
+    float total = 0;
+    for (long i = 0; i < iterations; i++) {
+        long k = f->cursor++;
+        total += simulate_ultrasonic(&f->individuals[k % BENCH_POSES], (int)(k % 5), &f->context);
+    }
+    sink = total;
+}
+
+static void op_check_collision(BenchFixture *f, long iterations) {
+    int hits = 0;
+    for (long i = 0; i < iterations; i++) {
+        Robot *robot = &f->individuals[f->cursor++ % BENCH_POSES].robot;
+        hits += check_collision(robot, robot->x, robot->y, robot->angle, &f->context);
+    }
+    sink = (float)hits;
+}
+
+// The five sensors and the decision, as one simulation step reads them
+static void op_decide_action(BenchFixture *f, long iterations) {
+    int total = 0;
+    for (long i = 0; i < iterations; i++) {
+        Individual *individual = &f->individuals[f->cursor++ % BENCH_POSES];
+        float readings[5];
+        for (int s = 0; s < 5; s++) readings[s] = simulate_ultrasonic(individual, s, &f->context);
+        total += decide_action(&individual->chromosome, readings);
+    }
+    sink = (float)total;
+}
+
+static void op_execute_action(BenchFixture *f, long iterations) {
+    int moved = 0;
+    for (long i = 0; i < iterations; i++) {
+        long k = f->cursor++ % BENCH_POSES;
+        Individual individual = f->individuals[k];
+        moved += execute_action(&individual, f->actions[k], &f->context);
+    }
+    sink = (float)moved;
+}
+
+static void op_calculate_fitness(BenchFixture *f, long iterations) {
+    float total = 0;
+    for (long i = 0; i < iterations; i++) {
+        Individual *individual = &f->individuals[f->cursor++ % BENCH_POSES];
+        total += calculate_fitness(individual, individual->steps_taken, &f->context);
+    }
+    sink = total;
+}
+
+// A whole run from the start, full simulation against the cell grid
+static void op_evaluate_individual(BenchFixture *f, long iterations) {
+    float total = 0;
+    Simulationcontext *c = &f->context;
+    for (long i = 0; i < iterations; i++) {
+        Individual individual = f->individuals[f->cursor++ % BENCH_POSES];
+        initialize_robot(&individual.robot, (float)c->start_x, (float)c->start_y);
+        int moves = 0;
+        evaluate_individual(c, &individual, MAX_STEPS, NULL, &moves);
+        total += individual.fitness;
+    }
+    sink = total;
+}
+
+static void op_coarse_evaluate(BenchFixture *f, long iterations) {
+    float total = 0;
+    for (long i = 0; i < iterations; i++) {
+        const Individual *individual = &f->individuals[f->cursor++ % BENCH_POSES];
+        total += coarse_evaluate(&individual->chromosome, &f->context, MAX_STEPS);
+    }
+    sink = total;
+}
+
+static void op_is_maze_solvable(BenchFixture *f, long iterations) {
+    int solvable = 0;
+    Simulationcontext *c = &f->context;
+    for (long i = 0; i < iterations; i++) {
+        solvable += is_maze_solvable(c->maze, c->maze_width, c->maze_height,
+                                     c->start_x, c->start_y, c->goal_x, c->goal_y);
+    }
+    sink = (float)solvable;
+}
+
+static void op_generate_labyrinthe(BenchFixture *f, long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        Simulationcontext context = f->context;
+        int width = DEFAULT_MAZE_WIDTH, height = DEFAULT_MAZE_HEIGHT;
+        int **maze = generate_labyrinthe(f->type, &width, &height, &context);
+        if (maze) free_matrix(maze, height);
+    }
+}
+
+// runs inside one generation opened by the caller
+static void op_log_individual(BenchFixture *f, long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        log_individual_complete(f->logger, &f->individuals[f->cursor++ % BENCH_POSES],
+                                f->movements, BENCH_MOVEMENTS);
+    }
+}
+
+static void op_log_generation(BenchFixture *f, long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        log_generation_start(f->logger, 1 + (int)f->cursor++, "BENCH", &f->context);
+        log_generation_end(f->logger, &(GenerationStats){0});
+    }
+}
+
+static void op_save_maze_to_log(BenchFixture *f, long iterations) {
+    Simulationcontext *c = &f->context;
+    for (long i = 0; i < iterations; i++) {
+        save_maze_to_log((int)i, c->maze, c->maze_width, c->maze_height, "BENCH", 0, "maze_log.txt");
+    }
+}
+
+// On one thread, like the default of a population that fits one core
+static void op_pareto_sort(BenchFixture *f, long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        sink = (float)pareto_sort(f->objectives, f->point_count, BENCH_OBJECTIVES, f->fronts, f->crowding, NULL);
+    }
+}
+
+// Fixtures
+
+// Same layout as generate_labyrinthe but any size and not required to be
+// solvable, so every size/density combination can be measured
+static void build_maze(BenchFixture *f, int size, int clear_percent) {
+    Simulationcontext *c = &f->context;
+    c->maze_width = size;
+    c->maze_height = size;
+    c->maze = create_matrix(size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            c->maze[y][x] = (x == 0 || y == 0 || x == size - 1 || y == size - 1) ? BORDER : EMPTY;
+        }
+    }
+    carve_random_paths(c->maze, size, size, clear_percent);
+    place_goal_on_edge(c->maze, size, size, c);
+    place_start(c->maze, size, size, c);
+    maze_prepare(c, NULL);
+}
+
+static void build_fixture(BenchFixture *f, int size, int clear_percent) {
+    memset(f, 0, sizeof(*f));
+    f->context.sensors[0] = (Sensor){0, 0, 0, 50};
+    f->context.sensors[1] = (Sensor){0, 0, -M_PI/2, 50};
+    f->context.sensors[2] = (Sensor){0, 0, M_PI/2, 50};
+    f->context.sensors[3] = (Sensor){0, 0, -M_PI/4, 30};
+    f->context.sensors[4] = (Sensor){0, 0, M_PI/4, 30};
+
+    rng_seed(BENCH_SEED + (uint64_t)size * 1000 + clear_percent);
+    build_maze(f, size, clear_percent);
+
+    // Robots on open cells, facing one of the eight directions they can turn to
+    for (int i = 0; i < BENCH_POSES; i++) {
+        int x, y;
+        do {
+            x = 1 + rng_int(size - 2);
+            y = 1 + rng_int(size - 2);
+        } while (f->context.maze[y][x] == WALL);
+
+        Individual *individual = &f->individuals[i];
+        initialize_robot(&individual->robot, (float)x, (float)y);
+        individual->robot.angle = (float)(rng_int(8) * M_PI / 4);
+        update_orientation(&individual->robot);
+        initialize_chromosome(&individual->chromosome);
+        individual->active = 1;
+        individual->id = i;
+        individual->steps_taken = rng_int(MAX_STEPS);
+        individual->collision_count = rng_int(10);
+        f->actions[i] = (Action)rng_int(4);
+    }
+
+    for (int m = 0; m < BENCH_MOVEMENTS; m++) {
+        const Robot *robot = &f->individuals[m].robot;
+        MovementLog *log = &f->movements[m];
+        log->x = robot->x;
+        log->y = robot->y;
+        log->angle = robot->angle;
+        log->step = m;
+        log->action = f->actions[m];
+        for (int s = 0; s < 5; s++) {
+            log->sensor_readings[s] = (float)rng_int(50);
+        }
+    }
+}
+
+static void free_fixture(BenchFixture *f) {
+    maze_release(&f->context);
+}
+
+// Measurement and output
+
+static void print_result(BenchOptions *options, const char *name, const char *params,
+                         long iterations, const double *ns_per_op) {
+    double mean = 0, variance = 0, min = 1e300;
+    for (int r = 0; r < options->reps; r++) {
+        mean += ns_per_op[r];
+        if (ns_per_op[r] < min) min = ns_per_op[r];
+    }
+    mean /= options->reps;
+    for (int r = 0; r < options->reps; r++) {
+        variance += (ns_per_op[r] - mean) * (ns_per_op[r] - mean);
+    }
+    variance = options->reps > 1 ? variance / (options->reps - 1) : 0;
+    double stddev = sqrt(variance);
+    double ops_per_sec = mean > 0 ? 1e9 / mean : 0;
+
+    switch (options->format) {
+        case FORMAT_TABLE:
+            if (options->printed == 0) {
+                fprintf(out, "%-24s %-22s %12s %14s %10s %12s\n",
+                       "benchmark", "params", "ns/op", "ops/sec", "stddev%", "min ns/op");
+            }
+            fprintf(out, "%-24s %-22s %12.1f %14.0f %9.2f%% %12.1f\n", name, params, mean, ops_per_sec,
+                   mean > 0 ? 100.0 * stddev / mean : 0, min);
+            break;
+        case FORMAT_CSV:
+            if (options->printed == 0) {
+                fprintf(out, "benchmark,params,iterations,reps,ns_per_op,ops_per_sec,variance_ns2,stddev_ns,min_ns\n");
+            }
+            fprintf(out, "%s,%s,%ld,%d,%.3f,%.1f,%.6f,%.3f,%.3f\n", name, params, iterations, options->reps,
+                   mean, ops_per_sec, variance, stddev, min);
+            break;
+        case FORMAT_JSON:
+            fprintf(out, "%s\n    {\"benchmark\": \"%s\", \"params\": \"%s\", \"iterations\": %ld, \"reps\": %d, "
+                   "\"ns_per_op\": %.3f, \"ops_per_sec\": %.1f, \"variance_ns2\": %.6f, "
+                   "\"stddev_ns\": %.3f, \"min_ns\": %.3f}",
+                   options->printed ? "," : "", name, params, iterations, options->reps,
+                   mean, ops_per_sec, variance, stddev, min);
+            break;
+    }
+    options->printed++;
+    fflush(out);
+}
+
+static void run_benchmark(BenchOptions *options, const char *name, const char *params,
+                          BenchOp op, BenchFixture *fixture) {
+    if (options->filter && !strstr(name, options->filter)) return;
+
+    // warm up, then double the batch until it takes min_time
+    fixture->cursor = 0;
+    op(fixture, 1);
+    long iterations = 1;
+    while (true) {
+        double start = now_ns();
+        op(fixture, iterations);
+        double elapsed = now_ns() - start;
+        if (elapsed >= options->min_time_ns || iterations >= (1L << 40)) break;
+        iterations *= 2;
+    }
+
+    double *ns_per_op = malloc(options->reps * sizeof(double));
+    if (!ns_per_op) return;
+    for (int r = 0; r < options->reps; r++) {
+        double start = now_ns();
+        op(fixture, iterations);
+        ns_per_op[r] = (now_ns() - start) / (double)iterations;
+    }
+    print_result(options, name, params, iterations, ns_per_op);
+    free(ns_per_op);
+}
+
+static void remove_directory(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir) {
+        struct dirent *entry;
+        char file[1024];
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            remove(file);
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: bench [--format table|csv|json] [--filter NAME] [--reps N] [--min-time MS]\n");
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options = {FORMAT_TABLE, NULL, 10, 20e6, 0};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char *format = argv[++i];
+            if (strcmp(format, "csv") == 0) options.format = FORMAT_CSV;
+            else if (strcmp(format, "json") == 0) options.format = FORMAT_JSON;
+            else options.format = FORMAT_TABLE;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            options.reps = atoi(argv[++i]);
+            if (options.reps < 1) options.reps = 1;
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.min_time_ns = atof(argv[++i]) * 1e6;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    // keep stdout for the results and send everything the simulation prints to stderr
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "Could not set up the output\n");
+        return 1;
+    }
+
+    char workdir[] = "/tmp/robotbench.XXXXXX";
+    char cwd[1024];
+    if (!getcwd(cwd, sizeof(cwd)) || !mkdtemp(workdir) || chdir(workdir) != 0) {
+        fprintf(stderr, "Could not create a working directory for the logs\n");
+        return 1;
+    }
+
+    if (options.format == FORMAT_JSON) {
+#ifdef NDEBUG
+        const char *build = "release";
+#else
+        const char *build = "debug";
+#endif
+        fprintf(out, "{\n  \"seed\": %d,\n  \"build\": \"%s\",\n  \"results\": [", BENCH_SEED, build);
+    }
+
+    BenchFixture *fixture = malloc(sizeof(BenchFixture));
+    if (!fixture) return 1;
+
+    // Per-step operations on several sizes and densities
+    const int sizes[] = {25, 101, 501, 1024, 2048};
+    const int densities[] = {85, 60, 30};   // OPEN, MEDIUM, about COMPLEX/NARROW
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+            char params[64];
+            snprintf(params, sizeof(params), "size=%d clear=%d", sizes[s], densities[d]);
+            build_fixture(fixture, sizes[s], densities[d]);
+            run_benchmark(&options, "simulate_ultrasonic", params, op_simulate_ultrasonic, fixture);
+            run_benchmark(&options, "check_collision", params, op_check_collision, fixture);
+            run_benchmark(&options, "decide_action", params, op_decide_action, fixture);
+            run_benchmark(&options, "execute_action", params, op_execute_action, fixture);
+            run_benchmark(&options, "calculate_fitness", params, op_calculate_fitness, fixture);
+            run_benchmark(&options, "is_maze_solvable", params, op_is_maze_solvable, fixture);
+            run_benchmark(&options, "evaluate_individual", params, op_evaluate_individual, fixture);
+            run_benchmark(&options, "coarse_evaluate", params, op_coarse_evaluate, fixture);
+            free_fixture(fixture);
+        }
+    }
+
+    // Maze generation as the simulation does it, including the maze log
+    const LabyrinthType types[] = {OPEN, MEDIUM, COMPLEX, NARROW};
+    const char *type_names[] = {"OPEN", "MEDIUM", "COMPLEX", "NARROW"};
+    build_fixture(fixture, DEFAULT_MAZE_WIDTH, 60);
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        char params[64];
+        snprintf(params, sizeof(params), "type=%s", type_names[t]);
+        fixture->type = types[t];
+        rng_seed(BENCH_SEED + t);
+        run_benchmark(&options, "generate_labyrinthe", params, op_generate_labyrinthe, fixture);
+    }
+    free_fixture(fixture);
+
+    // Non-dominated sort of populations built like pareto_fitness builds
+    // them: steps, distance, collisions and the goal bonus, so with ties
+    const int point_counts[] = {1000, 5000, 20000};
+    for (size_t p = 0; p < sizeof(point_counts) / sizeof(point_counts[0]); p++) {
+        int count = point_counts[p];
+        fixture->point_count = count;
+        fixture->objectives = malloc((size_t)count * BENCH_OBJECTIVES * sizeof(float));
+        fixture->fronts = malloc(count * sizeof(int));
+        fixture->crowding = malloc(count * sizeof(float));
+        if (fixture->objectives && fixture->fronts && fixture->crowding) {
+            rng_seed(BENCH_SEED + count);
+            for (int i = 0; i < count; i++) {
+                float *o = fixture->objectives + (size_t)i * BENCH_OBJECTIVES;
+                o[0] = (float)rng_int(MAX_STEPS);
+                o[1] = 0.3f * DEFAULT_MAZE_WIDTH * rng_float();
+                o[2] = 2.0f * rng_int(10);
+                o[3] = rng_int(20) == 0 ? -1000.0f : 0.0f;
+            }
+            char params[64];
+            snprintf(params, sizeof(params), "points=%d objectives=%d", count, BENCH_OBJECTIVES);
+            run_benchmark(&options, "pareto_sort", params, op_pareto_sort, fixture);
+        }
+        free(fixture->objectives);
+        free(fixture->fronts);
+        free(fixture->crowding);
+    }
+
+    // Logger writers
+    for (size_t s = 0; s < 2; s++) {
+        char params[64];
+        snprintf(params, sizeof(params), "size=%d moves=%d", sizes[s], BENCH_MOVEMENTS);
+        char log_filename[64];
+        snprintf(log_filename, sizeof(log_filename), "bench_log_%d.json", sizes[s]);
+        build_fixture(fixture, sizes[s], 60);
+        fixture->logger = init_json_logger(log_filename);
+        log_generation_start(fixture->logger, 0, "BENCH", &fixture->context);
+        run_benchmark(&options, "log_individual_complete", params, op_log_individual, fixture);
+        log_generation_end(fixture->logger, &(GenerationStats){0});
+        run_benchmark(&options, "log_generation", params, op_log_generation, fixture);
+        close_json_logger(fixture->logger);
+        run_benchmark(&options, "save_maze_to_log", params, op_save_maze_to_log, fixture);
+        free_fixture(fixture);
+    }
+    free(fixture);
+
+    if (options.format == FORMAT_JSON) {
+        fprintf(out, "\n  ]\n}\n");
+    }
+
+    if (chdir(cwd) == 0) {
+        remove_directory(workdir);
+    }
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,522 @@
+// logquery: fast queries against robot run logs.
+//
+// The log segments are memory mapped and scanned once to build an offset
+// index (robot_log.index.bin); later queries read the index and seek straight
+// to the generation or individual they need. The index is rebuilt whenever a
+// segment has changed size since it was built.
+//
+//   logquery [--log robot_log.json] stats [first [last]]
+//   logquery [--log robot_log.json] top K [generation]
+//   logquery [--log robot_log.json] trajectory ID [generation]
+//   logquery [--log robot_log.json] maze GENERATION
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../Include/manifest.h"
+
+#define INDEX_MAGIC   0x58494c52   // "RLIX"
+#define INDEX_VERSION 2
+
+typedef struct {
+    int index;              // segment number, -1 for a single-file log
+    long long size;         // file size when the index was built
+    char path[LOG_PATH_MAX];
+} SegmentFile;
+
+typedef struct {
+    int generation;
+    int segment;            // position in the segment list
+    long long start, end;   // generation object
+    long long layout;       // first row of the maze layout, 0 if it refers to an earlier one
+    int maze_id;
+    int width, height;
+    int goals_reached;
+    float avg_fitness, best_fitness;
+    int best_individual_id;
+    int individual_count;
+    char maze_type[16];
+} GenerationIndex;
+
+typedef struct {
+    int id;
+    int generation;
+    int segment;
+    float fitness;
+    int steps_taken;
+    int reached_goal;
+    long long start, end;   // individual object
+} IndividualIndex;
+
+typedef struct {
+    int segment_count;
+    SegmentFile *segments;
+    int generation_count, generation_cap;
+    GenerationIndex *generations;
+    int individual_count, individual_cap;
+    IndividualIndex *individuals;
+} LogIndex;
+
+typedef struct {
+    const char *data;
+    size_t len;
+} MappedFile;
+
+static bool map_file(const char *path, MappedFile *map) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    map->data = data;
+    map->len = (size_t)st.st_size;
+    return true;
+}
+
+static void unmap_file(MappedFile *map) {
+    munmap((void *)map->data, map->len);
+}
+
+static long long file_size(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+    return (long long)st.st_size;
+}
+
+static bool starts_with(const char *line, const char *end, const char *prefix) {
+    size_t n = strlen(prefix);
+    return (size_t)(end - line) >= n && memcmp(line, prefix, n) == 0;
+}
+
+// Segments come from the manifest, or the log itself is the only segment
+static bool list_segments(const char *log_filename, LogIndex *index) {
+    LogManifest manifest;
+    if (load_log_manifest(log_filename, &manifest)) {
+        index->segments = calloc(manifest.segment_count, sizeof(SegmentFile));
+        if (!index->segments) {
+            free_log_manifest(&manifest);
+            return false;
+        }
+        for (int i = 0; i < manifest.segment_count; i++) {
+            SegmentFile *seg = &index->segments[i];
+            seg->index = manifest.segments[i].index;
+            log_segment_path(log_filename, seg->index, seg->path, sizeof(seg->path));
+            seg->size = file_size(seg->path);
+        }
+        index->segment_count = manifest.segment_count;
+        free_log_manifest(&manifest);
+        return true;
+    }
+
+    long long size = file_size(log_filename);
+    if (size < 0) return false;
+    index->segments = calloc(1, sizeof(SegmentFile));
+    if (!index->segments) return false;
+    index->segments[0].index = -1;
+    index->segments[0].size = size;
+    snprintf(index->segments[0].path, LOG_PATH_MAX, "%s", log_filename);
+    index->segment_count = 1;
+    return true;
+}
+
+static GenerationIndex *add_generation(LogIndex *index) {
+    if (index->generation_count == index->generation_cap) {
+        int cap = index->generation_cap ? index->generation_cap * 2 : 256;
+        GenerationIndex *grown = realloc(index->generations, cap * sizeof(GenerationIndex));
+        if (!grown) return NULL;
+        index->generations = grown;
+        index->generation_cap = cap;
+    }
+    GenerationIndex *gen = &index->generations[index->generation_count++];
+    memset(gen, 0, sizeof(GenerationIndex));
+    return gen;
+}
+
+static IndividualIndex *add_individual(LogIndex *index) {
+    if (index->individual_count == index->individual_cap) {
+        int cap = index->individual_cap ? index->individual_cap * 2 : 4096;
+        IndividualIndex *grown = realloc(index->individuals, cap * sizeof(IndividualIndex));
+        if (!grown) return NULL;
+        index->individuals = grown;
+        index->individual_cap = cap;
+    }
+    IndividualIndex *ind = &index->individuals[index->individual_count++];
+    memset(ind, 0, sizeof(IndividualIndex));
+    return ind;
+}
+
+// One pass over a segment. The logger writes a fixed layout, so records are
+// recognised by their indentation instead of by a full JSON parse.
+static void scan_segment(LogIndex *index, int segment, const MappedFile *map) {
+    const char *data = map->data;
+    const char *file_end = data + map->len;
+    GenerationIndex *gen = NULL;
+    IndividualIndex *ind = NULL;
+    const char *line = data;
+
+    while (line < file_end) {
+        const char *eol = memchr(line, '\n', (size_t)(file_end - line));
+        if (!eol) eol = file_end;
+        char buf[128];
+        size_t n = (size_t)(eol - line) < sizeof(buf) - 1 ? (size_t)(eol - line) : sizeof(buf) - 1;
+
+        // Movement lines are the bulk of the file and never start a record
+        if (starts_with(line, eol, "            ")) {
+            line = eol + 1;
+            continue;
+        }
+        memcpy(buf, line, n);
+        buf[n] = '\0';
+
+        if (starts_with(line, eol, "      \"generation\": ")) {
+            gen = add_generation(index);
+            if (gen) {
+                // the object starts at the "    {" line before this one
+                const char *open = line - 1;
+                while (open > data && open[-1] != '\n') open--;
+                gen->start = open - data;
+                gen->segment = segment;
+                gen->best_individual_id = -1;
+                gen->maze_id = -1;
+                sscanf(buf, " \"generation\": %d", &gen->generation);
+            }
+        } else if (gen && starts_with(line, eol, "        \"type\": ")) {
+            sscanf(buf, " \"type\": \"%15[^\"]\"", gen->maze_type);
+        } else if (gen && starts_with(line, eol, "        \"width\": ")) {
+            sscanf(buf, " \"width\": %d", &gen->width);
+        } else if (gen && starts_with(line, eol, "        \"height\": ")) {
+            sscanf(buf, " \"height\": %d", &gen->height);
+        } else if (gen && starts_with(line, eol, "        \"maze_id\": ")) {
+            sscanf(buf, " \"maze_id\": %d", &gen->maze_id);
+        } else if (gen && starts_with(line, eol, "        \"layout\": ")) {
+            gen->layout = (eol + 1) - data;
+        } else if (gen && starts_with(line, eol, "          \"id\": ")) {
+            ind = add_individual(index);
+            if (ind) {
+                const char *open = line - 1;
+                while (open > data && open[-1] != '\n') open--;
+                ind->start = open - data;
+                ind->segment = segment;
+                ind->generation = gen->generation;
+                sscanf(buf, " \"id\": %d", &ind->id);
+                gen->individual_count++;
+            }
+        } else if (ind && starts_with(line, eol, "          \"fitness\": ")) {
+            sscanf(buf, " \"fitness\": %f", &ind->fitness);
+        } else if (ind && starts_with(line, eol, "          \"steps_taken\": ")) {
+            sscanf(buf, " \"steps_taken\": %d", &ind->steps_taken);
+        } else if (ind && starts_with(line, eol, "          \"reached_goal\": ")) {
+            ind->reached_goal = strstr(buf, "true") != NULL;
+        } else if (ind && starts_with(line, eol, "        }")) {
+            ind->end = (eol - data);
+            if (ind->end < (long long)map->len) ind->end++;
+            ind = NULL;
+        } else if (gen && starts_with(line, eol, "        \"goals_reached\": ")) {
+            sscanf(buf, " \"goals_reached\": %d", &gen->goals_reached);
+        } else if (gen && starts_with(line, eol, "        \"avg_fitness\": ")) {
+            sscanf(buf, " \"avg_fitness\": %f", &gen->avg_fitness);
+        } else if (gen && starts_with(line, eol, "        \"best_fitness\": ")) {
+            sscanf(buf, " \"best_fitness\": %f", &gen->best_fitness);
+        } else if (gen && starts_with(line, eol, "        \"best_individual_id\": ")) {
+            sscanf(buf, " \"best_individual_id\": %d", &gen->best_individual_id);
+        } else if (gen && starts_with(line, eol, "    }")) {
+            gen->end = (eol - data);
+            gen = NULL;
+        }
+
+        line = eol + 1;
+    }
+
+    // A generation cut off by an unclean shutdown is left out of the index
+    if (gen) {
+        index->generation_count--;
+        while (index->individual_count > 0 &&
+               index->individuals[index->individual_count - 1].segment == segment &&
+               index->individuals[index->individual_count - 1].start > gen->start) {
+            index->individual_count--;
+        }
+    }
+}
+
+static bool write_index(const char *path, const LogIndex *index) {
+    char tmp_path[LOG_PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return false;
+
+    int header[5] = {INDEX_MAGIC, INDEX_VERSION, index->segment_count,
+                     index->generation_count, index->individual_count};
+    bool ok = fwrite(header, sizeof(int), 5, f) == 5 &&
+              fwrite(index->segments, sizeof(SegmentFile), index->segment_count, f) ==
+                  (size_t)index->segment_count &&
+              fwrite(index->generations, sizeof(GenerationIndex), index->generation_count, f) ==
+                  (size_t)index->generation_count &&
+              fwrite(index->individuals, sizeof(IndividualIndex), index->individual_count, f) ==
+                  (size_t)index->individual_count;
+    if (fclose(f) != 0 || !ok) {
+        remove(tmp_path);
+        return false;
+    }
+    return rename(tmp_path, path) == 0;
+}
+
+// Loads the index if it still describes the current segments
+static bool read_index(const char *path, const LogIndex *current, LogIndex *index) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    int header[5];
+    bool ok = fread(header, sizeof(int), 5, f) == 5 && header[0] == INDEX_MAGIC &&
+              header[1] == INDEX_VERSION && header[2] == current->segment_count;
+    if (ok) {
+        index->segment_count = header[2];
+        index->generation_count = index->generation_cap = header[3];
+        index->individual_count = index->individual_cap = header[4];
+        index->segments = calloc(header[2] > 0 ? header[2] : 1, sizeof(SegmentFile));
+        index->generations = calloc(header[3] > 0 ? header[3] : 1, sizeof(GenerationIndex));
+        index->individuals = calloc(header[4] > 0 ? header[4] : 1, sizeof(IndividualIndex));
+        ok = index->segments && index->generations && index->individuals &&
+             fread(index->segments, sizeof(SegmentFile), header[2], f) == (size_t)header[2] &&
+             fread(index->generations, sizeof(GenerationIndex), header[3], f) == (size_t)header[3] &&
+             fread(index->individuals, sizeof(IndividualIndex), header[4], f) == (size_t)header[4];
+    }
+    fclose(f);
+
+    for (int i = 0; ok && i < current->segment_count; i++) {
+        ok = index->segments[i].index == current->segments[i].index &&
+             index->segments[i].size == current->segments[i].size;
+    }
+    if (!ok) {
+        free(index->segments);
+        free(index->generations);
+        free(index->individuals);
+        memset(index, 0, sizeof(LogIndex));
+    }
+    return ok;
+}
+
+static void free_index(LogIndex *index) {
+    free(index->segments);
+    free(index->generations);
+    free(index->individuals);
+    memset(index, 0, sizeof(LogIndex));
+}
+
+static bool open_index(const char *log_filename, LogIndex *index) {
+    LogIndex current = {0};
+    if (!list_segments(log_filename, &current)) {
+        fprintf(stderr, "Could not find log %s\n", log_filename);
+        return false;
+    }
+
+    char index_path[LOG_PATH_MAX];
+    log_derived_path(log_filename, ".index.bin", index_path, sizeof(index_path));
+    if (read_index(index_path, &current, index)) {
+        free_index(&current);
+        return true;
+    }
+
+    fprintf(stderr, "Building index %s...\n", index_path);
+    for (int i = 0; i < current.segment_count; i++) {
+        MappedFile map;
+        if (!map_file(current.segments[i].path, &map)) continue;
+        scan_segment(&current, i, &map);
+        unmap_file(&map);
+    }
+    if (!write_index(index_path, &current)) {
+        fprintf(stderr, "Warning: Could not write index %s\n", index_path);
+    }
+    *index = current;
+    return true;
+}
+
+static const GenerationIndex *find_generation(const LogIndex *index, int generation) {
+    for (int i = index->generation_count - 1; i >= 0; i--) {
+        if (index->generations[i].generation == generation) return &index->generations[i];
+    }
+    return NULL;
+}
+
+static int query_stats(const LogIndex *index, int first, int last) {
+    printf("generation,maze_type,individuals,goals_reached,best_fitness,avg_fitness,best_individual_id\n");
+    for (int i = 0; i < index->generation_count; i++) {
+        const GenerationIndex *g = &index->generations[i];
+        if (g->generation < first || g->generation > last) continue;
+        printf("%d,%s,%d,%d,%.3f,%.3f,%d\n", g->generation, g->maze_type, g->individual_count,
+               g->goals_reached, g->best_fitness, g->avg_fitness, g->best_individual_id);
+    }
+    return 0;
+}
+
+// Keeps the K best in a small sorted buffer, one pass over the index
+static int query_top(const LogIndex *index, int k, int generation) {
+    if (k <= 0) return 1;
+    const IndividualIndex **top = calloc(k, sizeof(IndividualIndex *));
+    if (!top) return 1;
+
+    int count = 0;
+    for (int i = 0; i < index->individual_count; i++) {
+        const IndividualIndex *ind = &index->individuals[i];
+        if (generation >= 0 && ind->generation != generation) continue;
+        if (count == k && ind->fitness <= top[k - 1]->fitness) continue;
+
+        int pos = count < k ? count++ : k - 1;
+        while (pos > 0 && top[pos - 1]->fitness < ind->fitness) {
+            top[pos] = top[pos - 1];
+            pos--;
+        }
+        top[pos] = ind;
+    }
+
+    printf("rank,id,generation,fitness,steps_taken,reached_goal\n");
+    for (int i = 0; i < count; i++) {
+        printf("%d,%d,%d,%.3f,%d,%d\n", i + 1, top[i]->id, top[i]->generation,
+               top[i]->fitness, top[i]->steps_taken, top[i]->reached_goal);
+    }
+    free(top);
+    return 0;
+}
+
+static int query_trajectory(const LogIndex *index, int id, int generation) {
+    int found = 0;
+    printf("id,generation,step,x,y,angle,action\n");
+    for (int i = 0; i < index->individual_count; i++) {
+        const IndividualIndex *ind = &index->individuals[i];
+        if (ind->id != id || (generation >= 0 && ind->generation != generation)) continue;
+
+        MappedFile map;
+        if (!map_file(index->segments[ind->segment].path, &map)) continue;
+        found++;
+
+        const char *p = map.data + ind->start;
+        const char *end = map.data + ind->end;
+        int step = 0;
+        float x = 0, y = 0, angle = 0;
+        while (p < end) {
+            const char *eol = memchr(p, '\n', (size_t)(end - p));
+            if (!eol) eol = end;
+            char buf[128];
+            size_t n = (size_t)(eol - p) < sizeof(buf) - 1 ? (size_t)(eol - p) : sizeof(buf) - 1;
+            memcpy(buf, p, n);
+            buf[n] = '\0';
+
+            char action[32];
+            if (sscanf(buf, " \"step\": %d", &step) == 1) {
+            } else if (sscanf(buf, " \"position\": [%f, %f]", &x, &y) == 2) {
+            } else if (starts_with(p, eol, "              \"angle\": ")) {
+                sscanf(buf, " \"angle\": %f", &angle);
+            } else if (sscanf(buf, " \"action\": \"%31[^\"]\"", action) == 1) {
+                printf("%d,%d,%d,%.3f,%.3f,%.3f,%s\n", ind->id, ind->generation, step, x, y, angle, action);
+            }
+            p = eol + 1;
+        }
+        unmap_file(&map);
+    }
+
+    if (!found) {
+        fprintf(stderr, "Individual %d not found\n", id);
+        return 1;
+    }
+    return 0;
+}
+
+static int query_maze(const LogIndex *index, int generation) {
+    const GenerationIndex *g = find_generation(index, generation);
+    if (!g) {
+        fprintf(stderr, "Generation %d not found\n", generation);
+        return 1;
+    }
+
+    // The layout is logged once per maze and segment, later generations only name the maze
+    const GenerationIndex *source = g;
+    for (int i = (int)(g - index->generations); source->layout == 0 && i >= 0; i--) {
+        const GenerationIndex *earlier = &index->generations[i];
+        if (earlier->layout != 0 && earlier->maze_id == g->maze_id) source = earlier;
+    }
+    if (source->layout == 0) {
+        fprintf(stderr, "No layout logged for the maze of generation %d\n", generation);
+        return 1;
+    }
+
+    MappedFile map;
+    if (!map_file(index->segments[source->segment].path, &map)) return 1;
+
+    printf("# generation %d, %s, %dx%d\n", g->generation, g->maze_type, g->width, g->height);
+    const char *p = map.data + source->layout;
+    const char *end = map.data + source->end;
+    for (int row = 0; row < g->height && p < end; row++) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        // each cell is written as "X"
+        for (const char *c = p; c + 2 < eol; c++) {
+            if (c[0] == '"' && c[2] == '"') {
+                putchar(c[1]);
+                c += 2;
+            }
+        }
+        putchar('\n');
+        p = eol + 1;
+    }
+    unmap_file(&map);
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: logquery [--log robot_log.json] <query>\n"
+            "  stats [first [last]]          per-generation statistics\n"
+            "  top K [generation]            K best individuals\n"
+            "  trajectory ID [generation]    movements of one individual\n"
+            "  maze GENERATION               maze layout used by a generation\n");
+}
+
+int main(int argc, char **argv) {
+    const char *log_filename = "robot_log.json";
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "--log") == 0) {
+        log_filename = argv[arg + 1];
+        arg += 2;
+    }
+    if (arg >= argc) {
+        usage();
+        return 1;
+    }
+
+    const char *query = argv[arg++];
+    int rest = argc - arg;
+
+    LogIndex index;
+    if (!open_index(log_filename, &index)) return 1;
+
+    int result = 1;
+    if (strcmp(query, "stats") == 0) {
+        int first = rest > 0 ? atoi(argv[arg]) : 0;
+        int last = rest > 1 ? atoi(argv[arg + 1]) : (rest > 0 ? first : 0x7fffffff);
+        result = query_stats(&index, first, last);
+    } else if (strcmp(query, "top") == 0 && rest > 0) {
+        result = query_top(&index, atoi(argv[arg]), rest > 1 ? atoi(argv[arg + 1]) : -1);
+    } else if (strcmp(query, "trajectory") == 0 && rest > 0) {
+        result = query_trajectory(&index, atoi(argv[arg]), rest > 1 ? atoi(argv[arg + 1]) : -1);
+    } else if (strcmp(query, "maze") == 0 && rest > 0) {
+        result = query_maze(&index, atoi(argv[arg]));
+    } else {
+        usage();
+    }
+
+    free_index(&index);
+    return result;
+}
@@ -0,0 +1,19 @@
+// robotworker: evaluation worker for a distributed run.
+//
+// Connects to the coordinator started from the main menu ("Run distributed
+// simulation"), simulates the chromosome batches it is sent and returns the
+// fitness, a trajectory summary and the movements. When the coordinator goes
+// away the worker keeps trying to reconnect, so workers can be started before
+// the run, restarted during it and reused for the next one.
+//
+//   robotworker [unix:/path/to/socket | tcp:host:port]
+
+#include <stdio.h>
+
+#include "../Include/configuration.h"
+#include "../Include/distributed.h"
+
+int main(int argc, char **argv) {
+    const char *address = argc > 1 ? argv[1] : DISTRIBUTED_ADDRESS;
+    return worker_run(address);
+}
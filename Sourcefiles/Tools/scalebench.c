@@ -0,0 +1,387 @@
+// scalebench: end-to-end throughput of the training loop across population
+// size, maze size, step budget and thread count.
+//
+// Every combination of the lists below runs a few generations from a fixed
+// seed in its own child process (so peak RSS is per configuration and a crash
+// only costs one row): the population is evaluated on the task scheduler with
+// --threads workers, one individual per task,
+// logged like a normal run and bred with the default selection settings.
+// One CSV row per configuration goes to stdout.
+//
+//   scalebench [--pop 50,500,5000] [--maze 25,101,501,2000] [--steps 1000]
+//              [--threads 1,N] [--generations 3] [--no-log]
+//
+// --pop 100000 and large mazes need a few GB and minutes per row. Build with
+// -DCMAKE_BUILD_TYPE=Release. Logs are written to a temporary directory.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "../Include/configuration.h"
+#include "../Include/types.h"
+#include "../Include/robot.h"
+#include "../Include/maze.h"
+#include "../Include/chromosome.h"
+#include "../Include/logger.h"
+#include "../Include/selection.h"
+#include "../Include/sims.h"
+#include "../Include/rng.h"
+#include "../Include/scheduler.h"
+
+#define SCALE_SEED      12345
+#define SCALE_CLEAR     60      // MEDIUM density
+#define MAX_LIST        16
+#define MAX_THREADS     256
+
+typedef struct {
+    int values[MAX_LIST];
+    int count;
+} IntList;
+
+typedef struct {
+    int pop, maze, steps, threads;
+} ScaleConfig;
+
+typedef struct {
+    double seconds;
+    long long individuals;
+    long long steps;
+    long long log_bytes;
+} ScaleResult;
+
+// Shared by the evaluation tasks of one generation
+typedef struct {
+    Simulationcontext *context;
+    Individual *population;
+    int max_steps;
+    MovementLog **movements;    // one trajectory buffer per worker, NULL without a log
+    atomic_llong steps;
+    JsonLogger *logger;
+    pthread_mutex_t log_lock;
+} ScaleJob;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool parse_list(const char *text, IntList *list) {
+    list->count = 0;
+    while (*text && list->count < MAX_LIST) {
+        char *end;
+        long value = strtol(text, &end, 10);
+        if (end == text || value <= 0) return false;
+        list->values[list->count++] = (int)value;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return list->count > 0 && *text == '\0';
+}
+
+// Same layout as generate_labyrinthe but any size and not required to be
+// solvable, throughput is what is measured here
+static void build_maze(Simulationcontext *c, int size) {
+    c->maze_width = size;
+    c->maze_height = size;
+    c->maze = create_matrix(size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            c->maze[y][x] = (x == 0 || y == 0 || x == size - 1 || y == size - 1) ? BORDER : EMPTY;
+        }
+    }
+    carve_random_paths(c->maze, size, size, SCALE_CLEAR);
+    place_goal_on_edge(c->maze, size, size, c);
+    place_start(c->maze, size, size, c);
+    maze_prepare(c, NULL);
+}
+
+static void evaluate_task(void *arg, int index, int worker) {
+    ScaleJob *job = arg;
+    Individual *individual = &job->population[index];
+    // without a log the trajectories are not recorded at all
+    MovementLog *movements = job->movements ? job->movements[worker] : NULL;
+    int moves = 0;
+    evaluate_individual(job->context, individual, job->max_steps, movements, &moves);
+    atomic_fetch_add(&job->steps, individual->steps_taken);
+    if (job->logger) {
+        pthread_mutex_lock(&job->log_lock);
+        log_individual_complete(job->logger, individual, movements, moves);
+        pthread_mutex_unlock(&job->log_lock);
+    }
+}
+
+static long long directory_bytes(const char *path) {
+    long long total = 0;
+    DIR *dir = opendir(path);
+    if (!dir) return 0;
+    struct dirent *entry;
+    char file[1024];
+    struct stat info;
+    while ((entry = readdir(dir)) != NULL) {
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        if (stat(file, &info) == 0 && S_ISREG(info.st_mode)) total += info.st_size;
+    }
+    closedir(dir);
+    return total;
+}
+
+static void remove_directory(const char *path) {
+    DIR *dir = opendir(path);
+    if (dir) {
+        struct dirent *entry;
+        char file[1024];
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            remove(file);
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+// Runs in the child process, in its own working directory
+static bool run_config(const ScaleConfig *config, int generations, bool with_log, ScaleResult *result) {
+    Simulationcontext context = {
+        .sensors = {
+            {0, 0, 0, 50},
+            {0, 0, -M_PI/2, 50},
+            {0, 0, M_PI/2, 50},
+            {0, 0, -M_PI/4, 30},
+            {0, 0, M_PI/4, 30}
+        }
+    };
+    rng_seed(SCALE_SEED + (uint64_t)config->maze);
+    build_maze(&context, config->maze);
+
+    Individual *population = calloc(config->pop, sizeof(Individual));
+    Individual *new_population = calloc(config->pop, sizeof(Individual));
+    if (!population || !new_population) {
+        free(population);
+        free(new_population);
+        return false;
+    }
+    rng_seed(SCALE_SEED);
+    int id_counter = 0;
+    for (int i = 0; i < config->pop; i++) {
+        initialize_chromosome(&population[i].chromosome);
+        population[i].id = id_counter++;
+    }
+
+    ScaleJob job = {
+        .context = &context,
+        .population = population,
+        .max_steps = config->steps,
+        .logger = with_log ? init_json_logger("robot_log.json") : NULL,
+    };
+    pthread_mutex_init(&job.log_lock, NULL);
+    TaskScheduler *scheduler = scheduler_create(config->threads);
+    int workers = scheduler_worker_count(scheduler);
+    if (job.logger) {
+        job.movements = calloc(workers, sizeof(MovementLog *));
+        for (int w = 0; job.movements && w < workers; w++) {
+            job.movements[w] = malloc(config->steps * sizeof(MovementLog));
+            if (!job.movements[w]) {
+                close_json_logger(job.logger);
+                job.logger = NULL;
+                break;
+            }
+        }
+    }
+
+    double started = now_seconds();
+    long long steps = 0;
+    for (int generation = 0; generation < generations; generation++) {
+        for (int i = 0; i < config->pop; i++) {
+            Individual *individual = &population[i];
+            initialize_robot(&individual->robot, (float)context.start_x, (float)context.start_y);
+            individual->active = 1;
+            individual->fitness = 0;
+            individual->steps_taken = 0;
+            individual->collision_count = 0;
+            individual->reached_goal = false;
+            individual->is_best = 0;
+            individual->predicted_fitness = NAN;
+            individual->coarse_fitness = NAN;
+            individual->novelty = 0;
+            individual->generation = generation;
+        }
+        if (job.logger) log_generation_start(job.logger, generation, "MEDIUM", &context);
+
+        job.population = population;
+        atomic_store(&job.steps, 0);
+        scheduler_parallel_for(scheduler, config->pop, 1, evaluate_task, &job);
+        steps += atomic_load(&job.steps);
+
+        int best = 0, goals = 0;
+        double total_fitness = 0;
+        for (int i = 0; i < config->pop; i++) {
+            if (population[i].fitness > population[best].fitness) best = i;
+            if (population[i].reached_goal) goals++;
+            total_fitness += population[i].fitness;
+        }
+        if (job.logger) {
+            GenerationStats stats = {
+                .goals_reached = goals,
+                .avg_fitness = (float)(total_fitness / config->pop),
+                .best_fitness = population[best].fitness,
+                .best_individual_id = population[best].id,
+                .coarse_correlation = NAN,
+            };
+            log_generation_end(job.logger, &stats);
+        }
+
+        if (!breed_population(&selection_config, population, new_population, config->pop,
+                              generation, &id_counter)) {
+            fprintf(stderr, "Could not breed generation %d, the population is kept\n", generation);
+            continue;
+        }
+        Individual *swap = population;
+        population = new_population;
+        new_population = swap;
+    }
+    if (job.logger) close_json_logger(job.logger);
+
+    result->seconds = now_seconds() - started;
+    result->individuals = (long long)config->pop * generations;
+    result->steps = steps;
+    result->log_bytes = directory_bytes(".");
+
+    scheduler_destroy(scheduler);
+    if (job.movements) {
+        for (int w = 0; w < workers; w++) free(job.movements[w]);
+        free(job.movements);
+    }
+    pthread_mutex_destroy(&job.log_lock);
+    maze_release(&context);
+    free(population);
+    free(new_population);
+    return true;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: scalebench [--pop LIST] [--maze LIST] [--steps LIST] [--threads LIST]\n"
+                    "                  [--generations N] [--no-log]\n"
+                    "LIST is comma separated, e.g. --pop 50,1000,100000\n");
+}
+
+int main(int argc, char **argv) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    IntList pops = {{50, 500, 5000}, 3};
+    IntList mazes = {{25, 101, 501, 2000}, 4};
+    IntList steps = {{MAX_STEPS}, 1};
+    IntList threads = {{1, (int)cores}, cores > 1 ? 2 : 1};
+    int generations = 3;
+    bool with_log = true;
+
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (strcmp(argv[i], "--pop") == 0 && i + 1 < argc) ok = parse_list(argv[++i], &pops);
+        else if (strcmp(argv[i], "--maze") == 0 && i + 1 < argc) ok = parse_list(argv[++i], &mazes);
+        else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) ok = parse_list(argv[++i], &steps);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) ok = parse_list(argv[++i], &threads);
+        else if (strcmp(argv[i], "--generations") == 0 && i + 1 < argc) ok = (generations = atoi(argv[++i])) > 0;
+        else if (strcmp(argv[i], "--no-log") == 0) with_log = false;
+        else ok = false;
+        if (!ok) {
+            usage();
+            return 1;
+        }
+    }
+    for (int t = 0; t < threads.count; t++) {
+        if (threads.values[t] > MAX_THREADS) threads.values[t] = MAX_THREADS;
+    }
+    for (int m = 0; m < mazes.count; m++) {
+        if (mazes.values[m] < 5) mazes.values[m] = 5;
+    }
+
+    // keep stdout for the results and send everything the simulation prints to stderr
+    FILE *out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!out || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "Could not set up the output\n");
+        return 1;
+    }
+
+    char workdir[] = "/tmp/robotscale.XXXXXX";
+    if (!mkdtemp(workdir)) {
+        fprintf(stderr, "Could not create a working directory for the logs\n");
+        return 1;
+    }
+
+    fprintf(out, "pop,maze,max_steps,threads,generations,seconds,individuals_per_sec,steps_per_sec,"
+                 "peak_rss_mb,log_bytes_per_sec,status\n");
+    fflush(out);
+
+    int row = 0;
+    for (int p = 0; p < pops.count; p++)
+    for (int m = 0; m < mazes.count; m++)
+    for (int s = 0; s < steps.count; s++)
+    for (int t = 0; t < threads.count; t++) {
+        ScaleConfig config = {pops.values[p], mazes.values[m], steps.values[s], threads.values[t]};
+        fprintf(stderr, "pop %d, maze %d, steps %d, threads %d\n",
+                config.pop, config.maze, config.steps, config.threads);
+
+        char rundir[256];
+        snprintf(rundir, sizeof(rundir), "%s/run%03d", workdir, row++);
+        int pipefd[2];
+        if (mkdir(rundir, 0700) != 0 || pipe(pipefd) != 0) {
+            fprintf(stderr, "Could not set up %s\n", rundir);
+            continue;
+        }
+
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(pipefd[0]);
+            ScaleResult result;
+            bool ok = chdir(rundir) == 0 && run_config(&config, generations, with_log, &result);
+            if (ok && write(pipefd[1], &result, sizeof(result)) != (ssize_t)sizeof(result)) ok = false;
+            fflush(stdout);
+            _exit(ok ? 0 : 1);
+        }
+        close(pipefd[1]);
+
+        ScaleResult result;
+        bool have_result = pid > 0 && read(pipefd[0], &result, sizeof(result)) == (ssize_t)sizeof(result);
+        close(pipefd[0]);
+
+        int status = 0;
+        struct rusage usage_info;
+        memset(&usage_info, 0, sizeof(usage_info));
+        if (pid > 0) wait4(pid, &status, 0, &usage_info);
+        remove_directory(rundir);
+
+        char state[32] = "ok";
+        if (pid < 0) snprintf(state, sizeof(state), "fork failed");
+        else if (WIFSIGNALED(status)) snprintf(state, sizeof(state), "signal %d", WTERMSIG(status));
+        else if (!have_result) snprintf(state, sizeof(state), "failed");
+
+        double peak_rss_mb = usage_info.ru_maxrss / 1024.0;   // kB on Linux
+        if (have_result && result.seconds > 0) {
+            fprintf(out, "%d,%d,%d,%d,%d,%.3f,%.1f,%.0f,%.1f,%.0f,%s\n",
+                    config.pop, config.maze, config.steps, config.threads, generations,
+                    result.seconds, result.individuals / result.seconds, result.steps / result.seconds,
+                    peak_rss_mb, result.log_bytes / result.seconds, state);
+        } else {
+            fprintf(out, "%d,%d,%d,%d,%d,,,,%.1f,,%s\n", config.pop, config.maze, config.steps,
+                    config.threads, generations, peak_rss_mb, state);
+        }
+        fflush(out);
+    }
+
+    rmdir(workdir);
+    fclose(out);
+    return 0;
+}
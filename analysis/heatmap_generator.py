@@ -7,15 +7,22 @@ import matplotlib.animation as animation
 from matplotlib.colors import LinearSegmentedColormap, ListedColormap
 import seaborn as sns
 import argparse
+import struct
 import sys
 from pathlib import Path
 
+# Grids som simuleringen själv räknar upp, se Sourcefiles/Include/heatmap.h
+HEATMAP_MAGIC = 0x50414d48
+HEATMAP_OVERALL, HEATMAP_GENERATION, HEATMAP_PHASE, HEATMAP_BEST = range(4)
+PHASE_NAMES = ["OPEN (Easy)", "MEDIUM", "COMPLEX", "NARROW (Hard)"]
+
 class RobotHeatmapGenerator:
     def __init__(self, json_file="robot_log.json", maze_file="maze_log.txt"):
         """Initialisera heatmap generator"""
         self.json_file = json_file
         self.maze_file = maze_file
         self.data = None
+        self.manifest = None
         self.maze_data = None
         
         self.setup_colormaps()
@@ -31,8 +38,25 @@ class RobotHeatmapGenerator:
         maze_colors = ['#000000', '#808080', '#FFFFFF', '#0000FF', '#FF0000']
         self.maze_cmap = ListedColormap(maze_colors)
 
+    def manifest_path(self):
+        """Manifestet ligger bredvid loggen: robot_log.json -> robot_log.manifest.json"""
+        path = Path(self.json_file)
+        stem = path.name[:-5] if path.name.endswith('.json') else path.name
+        return path.with_name(f"{stem}.manifest.json")
+
     def load_data(self):
-        """Ladda JSON data från loggfil"""
+        """Ladda manifestet för en segmenterad logg, annars hela JSON-filen"""
+        manifest_file = self.manifest_path()
+        if manifest_file.exists():
+            try:
+                with open(manifest_file, 'r', encoding='utf-8') as f:
+                    self.manifest = json.load(f)
+                print(f"Laddade manifest {manifest_file} ({len(self.manifest['segments'])} segment)")
+                return True
+            except json.JSONDecodeError as e:
+                print(f"JSON-fel i manifest: {e}")
+                return False
+
         try:
             with open(self.json_file, 'r', encoding='utf-8') as f:
                 self.data = json.load(f)
@@ -45,6 +69,82 @@ class RobotHeatmapGenerator:
             print(f"JSON-fel: {e}")
             return False
 
+    def native_heatmap_path(self, suffix):
+        path = Path(self.json_file)
+        stem = path.name[:-5] if path.name.endswith('.json') else path.name
+        return path.with_name(f"{stem}{suffix}")
+
+    def read_native_grids(self, path, wanted=None):
+        """Läs heatmap-poster från fil; poster som inte efterfrågas hoppas över med seek"""
+        grids = []
+        try:
+            f = open(path, 'rb')
+        except FileNotFoundError:
+            return grids
+        with f:
+            while True:
+                header = f.read(24)
+                if len(header) < 24:
+                    break
+                magic, kind, generation, phase, width, height = struct.unpack('<6i', header)
+                if magic != HEATMAP_MAGIC:
+                    print(f"Felaktig heatmap-post i {path}")
+                    break
+                cells = width * height
+                if wanted is not None and not wanted(kind, generation, phase):
+                    f.seek(cells * 5, 1)
+                    continue
+                layout = f.read(cells)
+                counts = np.frombuffer(f.read(cells * 4), dtype='<u4').reshape(height, width)
+                rows = [layout[y * width:(y + 1) * width].decode('latin-1') for y in range(height)]
+                grids.append({'kind': kind, 'generation': generation, 'phase': phase,
+                              'layout': rows, 'counts': counts.astype(float)})
+        return grids
+
+    def render_native(self, generation=None, best_only=False, output_file="heatmap.png"):
+        """Rita heatmaps från simuleringens färdiga grids, utan att läsa JSON-loggen"""
+        # Generationens grid räknar alla individer, den bästa finns bara i loggen
+        if generation is not None and best_only:
+            return False
+        if generation is not None:
+            grids = self.read_native_grids(self.native_heatmap_path('.heatmaps.bin'),
+                                           lambda k, g, p: k == HEATMAP_GENERATION and g == generation)
+            titles = [f"Generation {generation}"]
+        else:
+            grids = self.read_native_grids(self.native_heatmap_path('.heatmap_totals.bin'))
+            if best_only:
+                grids = [g for g in grids if g['kind'] == HEATMAP_BEST]
+            grids.sort(key=lambda g: (g['kind'] != HEATMAP_OVERALL, g['kind'] != HEATMAP_BEST, g['phase']))
+            titles = []
+            for g in grids:
+                if g['kind'] == HEATMAP_OVERALL:
+                    titles.append("Alla Rörelser")
+                elif g['kind'] == HEATMAP_BEST:
+                    titles.append("Bästa individer")
+                else:
+                    name = PHASE_NAMES[g['phase']] if 0 <= g['phase'] < len(PHASE_NAMES) else g['phase']
+                    titles.append(f"Fas {name} (t.o.m. generation {g['generation']})")
+
+        if not grids:
+            return False
+
+        cols = min(3, len(grids))
+        rows = (len(grids) + cols - 1) // cols
+        fig, axes = plt.subplots(rows, cols, figsize=(6 * cols, 5 * rows), squeeze=False)
+        fig.suptitle("Robot Movement Heatmap", fontsize=16, fontweight='bold')
+        for ax, grid, title in zip(axes.flat, grids, titles):
+            heatmap = grid['counts']
+            if heatmap.max() > 0:
+                heatmap = heatmap / heatmap.max()
+            self.create_clean_heatmap(ax, heatmap, self.parse_maze_grid(grid['layout']), title)
+        for ax in list(axes.flat)[len(grids):]:
+            ax.set_visible(False)
+
+        plt.tight_layout()
+        plt.savefig(output_file, dpi=300, bbox_inches='tight', facecolor='white')
+        print(f"Heatmap sparad som {output_file}")
+        return True
+
     def load_maze_from_txt(self, maze_file):
         """Ladda maze från separat textfil"""
         try:
@@ -76,22 +176,83 @@ class RobotHeatmapGenerator:
             maze_array.append(row)
         return np.array(maze_array)
 
-    def extract_movement_data(self, generation=None, best_only=False):
+    def iter_generations(self, first=None, last=None):
+        """Generera generationer i intervallet [first, last].
+
+        Med manifest öppnas bara de segment som överlappar intervallet och
+        varje generation läses direkt från sitt byteintervall.
+        """
+        def in_range(gen):
+            return (first is None or gen >= first) and (last is None or gen <= last)
+
+        if self.manifest is None:
+            for gen_data in (self.data or {}).get('generations', []):
+                if in_range(gen_data['generation']):
+                    yield gen_data
+            return
+
+        base = self.manifest_path().parent
+        for segment in self.manifest['segments']:
+            if first is not None and segment['last_generation'] < first:
+                continue
+            if last is not None and segment['first_generation'] > last:
+                continue
+            with open(base / segment['file'], 'rb') as f:
+                for entry in segment['generations']:
+                    if not in_range(entry['generation']):
+                        continue
+                    f.seek(entry['start'])
+                    yield json.loads(f.read(entry['end'] - entry['start']))
+
+    def find_layout(self, maze_id, generation):
+        """Layouten skrivs bara i labyrintens första generation i varje segment,
+        senare generationer hänvisar till den med maze_id. Sök bakåt från generation."""
+        if self.manifest is None:
+            earlier = [g for g in (self.data or {}).get('generations', []) if g['generation'] <= generation]
+            for gen_data in reversed(earlier):
+                info = gen_data.get('maze_info', {})
+                if info.get('maze_id') == maze_id and 'layout' in info:
+                    return info['layout']
+            return None
+
+        base = self.manifest_path().parent
+        for segment in reversed(self.manifest['segments']):
+            if segment['first_generation'] > generation:
+                continue
+            with open(base / segment['file'], 'rb') as f:
+                for entry in reversed(segment['generations']):
+                    if entry['generation'] > generation:
+                        continue
+                    f.seek(entry['start'])
+                    info = json.loads(f.read(entry['end'] - entry['start'])).get('maze_info', {})
+                    if info.get('maze_id') == maze_id and 'layout' in info:
+                        return info['layout']
+        return None
+
+    def extract_movement_data(self, generation=None, best_only=False, start=None, end=None):
         """Extrahera rörelsedata från JSON"""
         movements = []
         maze_info = None
         
-        if not self.data or 'generations' not in self.data:
+        if self.manifest is None and (not self.data or 'generations' not in self.data):
             print("Ingen giltig data hittades")
             return movements, maze_info
+
+        first, last = start, end
+        if generation is not None:
+            first, last = generation, generation
         
-        for gen_data in self.data['generations']:
+        for gen_data in self.iter_generations(first, last):
             current_gen = gen_data['generation']
-            if generation is not None and current_gen != generation:
-                continue
             
             if maze_info is None and 'maze_info' in gen_data:
-                maze_info = gen_data['maze_info']
+                maze_info = dict(gen_data['maze_info'])
+                if 'layout' not in maze_info:
+                    layout = self.find_layout(maze_info.get('maze_id'), current_gen)
+                    if layout is None:
+                        print(f"Ingen layout loggad för labyrinten i generation {current_gen}")
+                        return [], None
+                    maze_info['layout'] = layout
             
             for individual in gen_data['individuals']:
                 if best_only and not individual.get('is_best', False):
@@ -495,6 +656,10 @@ def main():
     parser.add_argument('--maze', '-m', help='Separat maze textfil')
     parser.add_argument('--generation', '-g', type=int, 
                        help='Specifik generation att analysera')
+    parser.add_argument('--start', type=int,
+                       help='Första generation i ett intervall')
+    parser.add_argument('--end', type=int,
+                       help='Sista generation i ett intervall')
     parser.add_argument('--best-only', '-b', action='store_true', 
                        help='Endast bästa individer')
     parser.add_argument('--paths', '-p', action='store_true', 
@@ -509,13 +674,21 @@ def main():
     args = parser.parse_args()
     
     generator = RobotHeatmapGenerator(args.input, args.maze)
+
+    # Vanliga heatmaps ritas direkt från simuleringens egna grids när de finns
+    simple_heatmap = not (args.paths or args.comparison or args.evolution) and \
+        args.start is None and args.end is None
+    if simple_heatmap and generator.render_native(args.generation, args.best_only, args.output):
+        return
     
     if not generator.load_data():
         sys.exit(1)
     
     movements, maze_info = generator.extract_movement_data(
         generation=args.generation, 
-        best_only=args.best_only
+        best_only=args.best_only,
+        start=args.start,
+        end=args.end
     )
     
     title = "Robot Movement Heatmap"